@@ -7,27 +7,86 @@ Static analysis at the lexical abstraction level
 
 #include <assert.h>              /* for assert            */
 #include <stdio.h>               /* for printf + fgetc    */
+#include <string.h>              /* for strstr            */
+#include <time.h>                /* for clock_gettime     */
 #include "lexer.h"
 #include "source.h"
 #include "str.h"
+#include "analysis.h"
+#include "prefilter.h"
+#include "include.h"
+#include "typedefs.h"
+#include "tokmatch.h"
+#include "tokcache.h"
+#include "ppcond.h"
+#include "report.h"
+#include "metrics.h"
+#include "clones.h"
 #include "check_assign_in_ctrl_stmt.h"   /* check for assignments in expressions affecting control flow */
 #include "check_missing_void.h"          /* check fundecls for missing (void), e.g. f() vs f(void) <-- correct */
 #include "check_misleading_var_name.h"   /* check if variable names are misleading, e.g. if u32var is of type int8_t */
 #include "check_smcln_after_ctrl_stmt.h" /* check for suspicious semicolons, e.g. 'if (X); { <always-on> }' etc. */
+#include "check_project_decls.h"         /* collect file-scope declarations, for checks across files */
 
 /* max size of token-buffer for each file */
 #define MAXTOKENBUFSIZE (1024*1024)/1
 
+#define BINARY_SNIFF_LEN    4096   /* files with a null byte in the first 4K are taken for binaries */
+#define BUDGET_CLOCK_MASK   1023   /* the time budget is checked every 1024 tokens */
 
 
+
+static void analysis_check_content(struct lexer* l);
 static void analysis_new_file(void);
 static void analysis_new_token(void);
+static int  analysis_push_token(struct token t);
+static int  analysis_tokens_from_cache(struct lexer* l, uint64_t content_hash);
+static int  analysis_ntokens(void);
+static void analysis_emit_tokens(uint64_t content_hash);
+static void analysis_whole_file(void);
+static void analysis_directive(struct lexer* l, const char* directive, uint32_t len);
+static uint32_t analysis_now_ms(void);
 
 
 
 static struct token toks[MAXTOKENBUFSIZE];
+static uint8_t packed[MAXTOKENBUFSIZE + TOKMATCH_PAD]; /* one byte per token, for vectorized matching */
 static struct source_file s;
 static int ntokens;
+static int use_prefilter = 1;
+static int use_vector_match = 0;
+static const char* emit_tokens_dir = 0;  /* write token streams as binary caches here */
+static const char* token_cache_dir = 0;  /* read token streams from binary caches here */
+static uint32_t enabled_checks = CHK_PER_FILE;
+static uint32_t active_checks;   /* checks that can fire in the current file */
+static uint32_t max_ms = 0;                       /* per-file time budget, 0 for none */
+static uint32_t max_tokens = MAXTOKENBUFSIZE;     /* per-file token budget */
+static struct tokcache cache;    /* mapped token stream of the current file - symbols point into it */
+
+
+
+void analysis_set_prefilter(int enabled)
+{
+  use_prefilter = enabled;
+}
+
+void analysis_set_vector_match(int enabled)
+{
+  use_vector_match = enabled;
+}
+
+void analysis_set_token_cache(const char* emit_dir, const char* read_dir)
+{
+  emit_tokens_dir = emit_dir;
+  token_cache_dir = read_dir;
+}
+
+/* Files over budget are analyzed up to that point and noted as skipped - 0 means no limit */
+void analysis_set_budget(uint32_t ms, uint32_t tokens)
+{
+  max_ms = ms;
+  max_tokens = ((tokens == 0) || (tokens > MAXTOKENBUFSIZE)) ? MAXTOKENBUFSIZE : tokens;
+}
 
 
 
@@ -36,58 +95,313 @@ void analysis_check_file(struct lexer* l, const char* src_file)
   /* Determine input source and test if it can be found and read.
      If src_file can be found, src_init() dynamically allocates memory. */
   int src_init_success = src_init(&s, src_file);
-  assert(src_init_success == 1);
+  assert(src_init_success != 0);
 
   /* Reclaim string-buffer memory  */
   str_init();
 
   /* Read file, null-terminate buffer and close file again */
-  if (src_read_content(&s) > 0)
+  if (src_init_success < 0)
   {
-    /* Initialize lexer and pass source file */
-    lexer_set_char_buf(l, s.file_content);
+    report_skipped(&s, "too-large", 0, 0, 0);
+  }
+  else if (src_read_content(&s) > 0)
+  {
+    analysis_check_content(l);
+  }
+  /* Clean up memory dynamically allocated by src_init(). */
+  src_free(&s);
+}
+
 
-    /* (Re-)Initialize checkers */
-    analysis_new_file();
+/* Lex a file only to learn the type names of its typedefs - no checker sees the tokens. With --jobs,
+   type names are per worker process: a first pass over all files, before the workers are forked,
+   lets each worker know the typedefs of every file. */
+void analysis_learn_types(struct lexer* l, const char* src_file)
+{
+  str_init();
 
-    /* ====================================== */
-    /* Tokenize file and build token-stream:  */
-    /* ====================================== */
+  if (    (src_init(&s, src_file) > 0)
+       && (src_read_content(&s) > 0)
+       && (memchr(s.file_content, 0, (s.file_size < BINARY_SNIFF_LEN) ? s.file_size : BINARY_SNIFF_LEN) == 0)
+       && (strstr(s.file_content, "typedef") != 0))
+  {
+    lexer_set_char_buf(l, s.file_content);
+    l->on_directive = 0;
+    typedefs_new_file();
 
-    /* Re-use token-buffer for the new file */
     ntokens = 0;
+    while (    (l->buffer[0] != 0)
+            && ((uint32_t)ntokens < max_tokens)
+            && (str_available() > MAXTOKENLEN))
+    {
+      toks[ntokens] = lexer_next_token(l);
+      if (toks[ntokens].tokknd == TOK_EOF)
+      {
+        break;
+      }
+      ntokens += 1;
+      typedefs_new_token(toks, ntokens - 1);
+    }
+    ntokens = 0;
+  }
+  src_free(&s);
+}
+
+
+/* Analyze contents loaded in a batch - see loader.h */
+void analysis_check_loaded(struct lexer* l, const char* src_file, char* content, uint32_t size)
+{
+  /* Reclaim string-buffer memory  */
+  str_init();
+
+  if (    (src_init_loaded(&s, src_file, content, size) > 0)
+       && (s.file_size > 0))
+  {
+    analysis_check_content(l);
+  }
+  src_free(&s);
+}
+
+
+/* Analyze 'size' bytes read from a stream, under the name 'src_file' - returns 0 if the stream ended early */
+int analysis_check_stream(struct lexer* l, const char* src_file, FILE* in, uint64_t size)
+{
+  /* Reclaim string-buffer memory  */
+  str_init();
+
+  int64_t nbytes = src_read_stream(&s, src_file, in, size);
+  int success = (nbytes > 0);
+  if (nbytes < 0)
+  {
+    /* too large to hold: noted and read past, the records after it are still analyzed */
+    report_skipped(&s, "too-large", 0, 0, 0);
+    success = src_skip_stream(in, size);
+  }
+  else if (    success
+            && (s.file_size > 0))
+  {
+    analysis_check_content(l);
+  }
+  src_free(&s);
+  return success;
+}
+
+
+/* Check the contents of 's' */
+static void analysis_check_content(struct lexer* l)
+{
+  /* Binary files named '.c' would only produce garbage tokens */
+  if (memchr(s.file_content, 0, (s.file_size < BINARY_SNIFF_LEN) ? s.file_size : BINARY_SNIFF_LEN) != 0)
+  {
+    report_skipped(&s, "binary", 0, 0, 0);
+    return;
+  }
+
+  /* Skip checkers whose trigger tokens do not occur in the file - and lexing altogether if none can fire */
+  active_checks = enabled_checks;
+  if (use_prefilter)
+  {
+    active_checks = prefilter_scan(s.file_content, s.file_size, enabled_checks);
+
+    /* aliases and custom rules can trigger the misleading-name check without any 'intN_t' in the file */
+    if (    (typedefs_naliases() > 0)
+         || (check_misleading_var_name_custom_rules() > 0))
+    {
+      active_checks |= (enabled_checks & CHK_BIT(CHK_MISLEADING_VAR_NAME));
+    }
+  }
+  if (    (active_checks == 0)
+       && (emit_tokens_dir == 0)                      /* token caches are written for every file */
+       && !check_project_decls_enabled()              /* declarations are collected from every file */
+       && !metrics_enabled()                          /* metrics are computed for every file */
+       && !clones_enabled()                           /* every file can hold a copy */
+       && (strstr(s.file_content, "typedef") == 0)   /* still lex files that may teach us type names */
+       && (    !include_follow_enabled()
+            || (strstr(s.file_content, "include") == 0)))
+  {
+    return;
+  }
+
+  /* Initialize lexer and pass source file */
+  lexer_set_char_buf(l, s.file_content);
+  l->on_directive = include_follow_enabled() ? analysis_directive : 0;
+
+  /* (Re-)Initialize checkers */
+  analysis_new_file();
+
+  /* ====================================== */
+  /* Tokenize file and build token-stream:  */
+  /* ====================================== */
+
+  /* Re-use token-buffer for the new file */
+  ntokens = 0;
+
+  uint64_t content_hash = 0;
+  if ((emit_tokens_dir != 0) || (token_cache_dir != 0))
+  {
+    content_hash = tokcache_content_hash(s.file_content, s.file_size);
+  }
+
+  /* Use a cached token stream when there is an up-to-date one - pre-processor lines are not in it */
+  if (    (token_cache_dir == 0)
+       || include_follow_enabled()
+       || !analysis_tokens_from_cache(l, content_hash))
+  {
+    uint32_t start_ms = (max_ms != 0) ? analysis_now_ms() : 0;
+    const char* over_budget = 0;
 
     /* Turn characters into tokens / lexemes: */
     while (l->buffer[0] != 0)
     {
-      struct token t = lexer_next_token(l);
-      if (ntokens < MAXTOKENBUFSIZE)
+      if (!analysis_push_token(lexer_next_token(l)))
+      {
+        break;
+      }
+
+      /* Budgets - cheap compares per token, the clock only now and then */
+      if ((uint32_t)ntokens >= max_tokens)
       {
-        toks[ntokens] = t;
+        over_budget = "max-tokens";
       }
-      else if (ntokens == MAXTOKENBUFSIZE)
+      else if (str_available() <= MAXTOKENLEN)
       {
-        fprintf(stderr, "WARNING: max token buffer size exceeded, increase %s\n", "MAXTOKENBUFSIZE");
+        over_budget = "string-buffer";
       }
-
-      ntokens += 1;
-
-      if (t.tokknd == TOK_EOF)
+      else if (    (max_ms != 0)
+                && ((ntokens & BUDGET_CLOCK_MASK) == 0)
+                && ((analysis_now_ms() - start_ms) >= max_ms))
       {
+        over_budget = "max-ms";
+      }
+      if (over_budget != 0)
+      {
+        report_skipped(&s, over_budget, l->cur_lineno, (uint32_t)ntokens, (max_ms != 0) ? (analysis_now_ms() - start_ms) : 0);
         break;
       }
+    }
 
-      analysis_new_token();
+    /* a truncated token stream must not pass for the whole file */
+    if (    (emit_tokens_dir != 0)
+         && (over_budget == 0))
+    {
+      analysis_emit_tokens(content_hash);
     }
   }
-  /* Clean up memory dynamically allocated by src_init(). */
-  src_free(&s);
+
+  if (use_vector_match)
+  {
+    analysis_whole_file();
+  }
+
+  if (metrics_enabled())
+  {
+    metrics_end_file(&s);
+  }
+  if (clones_enabled())
+  {
+    clones_file(&s, toks, (uint32_t)analysis_ntokens());
+  }
+
+  /* findings held for fingerprinting need the symbols - before the cache is unmapped */
+  report_end_file(&s, toks, (uint32_t)analysis_ntokens());
+
+  tokcache_close(&cache);
 }
 
 
 
 
 
+/* Store the next token of the stream and pass it on to the checkers - returns 0 at EOF */
+static int analysis_push_token(struct token t)
+{
+  if (ntokens < MAXTOKENBUFSIZE)
+  {
+    toks[ntokens] = t;
+  }
+  else if (ntokens == MAXTOKENBUFSIZE)
+  {
+    fprintf(stderr, "WARNING: max token buffer size exceeded, increase %s\n", "MAXTOKENBUFSIZE");
+  }
+
+  ntokens += 1;
+
+  if (t.tokknd == TOK_EOF)
+  {
+    return 0;
+  }
+
+  analysis_new_token();
+  return 1;
+}
+
+
+/* Feed tokens from '<token_cache_dir>/<hash>.tlt' - returns 0 if there is no valid cache for the file contents */
+static int analysis_tokens_from_cache(struct lexer* l, uint64_t content_hash)
+{
+  char cache_path[1024];
+  struct token t;
+  uint32_t i;
+
+  tokcache_path(cache_path, sizeof(cache_path), token_cache_dir, s.file_path);
+  if (!tokcache_open(&cache, cache_path))
+  {
+    return 0;
+  }
+  if (    (cache.hdr->content_hash != content_hash)
+       || (cache.hdr->macro_hash != ppcond_hash())   /* other '#if' branches may be skipped */
+       || (cache.hdr->file_size != s.file_size))
+  {
+    tokcache_close(&cache);
+    return 0;
+  }
+
+  /* NOTE: the cache stays mapped until the file is done, token symbols point into it */
+  for (i = 0; i < cache.hdr->ntokens; ++i)
+  {
+    tokcache_token(&cache, l, i, &t);
+    analysis_push_token(t);
+  }
+
+  return 1;
+}
+
+
+/* number of tokens stored for the current file, without the EOF token */
+static int analysis_ntokens(void)
+{
+  int n = (ntokens < MAXTOKENBUFSIZE) ? ntokens : MAXTOKENBUFSIZE;
+  if ((n > 0) && (toks[n - 1].tokknd == TOK_EOF))
+  {
+    n -= 1;
+  }
+  return n;
+}
+
+
+/* coarse monotonic clock in ms - cheap enough to read every BUDGET_CLOCK_MASK tokens */
+static uint32_t analysis_now_ms(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+  return (uint32_t)(((uint64_t)ts.tv_sec * 1000u) + ((uint64_t)ts.tv_nsec / 1000000u));
+}
+
+
+static void analysis_emit_tokens(uint64_t content_hash)
+{
+  char cache_path[1024];
+  int n = analysis_ntokens();
+
+  tokcache_path(cache_path, sizeof(cache_path), emit_tokens_dir, s.file_path);
+  if (!tokcache_write(cache_path, content_hash, ppcond_hash(), s.file_size, toks, n))
+  {
+    fprintf(stderr, "WARNING: could not write token cache '%s'\n", cache_path);
+  }
+}
+
+
 static void analysis_new_file(void)
 {
   /* (Re-)Initialize checkers */
@@ -95,6 +409,12 @@ static void analysis_new_file(void)
   check_missing_void_init();
   check_misleading_var_name_init();
   check_smcln_after_ctrl_stmt_init();
+  check_project_decls_init();
+  typedefs_new_file();
+  if (metrics_enabled())
+  {
+    metrics_new_file();
+  }
 }
 
 
@@ -103,13 +423,47 @@ static void analysis_new_token(void)
   /* Pass the new token to each checker in turn */
   int tok_idx = (ntokens - 1);
 
+  /* Learn typedef'd type names before the checkers look at the token */
+  typedefs_new_token(toks, tok_idx);
+
   /* Disabled checks:
      None at the moment... */
   
-  check_assign_in_ctrl_stmt_new_token(&s, toks, tok_idx);  
-  check_missing_void_new_token(&s, toks, tok_idx);
-  check_misleading_var_name_new_token(&s, toks, tok_idx);
-  check_smcln_after_ctrl_stmt_new_token(&s, toks, tok_idx);
+  if (active_checks & CHK_BIT(CHK_ASSIGN_IN_CTRL_STMT))   { check_assign_in_ctrl_stmt_new_token(&s, toks, tok_idx);   }
+  if (active_checks & CHK_BIT(CHK_MISLEADING_VAR_NAME))   { check_misleading_var_name_new_token(&s, toks, tok_idx);   }
+  if (check_project_decls_enabled())                      { check_project_decls_new_token(&s, toks, tok_idx);         }
+  if (metrics_enabled())                                  { metrics_new_token(&s, toks, tok_idx);                     }
+
+  /* Checks with a whole-file variant - the per-token path is the reference implementation */
+  if (!use_vector_match)
+  {
+    if (active_checks & CHK_BIT(CHK_MISSING_VOID))          { check_missing_void_new_token(&s, toks, tok_idx);          }
+    if (active_checks & CHK_BIT(CHK_SMCLN_AFTER_CTRL_STMT)) { check_smcln_after_ctrl_stmt_new_token(&s, toks, tok_idx); }
+  }
+}
+
+
+/* Run the whole-file (vectorized) variants of checks over the packed token-types */
+static void analysis_whole_file(void)
+{
+  int n = (ntokens < MAXTOKENBUFSIZE) ? ntokens : MAXTOKENBUFSIZE;
+  if ((n > 0) && (toks[n - 1].tokknd == TOK_EOF))
+  {
+    n -= 1;
+  }
+
+  tokmatch_pack(toks, n, packed);
+
+  if (active_checks & CHK_BIT(CHK_MISSING_VOID))          { check_missing_void_file(&s, toks, packed, n);          }
+  if (active_checks & CHK_BIT(CHK_SMCLN_AFTER_CTRL_STMT)) { check_smcln_after_ctrl_stmt_file(&s, toks, packed, n); }
+}
+
+
+/* Pre-processor lines: queue headers from '#include "..."' when following includes */
+static void analysis_directive(struct lexer* l, const char* directive, uint32_t len)
+{
+  (void) l;
+  include_directive(s.file_path, directive, len);
 }
 
 
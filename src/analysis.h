@@ -1,12 +1,39 @@
 #ifndef __ANALYSIS_H__
 #define __ANALYSIS_H__
 
+#include "lexer.h"
+#include <stdio.h>
+
+
+
+/* Checker identifiers - used for tagging and selecting checks. */
+enum
+{
+  CHK_ASSIGN_IN_CTRL_STMT,
+  CHK_MISSING_VOID,
+  CHK_MISLEADING_VAR_NAME,
+  CHK_SMCLN_AFTER_CTRL_STMT,
+  CHK_PROJECT_DECLS,          /* whole project - reported at the end of the run */
+  CHK_CLONES,                 /* whole project - reported at the end of the run */
+  NCHECKS,
+};
+
+#define CHK_BIT(id)     (1u << (id))
+#define CHK_ALL         (CHK_BIT(NCHECKS) - 1)
+#define CHK_PER_FILE    (CHK_ALL & ~(CHK_BIT(CHK_PROJECT_DECLS) | CHK_BIT(CHK_CLONES)))
+
 
 
 void analysis_check_file(struct lexer* l, const char* src_file);
+void analysis_learn_types(struct lexer* l, const char* src_file);
+void analysis_check_loaded(struct lexer* l, const char* src_file, char* content, uint32_t size);
+int  analysis_check_stream(struct lexer* l, const char* src_file, FILE* in, uint64_t size);
+void analysis_set_prefilter(int enabled);
+void analysis_set_vector_match(int enabled);
+void analysis_set_token_cache(const char* emit_dir, const char* read_dir);
+void analysis_set_budget(uint32_t ms, uint32_t tokens);
 
 
 
 #endif /* __ANALYSIS_H__ */
 
-
@@ -0,0 +1,110 @@
+/*
+
+Arena allocator for per-file memory
+
+*/
+
+#include "arena.h"
+#include <assert.h>
+#include <stdlib.h>  /* malloc, free */
+
+
+#define ARENA_ALIGN        16
+#define ARENA_MIN_BLOCK    (64 * 1024)
+
+
+struct arena_block
+{
+  struct arena_block* next;     /* older, smaller block */
+  size_t size;
+  size_t used;
+  char   data[];
+};
+
+
+
+/* returns 0 if the heap is exhausted - the arena is unchanged then */
+void* arena_try_alloc(struct arena* a, size_t size)
+{
+  struct arena_block* b = a->head;
+
+  size = (size + (ARENA_ALIGN - 1)) & ~(size_t)(ARENA_ALIGN - 1);
+
+  if (    (b == 0)
+       || ((b->size - b->used) < size))
+  {
+    /* room for everything since the last reset, so the next reset can keep this block alone */
+    size_t block_size = a->in_use + size;
+    if ((b != 0) && (block_size < (2 * b->size)))
+    {
+      block_size = 2 * b->size;
+    }
+    if (block_size < ARENA_MIN_BLOCK)
+    {
+      block_size = ARENA_MIN_BLOCK;
+    }
+
+    b = malloc(sizeof(*b) + block_size);
+    if (b == 0)
+    {
+      return 0;
+    }
+    b->next = a->head;
+    b->size = block_size;
+    b->used = 0;
+    a->head = b;
+    a->nmallocs += 1;
+  }
+
+  void* p = &b->data[b->used];
+  b->used += size;
+  a->in_use += size;
+  if (a->in_use > a->peak)
+  {
+    a->peak = a->in_use;
+  }
+  return p;
+}
+
+
+void* arena_alloc(struct arena* a, size_t size)
+{
+  void* p = arena_try_alloc(a, size);
+  assert(p != 0);
+  return p;
+}
+
+
+/* forget all allocations - keeps the newest block, which is also the largest */
+void arena_reset(struct arena* a)
+{
+  if (a->head != 0)
+  {
+    struct arena_block* b = a->head->next;
+    while (b != 0)
+    {
+      struct arena_block* next = b->next;
+      free(b);
+      b = next;
+    }
+    a->head->next = 0;
+    a->head->used = 0;
+  }
+  a->in_use = 0;
+  a->nresets += 1;
+}
+
+
+void arena_free(struct arena* a)
+{
+  arena_reset(a);
+  free(a->head);
+  a->head = 0;
+}
+
+
+size_t arena_capacity(const struct arena* a)
+{
+  return (a->head != 0) ? a->head->size : 0;
+}
+
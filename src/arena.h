@@ -0,0 +1,43 @@
+#ifndef __ARENA_H__
+#define __ARENA_H__
+
+/*
+
+Arena allocator for per-file memory
+
+  Allocations are carved out of large blocks and never freed one by one - the whole arena
+  is reset between files. On reset only the largest block is kept, and a new block is
+  always large enough for everything allocated since the last reset. So once the arena
+  has seen the biggest file of a run, no more heap allocations are made.
+
+  Not thread-safe: use one arena per worker.
+
+*/
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+struct arena_block;
+
+struct arena
+{
+  struct arena_block* head;     /* block allocations are carved from - older blocks follow */
+  size_t   in_use;              /* bytes handed out since the last reset */
+  size_t   peak;                /* largest in_use seen                   */
+  uint64_t nmallocs;            /* heap allocations made by the arena    */
+  uint64_t nresets;
+};
+
+
+
+void* arena_alloc(struct arena* a, size_t size);
+void* arena_try_alloc(struct arena* a, size_t size);
+void  arena_reset(struct arena* a);
+void  arena_free(struct arena* a);
+size_t arena_capacity(const struct arena* a);
+
+
+
+#endif /* __ARENA_H__ */
+
@@ -0,0 +1,179 @@
+/*
+
+Baseline of known findings
+
+  - known:  open-addressing hash set of fingerprints, grown at 50% load.
+            Fingerprint 0 marks an empty slot, so a real 0 is stored as 1.
+
+*/
+
+#include "baseline.h"
+#include "hash.h"
+#include <assert.h>
+#include <stdio.h>   /* fopen, fgets, fprintf */
+#include <stdlib.h>  /* calloc, free, strtoull */
+#include <string.h>  /* strlen */
+
+
+static uint64_t*             known = 0;
+static uint32_t              known_size = 0;   /* number of slots - power of 2 */
+static uint32_t              known_count = 0;
+static int                   loaded = 0;
+static FILE*                 output = 0;       /* --write-baseline */
+
+
+
+static uint64_t* known_slot(uint64_t fingerprint)
+{
+  uint32_t i = (uint32_t)hash_mix64(fingerprint) & (known_size - 1);
+  while (    (known[i] != 0)
+          && (known[i] != fingerprint))
+  {
+    i = (i + 1) & (known_size - 1);
+  }
+  return &known[i];
+}
+
+static void known_add(uint64_t fingerprint)
+{
+  uint32_t i;
+
+  if ((known_count * 2) >= known_size)
+  {
+    /* grow and re-hash */
+    uint64_t* old = known;
+    uint32_t old_size = known_size;
+
+    known_size = (old_size == 0) ? 4096 : (2 * old_size);
+    known = calloc(known_size, sizeof(*known));
+    assert(known != 0);
+    for (i = 0; i < old_size; ++i)
+    {
+      if (old[i] != 0)
+      {
+        *known_slot(old[i]) = old[i];
+      }
+    }
+    free(old);
+  }
+
+  uint64_t* k = known_slot(fingerprint);
+  if (*k == 0)
+  {
+    *k = fingerprint;
+    known_count += 1;
+  }
+}
+
+
+int baseline_load(const char* baseline_path)
+{
+  char line[4096];
+  FILE* f = fopen(baseline_path, "r");
+  if (f == 0)
+  {
+    return 0;
+  }
+
+  while (fgets(line, sizeof(line), f) != 0)
+  {
+    char* end;
+    uint64_t fingerprint = strtoull(line, &end, 16);
+    if ((end != line) && (line[0] != '#'))
+    {
+      known_add((fingerprint != 0) ? fingerprint : 1);
+    }
+  }
+  fclose(f);
+
+  loaded = 1;
+  return 1;
+}
+
+
+int baseline_open_output(const char* baseline_path)
+{
+  output = fopen(baseline_path, "w");
+  return (output != 0);
+}
+
+int baseline_close_output(void)
+{
+  int success = 1;
+  if (output != 0)
+  {
+    success = (fclose(output) == 0);
+    output = 0;
+  }
+  return success;
+}
+
+
+/* are findings fingerprinted - to be filtered, or written to a new baseline? */
+int baseline_active(void)
+{
+  return loaded || (output != 0);
+}
+
+
+/* hash of checker, path and the tokens on line 'lineno' - 'toks' is ordered by line.
+   'occurrence' tells apart identical findings in one file, e.g. on two identical lines. */
+uint64_t baseline_fingerprint(int check_id, const char* file_path, uint32_t lineno, const struct token* toks, uint32_t ntoks, uint32_t occurrence)
+{
+  uint64_t h = HASH_FNV1A64_INIT;
+  uint32_t lo = 0;
+  uint32_t hi = ntoks;
+  uint8_t  id = (uint8_t)check_id;
+
+  h = hash_fnv1a64(&id, 1, h);
+  h = hash_fnv1a64(file_path, strlen(file_path) + 1, h);
+
+  /* first token on the line */
+  while (lo < hi)
+  {
+    uint32_t mid = (lo + hi) / 2;
+    if (toks[mid].lineno < lineno)
+    {
+      lo = mid + 1;
+    }
+    else
+    {
+      hi = mid;
+    }
+  }
+  for (; (lo < ntoks) && (toks[lo].lineno == lineno); ++lo)
+  {
+    h = hash_fnv1a64(toks[lo].symbol, toks[lo].symlen + 1, h); /* with terminator: 'a b' != 'ab' */
+  }
+  h = hash_fnv1a64(&occurrence, sizeof(occurrence), h);
+
+  return (h != 0) ? h : 1;
+}
+
+
+/* is the finding a known one? */
+int baseline_known(uint64_t fingerprint)
+{
+  return (known_count > 0) && (*known_slot(fingerprint) != 0);
+}
+
+
+void baseline_record(uint64_t fingerprint, const char* check_name, const char* file_path)
+{
+  if (output != 0)
+  {
+    fprintf(output, "%016llx %s %s\n", (unsigned long long)fingerprint, check_name, file_path);
+  }
+}
+
+
+void baseline_free(void)
+{
+  baseline_close_output();
+  free(known);
+  known = 0;
+  known_size = 0;
+  known_count = 0;
+  loaded = 0;
+}
+
@@ -0,0 +1,42 @@
+#ifndef __BASELINE_H__
+#define __BASELINE_H__
+
+/*
+
+Baseline of known findings
+
+  Each finding gets a fingerprint that survives unrelated edits: a hash of the checker,
+  the file path and the tokens on the finding's line - not the line number, and not the
+  whitespace or comments. A baseline file lists fingerprints of accepted findings; when
+  one is loaded, findings whose fingerprint is in it are not reported.
+
+  Identical findings in one file (e.g. on copies of a line) are told apart by their order:
+  the fingerprint of the n-th one includes n. So when a third copy appears, only one new
+  finding is reported.
+
+  Baseline file format - text, one finding per line:
+
+    <fingerprint, 16 hex digits> <check-name> <path>
+
+  Only the fingerprint is read back - the rest is there for humans reviewing the file.
+
+*/
+
+#include "lexer.h"
+#include <stdint.h>
+
+
+
+int      baseline_load(const char* baseline_path);
+int      baseline_open_output(const char* baseline_path);
+int      baseline_close_output(void);
+int      baseline_active(void);
+uint64_t baseline_fingerprint(int check_id, const char* file_path, uint32_t lineno, const struct token* toks, uint32_t ntoks, uint32_t occurrence);
+int      baseline_known(uint64_t fingerprint);
+void     baseline_record(uint64_t fingerprint, const char* check_name, const char* file_path);
+void     baseline_free(void);
+
+
+
+#endif /* __BASELINE_H__ */
+
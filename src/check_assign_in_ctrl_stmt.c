@@ -1,6 +1,8 @@
 #include "check_assign_in_ctrl_stmt.h"
+#include "analysis.h"
+#include "report.h"
+#include "intern.h"
 #include <stdio.h>
-#include <string.h> /* strncmp */
 
 
 static int paren_lvl = 0; /* balance of '(', ')' */
@@ -12,12 +14,21 @@ static int nsemicolons_s1 = 0;
 static int ncommas_s1 = 0;
 static int ncommas_defect = 0;
 static int found_defect = 0;
+static uint32_t sym_if = INTERN_NONE;     /* symbol ids of the keywords starting a control statement */
+static uint32_t sym_while = INTERN_NONE;
+static uint32_t sym_for = INTERN_NONE;
 
 
 
 /* reset balance counter when loading new file */
 void check_assign_in_ctrl_stmt_init(void)
 {
+  if (sym_if == INTERN_NONE)
+  {
+    sym_if = intern("if", 2);
+    sym_while = intern("while", 5);
+    sym_for = intern("for", 3);
+  }
   paren_lvl = 0;
   state = 0;
   if_while_for = 0;
@@ -31,12 +42,9 @@ void check_assign_in_ctrl_stmt_new_token(struct source_file* s, struct token* to
 {
   int i = tok_idx;
 
-  if (    (    (strncmp("if", toks[i].symbol, 2)    == 0)
-            && (toks[i].symlen == 2)        )
-       || (    (strncmp("while", toks[i].symbol, 5) == 0)
-            && (toks[i].symlen == 5)        )
-       || (    (strncmp("for", toks[i].symbol, 3)   == 0)
-            && (toks[i].symlen == 3)        ))
+  if (    (toks[i].symid == sym_if)
+       || (toks[i].symid == sym_while)
+       || (toks[i].symid == sym_for))
   {
     /*
     printf("toks[i].toktyp == %d\n", toks[i].toktyp);
@@ -46,12 +54,7 @@ void check_assign_in_ctrl_stmt_new_token(struct source_file* s, struct token* to
     state = 1;
     nsemicolons_s1 = 0;
     paren_lvl_s1 = paren_lvl;
-    switch (toks[i].symbol[0])
-    {
-      case 'i': if_while_for = 0; break;
-      case 'w': if_while_for = 1; break;
-      case 'f': if_while_for = 2; break;
-    }
+    if_while_for = (toks[i].symid == sym_if) ? 0 : ((toks[i].symid == sym_while) ? 1 : 2);
   }
   else if (state == 1)
   {
@@ -73,7 +76,7 @@ void check_assign_in_ctrl_stmt_new_token(struct source_file* s, struct token* to
         const char* str_ifw[] = { "if", "while", "for" };
         if (if_while_for != 2 || ((nsemicolons_s1 == 3) || (nsemicolons_s1 == 1))) /* for-loop? then check middle expression Y in 'FOR ( X ; Y ; Z )' */
         {
-          fprintf(stdout, "[%s:%d] (warning) Assignment in expression controlling program flow (%s-stmt).\n", s->file_path, toks[i - 1].lineno, str_ifw[if_while_for]);
+          report_warning(s, CHK_ASSIGN_IN_CTRL_STMT, toks[i - 1].lineno, "Assignment in expression controlling program flow (%s-stmt).", str_ifw[if_while_for]);
         }
       }
     }
@@ -10,66 +10,332 @@ Examples of correct naming:
 Examples of incorrect naming:
   int8_t   u8var      suggests U8, BUT is S8
   uint32_t u16var     suggests U16 but is U32
+  uint32_t a, u8b     declarator lists are followed ...
+  const uint8_t* u16p ... as are pointers
+
+Rules ('<prefix> <type>') are compiled into:
+  - has_rule[]: keyword-id of a type -> does any prefix refer to it?
+  - a prefix trie over identifier characters, whose terminal nodes hold the keyword-id of the type the prefix suggests.
+Typedef'd aliases are resolved to their base type, so the per-token cost is a table lookup
+unless a declaration of a type with a rule is in progress.
 
 */
 
 #include "check_misleading_var_name.h"
+#include "analysis.h"
+#include "report.h"
+#include "typedefs.h"
+#include <assert.h>
 #include <stdio.h>  /* fprintf */
-#include <string.h> /* strncmp */
+#include <stdlib.h> /* realloc */
+#include <string.h> /* strlen */
+
 
+#define NTRIECHARS  63   /* [0-9A-Za-z_] */
 
 
+/* Default rules */
 static const char* prefixes[]  = { "s8",     "s16",     "s32",     "s64",     "i8",     "i16",     "i32",     "i64",     "u8",      "u16",      "u32",      "u64",      };
 static const char* types[]     = { "int8_t", "int16_t", "int32_t", "int64_t", "int8_t", "int16_t", "int32_t", "int64_t", "uint8_t", "uint16_t", "uint32_t", "uint64_t", };
-static const int   ltypes[]    = { 6,        7,         7,         7,         6,        7,         7,         7,         6,         7,          7,          7,          };
-static const int   lprefixes[] = { 2,        3,         3,         3,         2,        3,         3,         3,         2,         3,          3,          3,          };
-static const int   nprefixes   = sizeof(prefixes)/sizeof(*prefixes);
-static const int   ntypes      = sizeof(types)/sizeof(*types);
+static const int   nrules      = sizeof(prefixes)/sizeof(*prefixes);
 
 
-void check_misleading_var_name_init(void)
+/* Declaration states */
+enum
+{
+  S_IDLE,             /* not in a declaration                                   */
+  S_DECLARATOR,       /* after the type (or a ','), expecting '*', qualifiers or name */
+  S_AFTER_NAME,       /* after the declarator name                              */
+  S_INITIALIZER,      /* skipping '= ...' or '[...]' up to the next ',' or ';'  */
+};
+
+
+struct trie_node
 {
-  /* No state to reset */
+  int32_t  next[NTRIECHARS]; /* child node index, 0 for none */
+  uint32_t kwid;             /* type suggested by the prefix ending here, or KWID_NONE */
+};
+
+
+static struct lexer*     lex = 0;
+static struct trie_node* trie = 0;
+static uint32_t          ntrie = 0;
+static uint32_t          maxtrie = 0;
+static uint8_t*          has_rule = 0;   /* indexed by keyword-id */
+static uint32_t          nhas_rule = 0;
+static int               ncustom_rules = 0;      /* rules loaded from file, on top of the defaults */
+
+static int      state = S_IDLE;
+static int      type_idx = 0;            /* token index of the type name        */
+static uint32_t type_kwid = KWID_NONE;   /* base type of current declaration    */
+static int      paren_lvl = 0;           /* balance of '(', ')'                 */
+static int      decl_paren_lvl = 0;      /* paren_lvl at the start of the declaration */
+static int      skip_lvl = 0;            /* nesting inside an initializer or array size */
+
+
+
+static int trie_char(char c)
+{
+  if ((c >= '0') && (c <= '9')) { return c - '0';       }
+  if ((c >= 'A') && (c <= 'Z')) { return c - 'A' + 10;  }
+  if ((c >= 'a') && (c <= 'z')) { return c - 'a' + 36;  }
+  if (c == '_')                 { return 62;            }
+  return -1;
 }
 
+static uint32_t trie_new_node(void)
+{
+  if (ntrie == maxtrie)
+  {
+    maxtrie = (maxtrie == 0) ? 64 : (2 * maxtrie);
+    trie = realloc(trie, maxtrie * sizeof(*trie));
+    assert(trie != 0);
+  }
+  memset(&trie[ntrie], 0, sizeof(*trie));
+  trie[ntrie].kwid = KWID_NONE;
+  return ntrie++;
+}
 
 
-void check_misleading_var_name_new_token(struct source_file* s, struct token* toks, int tok_idx)
+/* add rule: variables named '<prefix>...' should be of type 'type_name' */
+static void add_rule(const char* prefix, const char* type_name, uint32_t type_len)
+{
+  uint32_t kwid = typedefs_base(lexer_add_type(lex, type_name, type_len));
+  uint32_t node = 0;
+  int i;
+
+  if (ntrie == 0)
+  {
+    trie_new_node(); /* root */
+  }
+
+  for (i = 0; prefix[i] != 0; ++i)
+  {
+    int c = trie_char(prefix[i]);
+    if (c < 0)
+    {
+      fprintf(stderr, "WARNING: invalid name prefix '%s'\n", prefix);
+      return;
+    }
+    if (trie[node].next[c] == 0)
+    {
+      uint32_t child = trie_new_node();
+      trie[node].next[c] = (int32_t)child;
+    }
+    node = (uint32_t)trie[node].next[c];
+  }
+  trie[node].kwid = kwid;
+
+  if (kwid >= nhas_rule)
+  {
+    uint32_t n = nhas_rule;
+    nhas_rule = kwid + 64;
+    has_rule = realloc(has_rule, nhas_rule);
+    assert(has_rule != 0);
+    memset(has_rule + n, 0, nhas_rule - n);
+  }
+  has_rule[kwid] = 1;
+}
+
+
+/* longest rule prefix of 'name' not followed by a digit - returns the suggested type, or KWID_NONE */
+static uint32_t trie_lookup(const char* name)
 {
-  /* struct source_file* s is unused */
-  (void) s;
+  uint32_t found = KWID_NONE;
+  uint32_t node = 0;
+  int i;
 
-  /* we need at least two tokens to run this check */
-  if (tok_idx < 1)
+  for (i = 0; ; ++i)
   {
-    return;
+    if (    (trie[node].kwid != KWID_NONE)
+         && (    (name[i] < '0')  /* next char in name must not be a digit, 'u8' does not suggest 'u80x' */
+              || (name[i] > '9')))
+    {
+      found = trie[node].kwid;
+    }
+    int c = trie_char(name[i]);
+    if ((c < 0) || (trie[node].next[c] == 0))
+    {
+      break;
+    }
+    node = (uint32_t)trie[node].next[c];
   }
+  return found;
+}
 
-  const char* var_type = toks[tok_idx - 1].symbol;
-  const char* var_name = toks[tok_idx].symbol;
-  int i, j;
 
-  /* check if previous token was a type and current token has a name that hints at a type: */
-  for (i = 0; i < ntypes; ++i)
+void check_misleading_var_name_setup(struct lexer* l)
+{
+  int i;
+
+  lex = l;
+  for (i = 0; i < nrules; ++i)
   {
-    /* found a type we have a rule for: */
-    if (strncmp(var_type, types[i], ltypes[i]) == 0)
+    add_rule(prefixes[i], types[i], (uint32_t)strlen(types[i]));
+  }
+}
+
+void check_misleading_var_name_free(void)
+{
+  free(trie);
+  free(has_rule);
+  trie = 0;
+  has_rule = 0;
+  ntrie = 0;
+  maxtrie = 0;
+  nhas_rule = 0;
+}
+
+
+int check_misleading_var_name_load_rules(const char* file_path)
+{
+  char line[1024];
+  char prefix[256];
+  char type_name[256];
+  FILE* f = fopen(file_path, "r");
+  if (f == 0)
+  {
+    return 0;
+  }
+
+  /* one rule per line: '<prefix> <type>' - lines starting with '#' are comments */
+  while (fgets(line, sizeof(line), f) != 0)
+  {
+    if (    (line[0] != '#')
+         && (sscanf(line, "%255s %255s", prefix, type_name) == 2))
     {
-      for (j = 0; j < nprefixes; ++j)
+      add_rule(prefix, type_name, (uint32_t)strlen(type_name));
+      ncustom_rules += 1;
+    }
+  }
+  fclose(f);
+
+  return 1;
+}
+
+
+int check_misleading_var_name_custom_rules(void)
+{
+  return ncustom_rules;
+}
+
+
+void check_misleading_var_name_init(void)
+{
+  state = S_IDLE;
+  paren_lvl = 0;
+}
+
+
+static void check_name(struct source_file* s, struct token* toks, int tok_idx)
+{
+  uint32_t suggested = trie_lookup(toks[tok_idx].symbol);
+
+  if (    (suggested != KWID_NONE)
+       && (suggested != type_kwid))
+  {
+    report_warning(s, CHK_MISLEADING_VAR_NAME, toks[tok_idx].lineno, "Variable of type '%s' was named '%s'.", toks[type_idx].symbol, toks[tok_idx].symbol);
+  }
+}
+
+
+void check_misleading_var_name_new_token(struct source_file* s, struct token* toks, int tok_idx)
+{
+  struct token* t = &toks[tok_idx];
+
+  switch (state)
+  {
+    case S_IDLE:
+    {
+      /* a type with a rule starts a declaration */
+      if (t->kwid != KWID_NONE)
       {
-        /* when i == j, we have the correct type prefix -> skip that case */
-        if (    (j != i)
-             && (strncmp(var_name, prefixes[j], lprefixes[j]) == 0) /* does var_name match a known prefix? */
-             && (strncmp(types[i], types[j], ltypes[i]) != 0)       /* signed types can be prefixed I and S, check this here */
-             && (    (var_name[lprefixes[j]+1] < '0')               /* next char in var_name must be a digit to match */
-                  || (var_name[lprefixes[j]+1] > '9')))
+        uint32_t kwid = typedefs_base(t->kwid);
+        if (    (kwid < nhas_rule)
+             && has_rule[kwid])
         {
-          fprintf(stdout, "[%s:%d] (warning) Variable of type '%s' was named '%s'.\n", s->file_path, toks[tok_idx].lineno, var_type, var_name);
-          return; /* maximum one warning pr. token */
+          state = S_DECLARATOR;
+          type_idx = tok_idx;
+          type_kwid = kwid;
+          decl_paren_lvl = paren_lvl;
         }
       }
-    }
+    } break;
+
+    case S_DECLARATOR:
+    {
+      if (t->tokknd == TOK_IDENTIFIER)
+      {
+        check_name(s, toks, tok_idx);
+        state = S_AFTER_NAME;
+      }
+      else if (    (t->toktyp != OP_MULTIPLY)
+                && (t->toktyp != KW_CONST)
+                && (t->toktyp != KW_VOLATILE)
+                && (t->toktyp != KW_RESTRICT))
+      {
+        state = S_IDLE; /* cast, sizeof(type), function pointer, ... */
+      }
+    } break;
+
+    case S_AFTER_NAME:
+    {
+      if (    (t->toktyp == OP_ASSIGN)
+           || (t->toktyp == OP_LBRACKET))
+      {
+        state = S_INITIALIZER;
+        skip_lvl = (t->toktyp == OP_LBRACKET);
+      }
+      else if (    (t->toktyp == OP_COMMA)
+                && (decl_paren_lvl == 0))
+      {
+        state = S_DECLARATOR; /* next declarator in 'T a, b;' - but not in parameter lists */
+      }
+      else
+      {
+        state = S_IDLE;
+      }
+    } break;
+
+    case S_INITIALIZER:
+    {
+      if (    (t->toktyp == OP_LPAREN)
+           || (t->toktyp == OP_LBRACE)
+           || (t->toktyp == OP_LBRACKET))
+      {
+        skip_lvl += 1;
+      }
+      else if (    (t->toktyp == OP_RPAREN)
+                || (t->toktyp == OP_RBRACE)
+                || (t->toktyp == OP_RBRACKET))
+      {
+        skip_lvl -= 1;
+        if (skip_lvl < 0)
+        {
+          state = S_IDLE; /* closing a parameter list */
+        }
+        else if ((skip_lvl == 0) && (t->toktyp == OP_RBRACKET))
+        {
+          state = S_AFTER_NAME; /* 'T name[N]' may be followed by '=', ',' or ';' */
+        }
+      }
+      else if (skip_lvl == 0)
+      {
+        if (t->toktyp == OP_SEMICOLON)
+        {
+          state = S_IDLE;
+        }
+        else if (t->toktyp == OP_COMMA)
+        {
+          state = (decl_paren_lvl == 0) ? S_DECLARATOR : S_IDLE;
+        }
+      }
+    } break;
   }
-}
 
+       if (t->toktyp == OP_LPAREN) { paren_lvl += 1; }
+  else if (t->toktyp == OP_RPAREN) { paren_lvl -= 1; }
+
+  if (paren_lvl < 0) { paren_lvl = 0; }
+}
 
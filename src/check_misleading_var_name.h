@@ -7,6 +7,10 @@
 
 
 
+void check_misleading_var_name_setup(struct lexer* l);
+void check_misleading_var_name_free(void);
+int  check_misleading_var_name_load_rules(const char* file_path);
+int  check_misleading_var_name_custom_rules(void);
 void check_misleading_var_name_init(void);
 void check_misleading_var_name_new_token(struct source_file* s, struct token* toks, int tok_idx);
 
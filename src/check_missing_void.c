@@ -1,4 +1,7 @@
 #include "check_missing_void.h"
+#include "analysis.h"
+#include "report.h"
+#include "tokmatch.h"
 #include <stdio.h>
 
 
@@ -32,7 +35,7 @@ void check_missing_void_new_token(struct source_file* s, struct token* toks, int
               || (toks[i-3].tokknd == TOK_IDENTIFIER)))
     {
       const char* func_name = toks[i-2].symbol;
-      fprintf(stdout, "[%s:%d] (warning) Use '%s(void)' instead of '%s()' in function-declarations.\n", s->file_path, toks[i].lineno, func_name, func_name );
+      report_warning(s, CHK_MISSING_VOID, toks[i].lineno, "Use '%s(void)' instead of '%s()' in function-declarations.", func_name, func_name );
     }
   }
 
@@ -47,5 +50,29 @@ void check_missing_void_new_token(struct source_file* s, struct token* toks, int
 }
 
 
+/* Whole-file variant of the check above: search the packed token types for '( )' and verify the candidates. */
+void check_missing_void_file(struct source_file* s, struct token* toks, const uint8_t* packed, int ntoks)
+{
+  static const uint8_t pattern[] = { OP_LPAREN, OP_RPAREN };
+  struct tokmatch_depth d;
+  int i = 0;
 
+  tokmatch_depth_init(&d);
+  while ((i = tokmatch_find(packed, ntoks, i, pattern, 2)) >= 0)
+  {
+    tokmatch_depth_advance(&d, packed, i);
+    if (    (i >= 2)
+         && (d.brace_lvl == 0)
+         && (d.paren_lvl == 0)
+         && (toks[i-1].tokknd == TOK_IDENTIFIER)
+         && (    (toks[i-2].tokknd == TOK_KEYWORD)
+              || (toks[i-2].tokknd == TOK_OPERATOR)
+              || (toks[i-2].tokknd == TOK_IDENTIFIER)))
+    {
+      const char* func_name = toks[i-1].symbol;
+      report_warning(s, CHK_MISSING_VOID, toks[i+1].lineno, "Use '%s(void)' instead of '%s()' in function-declarations.", func_name, func_name );
+    }
+    i += 1;
+  }
+}
 
@@ -7,6 +7,7 @@
 
 void check_missing_void_init(void);
 void check_missing_void_new_token(struct source_file* s, struct token* toks, int tok_idx);
+void check_missing_void_file(struct source_file* s, struct token* toks, const uint8_t* packed, int ntoks);
 
 
 
@@ -0,0 +1,479 @@
+/*
+
+Whole-project checks on declarations
+
+While files are analyzed, file-scope declarations are collected into the symbol index:
+  int f(void);            function, declared with '(void)'
+  int f() { ... }         function, declared with '()'
+  extern uint16_t count;  global variable and its type - pointer depth included
+
+'static' and 'typedef' declarations are file-local, so they are not collected.
+
+At the end of the run, the records of each name are compared:
+  - functions declared 'f(void)' somewhere and 'f()' elsewhere
+  - globals declared with different types, e.g. 'uint16_t' in a header and 'uint32_t' in the source
+
+Types are encoded in 26 bits: typedef'd type names as the interned name of their base type,
+built-in types as a mask of the keywords they are made of ('unsigned long int').
+
+*/
+
+#include "check_project_decls.h"
+#include "analysis.h"
+#include "intern.h"
+#include "report.h"
+#include "symindex.h"
+#include "typedefs.h"
+#include <assert.h>
+#include <stdarg.h> /* va_list */
+#include <stdio.h>  /* snprintf */
+#include <stdlib.h> /* realloc, qsort, free */
+#include <string.h> /* strcmp, strlen */
+
+
+/* record kinds */
+enum
+{
+  SYM_FUNC_EMPTY = 1,   /* f()      */
+  SYM_FUNC_VOID,        /* f(void)  */
+  SYM_GLOBAL,           /* global variable - data is the type */
+};
+
+/* built-in type keywords, as bits of a type code */
+enum
+{
+  TB_CHAR     = 0x001,
+  TB_SHORT    = 0x002,
+  TB_INT      = 0x004,
+  TB_LONG     = 0x008,
+  TB_LONGLONG = 0x010,
+  TB_FLOAT    = 0x020,
+  TB_DOUBLE   = 0x040,
+  TB_SIGNED   = 0x080,
+  TB_UNSIGNED = 0x100,
+  TB_VOID     = 0x200,
+};
+
+#define TYPE_BUILTIN     0x2000000u   /* type code is a TB_-mask, else an intern() id */
+#define TYPE_MASK        0x3FFFFFFu
+#define TYPE_PTR_SHIFT   26           /* 2 bits of pointer depth above the type code */
+
+
+/* finding, held until all are sorted by path and line */
+struct project_finding
+{
+  const char* file_path;
+  uint32_t    lineno;
+  char*       message;
+};
+
+
+static int enabled = 0;
+static uint32_t sym_int = INTERN_NONE;   /* symbol id of 'int' - other KW_INT are 'uint16_t' etc. */
+
+/* declaration state - reset for each file */
+static uint32_t file_id = INTERN_NONE;
+static int      brace_lvl = 0;
+static int      paren_lvl = 0;
+static int      fn_body = 0;       /* the open brace at level 0 is a function body */
+static int      skip_decl = 0;     /* static, typedef: local to the file */
+static int      untyped = 0;       /* aggregate or unknown type - not compared */
+static uint32_t type_code = 0;     /* 0 while no type has been seen */
+static uint32_t ptr_depth = 0;
+static int      in_init = 0;       /* skipping an initializer */
+
+static struct project_finding* findings = 0;
+static uint32_t nfindings = 0;
+static uint32_t maxfindings = 0;
+
+
+
+void check_project_decls_enable(int enable)
+{
+  enabled = enable;
+}
+
+int check_project_decls_enabled(void)
+{
+  return enabled;
+}
+
+
+static void reset_decl(void)
+{
+  skip_decl = 0;
+  untyped = 0;
+  type_code = 0;
+  ptr_depth = 0;
+  in_init = 0;
+}
+
+void check_project_decls_init(void)
+{
+  if (sym_int == INTERN_NONE)
+  {
+    sym_int = intern("int", 3);
+  }
+  file_id = INTERN_NONE;
+  brace_lvl = 0;
+  paren_lvl = 0;
+  fn_body = 0;
+  reset_decl();
+}
+
+
+/* add a type keyword to the type code of the current declaration */
+static void add_type_token(const struct token* t)
+{
+  uint32_t bit = 0;
+  switch (t->toktyp)
+  {
+    case KW_CHAR:     bit = TB_CHAR;     break;
+    case KW_SHORT:    bit = TB_SHORT;    break;
+    case KW_INT:
+    {
+      if (t->symid != sym_int)
+      {
+        type_code = t->symid & TYPE_MASK & ~TYPE_BUILTIN; /* 'uint16_t' etc. */
+        return;
+      }
+      bit = TB_INT;
+    } break;
+    case KW_LONG:     bit = (type_code & TB_LONG) ? TB_LONGLONG : TB_LONG; break;
+    case KW_FLOAT:    bit = TB_FLOAT;    break;
+    case KW_DOUBLE:   bit = TB_DOUBLE;   break;
+    case KW_SIGNED:   bit = TB_SIGNED;   break;
+    case KW_UNSIGNED: bit = TB_UNSIGNED; break;
+    case KW_VOID:     bit = TB_VOID;     break;
+    case KW_TYPE_NAME:
+    {
+      const char* base = typedefs_base_symbol(t);
+      type_code = intern(base, (uint32_t)strlen(base)) & TYPE_MASK & ~TYPE_BUILTIN;
+      return;
+    }
+    default:
+      return;
+  }
+  type_code = (type_code & TYPE_BUILTIN) ? (type_code | bit) : (TYPE_BUILTIN | bit);
+}
+
+
+/* 'unsigned long int' == 'unsigned long', 'signed int' == 'int' */
+static uint32_t normalize_type(uint32_t code)
+{
+  if (code & TYPE_BUILTIN)
+  {
+    if (code & (TB_SHORT | TB_LONG))
+    {
+      code &= ~(uint32_t)TB_INT;
+    }
+    if (!(code & TB_CHAR))
+    {
+      code &= ~(uint32_t)TB_SIGNED;
+    }
+  }
+  return code;
+}
+
+
+static void add_record(const struct source_file* s, const struct token* name, uint32_t kind, uint32_t data)
+{
+  if (file_id == INTERN_NONE)
+  {
+    file_id = intern(s->file_path, (uint32_t)strlen(s->file_path));
+  }
+  symindex_add(name->symid, file_id, name->lineno, SYM_INFO(kind, data));
+}
+
+
+void check_project_decls_new_token(struct source_file* s, struct token* toks, int tok_idx)
+{
+  const struct token* t = &toks[tok_idx];
+  int i = tok_idx;
+
+  /* only file scope is of interest */
+  if (brace_lvl > 0)
+  {
+         if (t->toktyp == OP_LBRACE) { brace_lvl += 1; }
+    else if (t->toktyp == OP_RBRACE) { brace_lvl -= 1; }
+    if ((brace_lvl == 0) && fn_body)
+    {
+      fn_body = 0;
+      reset_decl(); /* function definitions end with their body - not with a ';' */
+    }
+    return;
+  }
+
+  switch (t->toktyp)
+  {
+    case OP_LBRACE:
+    {
+      fn_body = (i > 0) && (toks[i-1].toktyp == OP_RPAREN);
+      brace_lvl = 1;
+    } break;
+    case OP_RBRACE:
+      break;
+    case OP_LPAREN:
+    {
+      paren_lvl += 1;
+    } break;
+    case OP_RPAREN:
+    {
+      paren_lvl -= 1;
+      if (paren_lvl < 0)
+      {
+        paren_lvl = 0;
+      }
+      else if (    (paren_lvl == 0)
+                && !skip_decl
+                && !in_init)   /* 'T x = sizeof(int) * get();' calls get() */
+      {
+        /* 'T name()' or 'T name(void)' */
+        int empty = (i >= 3)
+                 && (toks[i-1].toktyp == OP_LPAREN)
+                 && (toks[i-2].tokknd == TOK_IDENTIFIER);
+        int with_void = (i >= 4)
+                     && (toks[i-1].toktyp == KW_VOID)
+                     && (toks[i-2].toktyp == OP_LPAREN)
+                     && (toks[i-3].tokknd == TOK_IDENTIFIER);
+        const struct token* name = empty ? &toks[i-2] : &toks[i-3];
+        if (    (empty || with_void)
+             && (    (name[-1].tokknd == TOK_KEYWORD)
+                  || (name[-1].tokknd == TOK_IDENTIFIER)
+                  || (name[-1].toktyp == OP_MULTIPLY)))
+        {
+          add_record(s, name, empty ? SYM_FUNC_EMPTY : SYM_FUNC_VOID, 0);
+        }
+        type_code = 0; /* a function, not a global */
+      }
+    } break;
+    case OP_SEMICOLON:
+    case OP_COMMA:
+    case OP_ASSIGN:
+    case OP_LBRACKET:
+    {
+      if (paren_lvl > 0)
+      {
+        break;
+      }
+      /* end of a declarator: 'T name;', 'T name, ...', 'T name = ...', 'T name[...]' */
+      if (    !in_init
+           && !skip_decl
+           && !untyped
+           && (type_code != 0)
+           && (i >= 1)
+           && (toks[i-1].tokknd == TOK_IDENTIFIER))
+      {
+        uint32_t depth = (ptr_depth > 3) ? 3 : ptr_depth;
+        add_record(s, &toks[i-1], SYM_GLOBAL, (depth << TYPE_PTR_SHIFT) | normalize_type(type_code));
+      }
+           if (t->toktyp == OP_SEMICOLON) { reset_decl(); }
+      else if (t->toktyp == OP_COMMA)     { in_init = 0; ptr_depth = 0; }
+      else if (t->toktyp == OP_ASSIGN)    { in_init = 1; }
+    } break;
+    case OP_MULTIPLY:
+    {
+      if ((paren_lvl == 0) && !in_init)
+      {
+        ptr_depth += 1;
+      }
+    } break;
+    case KW_STATIC:
+    case KW_TYPEDEF:
+    {
+      skip_decl = 1;
+    } break;
+    case KW_STRUCT:  /* aggregate types are not compared */
+    case KW_UNION:
+    case KW_ENUM:
+    {
+      untyped = 1;
+    } break;
+    default:
+    {
+      if (    (paren_lvl == 0)
+           && !in_init
+           && (t->tokknd == TOK_KEYWORD))
+      {
+        add_type_token(t);
+      }
+      else if (    (paren_lvl == 0)
+                && !in_init
+                && (t->tokknd == TOK_IDENTIFIER)
+                && (i >= 1)
+                && (toks[i-1].tokknd == TOK_IDENTIFIER))
+      {
+        untyped = 1; /* 'unknown_t name' - a type we cannot compare */
+      }
+    } break;
+  }
+}
+
+
+
+/* ================================================== */
+/* End of run:                                        */
+/* ================================================== */
+
+static void type_string(uint32_t data, char* out, size_t out_size)
+{
+  static const char* words[] = { "char", "short", "int", "long", "long", "float", "double", "signed", "unsigned", "void" };
+  static const uint32_t order[] = { 7, 8, 3, 4, 1, 0, 2, 5, 6, 9 };  /* 'unsigned long long int' */
+  uint32_t code = data & TYPE_MASK;
+  uint32_t depth = data >> TYPE_PTR_SHIFT;
+  size_t len = 0;
+  uint32_t i;
+
+  out[0] = 0;
+  if (code & TYPE_BUILTIN)
+  {
+    for (i = 0; i < sizeof(order) / sizeof(*order); ++i)
+    {
+      if ((code & (1u << order[i])) && (len < out_size))
+      {
+        len += (size_t)snprintf(out + len, out_size - len, "%s%s", (len > 0) ? " " : "", words[order[i]]);
+      }
+    }
+  }
+  else
+  {
+    len += (size_t)snprintf(out, out_size, "%s", intern_str(code));
+  }
+  for (i = 0; (i < depth) && (len + 1 < out_size); ++i)
+  {
+    out[len++] = '*';
+    out[len] = 0;
+  }
+}
+
+
+static void add_finding(const struct symbol_record* at, const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+
+static void add_finding(const struct symbol_record* at, const char* fmt, ...)
+{
+  char msg[1024];
+  va_list args;
+
+  va_start(args, fmt);
+  vsnprintf(msg, sizeof(msg), fmt, args);
+  va_end(args);
+
+  if (nfindings == maxfindings)
+  {
+    maxfindings = (maxfindings == 0) ? 64 : (2 * maxfindings);
+    findings = realloc(findings, maxfindings * sizeof(*findings));
+    assert(findings != 0);
+  }
+  findings[nfindings].file_path = intern_str(at->file_id);
+  findings[nfindings].lineno    = at->lineno;
+  findings[nfindings].message   = malloc(strlen(msg) + 1);
+  assert(findings[nfindings].message != 0);
+  strcpy(findings[nfindings].message, msg);
+  nfindings += 1;
+}
+
+
+static int is_header(uint32_t path_id)
+{
+  const char* path = intern_str(path_id);
+  size_t len = strlen(path);
+  return (len >= 2) && (strcmp(path + len - 2, ".h") == 0);
+}
+
+
+/* compare all declarations of one name */
+static void check_group(const struct symbol_record* recs, uint32_t nrecs)
+{
+  const struct symbol_record* with_void = 0;
+  const struct symbol_record* global = 0;
+  uint32_t i;
+
+  /* reference declarations: the first '(void)' one, and the first global - from a header, if there is one */
+  for (i = 0; i < nrecs; ++i)
+  {
+    uint32_t kind = SYM_KIND(recs[i].info);
+    if ((kind == SYM_FUNC_VOID) && (with_void == 0))
+    {
+      with_void = &recs[i];
+    }
+    if (    (kind == SYM_GLOBAL)
+         && (    (global == 0)
+              || (!is_header(global->file_id) && is_header(recs[i].file_id))))
+    {
+      global = &recs[i];
+    }
+  }
+
+  for (i = 0; i < nrecs; ++i)
+  {
+    const char* name = intern_str(recs[i].name_id);
+    uint32_t kind = SYM_KIND(recs[i].info);
+
+    if ((kind == SYM_FUNC_EMPTY) && (with_void != 0))
+    {
+      add_finding(&recs[i], "Function '%s' is declared '%s(void)' at [%s:%u], but '%s()' here.",
+                  name, name, intern_str(with_void->file_id), with_void->lineno, name);
+    }
+    else if (    (kind == SYM_GLOBAL)
+              && (global != 0)
+              && (SYM_DATA(recs[i].info) != SYM_DATA(global->info)))
+    {
+      char here[256];
+      char there[256];
+      type_string(SYM_DATA(recs[i].info), here, sizeof(here));
+      type_string(SYM_DATA(global->info), there, sizeof(there));
+      add_finding(&recs[i], "Global '%s' is declared as '%s' here, but as '%s' at [%s:%u].",
+                  name, here, there, intern_str(global->file_id), global->lineno);
+    }
+  }
+}
+
+
+static int finding_cmp(const void* a, const void* b)
+{
+  const struct project_finding* fa = (const struct project_finding*)a;
+  const struct project_finding* fb = (const struct project_finding*)b;
+  int c = strcmp(fa->file_path, fb->file_path);
+  if (c != 0)                   { return c; }
+  if (fa->lineno != fb->lineno) { return (fa->lineno < fb->lineno) ? -1 : 1; }
+  return strcmp(fa->message, fb->message);
+}
+
+
+/* Run the whole-project checks and report, by path and line. 'file_idx' tags the findings
+   in result files - after the files of the input list. */
+void check_project_decls_report(uint32_t file_idx)
+{
+  struct source_file s;
+  uint32_t i;
+
+  symindex_walk(check_group);
+  qsort(findings, nfindings, sizeof(*findings), finding_cmp);
+
+  memset(&s, 0, sizeof(s));
+  for (i = 0; i < nfindings; ++i)
+  {
+    if (    (i == 0)
+         || (strcmp(findings[i].file_path, findings[i-1].file_path) != 0))
+    {
+      if (i > 0)
+      {
+        report_end_file(&s, 0, 0);
+      }
+      s.file_path = (char*)findings[i].file_path;
+      report_begin_file(file_idx, s.file_path);
+    }
+    report_warning(&s, CHK_PROJECT_DECLS, findings[i].lineno, "%s", findings[i].message);
+    free(findings[i].message);
+  }
+  if (nfindings > 0)
+  {
+    report_end_file(&s, 0, 0);
+  }
+
+  free(findings);
+  findings = 0;
+  nfindings = 0;
+  maxfindings = 0;
+}
+
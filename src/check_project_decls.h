@@ -0,0 +1,17 @@
+#ifndef __CHECK_PROJECT_DECLS_H__
+#define __CHECK_PROJECT_DECLS_H__
+
+
+#include "lexer.h"
+#include "source.h"
+
+void check_project_decls_enable(int enable);
+int  check_project_decls_enabled(void);
+void check_project_decls_init(void);
+void check_project_decls_new_token(struct source_file* s, struct token* toks, int tok_idx);
+void check_project_decls_report(uint32_t file_idx);
+
+
+
+#endif /* __CHECK_PROJECT_DECLS_H__ */
+
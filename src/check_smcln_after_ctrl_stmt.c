@@ -1,4 +1,7 @@
 #include "check_smcln_after_ctrl_stmt.h"
+#include "analysis.h"
+#include "report.h"
+#include "tokmatch.h"
 #include <stdio.h>
 
 
@@ -96,7 +99,7 @@ void check_smcln_after_ctrl_stmt_new_token(struct source_file* s, struct token*
     if (toks[i].toktyp == OP_LBRACE)
     {
       const char* str_ifw[] = { "if", "while", "for" };
-      fprintf(stdout, "[%s:%d] (warning) Suspicious semicolon after %s-stmt.\n", s->file_path, toks[i - 1].lineno, str_ifw[if_while_for] );
+      report_warning(s, CHK_SMCLN_AFTER_CTRL_STMT, toks[i - 1].lineno, "Suspicious semicolon after %s-stmt.", str_ifw[if_while_for] );
     }
     _reset();
   }
@@ -114,5 +117,65 @@ void check_smcln_after_ctrl_stmt_new_token(struct source_file* s, struct token*
 }
 
 
+/* index of the token matching the closer at 'idx', searching backwards - or -1 */
+static int match_backwards(const uint8_t* packed, int idx, uint8_t open, uint8_t close)
+{
+  int lvl = 0;
+  for (; idx >= 0; --idx)
+  {
+         if (packed[idx] == close) { lvl += 1; }
+    else if (packed[idx] == open)  { lvl -= 1; }
+    if (lvl == 0)
+    {
+      return idx;
+    }
+  }
+  return -1;
+}
+
+
+/* Whole-file variant of the check above: search the packed token types for ') ; {' and verify
+   that the parenthesis belongs to an if/for/while - but not to the 'while' of a 'do { } while (...);' */
+void check_smcln_after_ctrl_stmt_file(struct source_file* s, struct token* toks, const uint8_t* packed, int ntoks)
+{
+  static const uint8_t pattern[] = { OP_RPAREN, OP_SEMICOLON, OP_LBRACE };
+  int i = 0;
+
+  while ((i = tokmatch_find(packed, ntoks, i, pattern, 3)) >= 0)
+  {
+    int lparen = match_backwards(packed, i, OP_LPAREN, OP_RPAREN);
+    int kw = lparen - 1;
+    if (    (kw >= 0)
+         && (    (packed[kw] == KW_IF)
+              || (packed[kw] == KW_FOR)
+              || (packed[kw] == KW_WHILE)))
+    {
+      int j;
+      int valid = 1;
 
+      /* a ';' inside the parens ends an if/while-stmt early */
+      for (j = lparen + 1; (j < i) && (packed[kw] != KW_FOR); ++j)
+      {
+        valid &= (packed[j] != OP_SEMICOLON);
+      }
+
+      /* 'do { ... } while (...);' */
+      if (    (packed[kw] == KW_WHILE)
+           && (kw > 0)
+           && (packed[kw - 1] == OP_RBRACE))
+      {
+        int lbrace = match_backwards(packed, kw - 1, OP_LBRACE, OP_RBRACE);
+        valid &= !((lbrace > 0) && (packed[lbrace - 1] == KW_DO));
+      }
+
+      if (valid)
+      {
+        const char* str_ifw[] = { "if", "while", "for" };
+        int if_while_for = (packed[kw] == KW_IF) ? 0 : (packed[kw] == KW_WHILE) ? 1 : 2;
+        report_warning(s, CHK_SMCLN_AFTER_CTRL_STMT, toks[i + 1].lineno, "Suspicious semicolon after %s-stmt.", str_ifw[if_while_for] );
+      }
+    }
+    i += 1;
+  }
+}
 
@@ -8,6 +8,7 @@
 
 void check_smcln_after_ctrl_stmt_init(void);
 void check_smcln_after_ctrl_stmt_new_token(struct source_file* s, struct token* toks, int tok_idx);
+void check_smcln_after_ctrl_stmt_file(struct source_file* s, struct token* toks, const uint8_t* packed, int ntoks);
 
 
 
@@ -0,0 +1,714 @@
+/*
+
+Token-level clone detection
+
+  - fingerprint:  hash of k normalized tokens, the file and the first token position.
+  - spill:        per shard, a buffer of fingerprints and a temporary file it is flushed to.
+                  The shard is the top bits of the hash, so equal hashes meet in one shard.
+  - pairs:        two locations with an equal fingerprint, ordered (file, position).
+                  Pairs with the same files and the same distance between the positions,
+                  close enough to each other, are one clone.
+  - token spill:  the normalized code and line of every token, per file, in a temporary
+                  file. Fingerprints only mark where a clone is - it is extended over the
+                  tokens of both files to its real length before it is tested and reported.
+
+*/
+
+#include "clones.h"
+#include "analysis.h"
+#include "hash.h"
+#include "intern.h"
+#include "report.h"
+#include <assert.h>
+#include <stdio.h>    /* tmpfile, fwrite, fread */
+#include <stdlib.h>   /* malloc, realloc, qsort, bsearch, free */
+#include <string.h>   /* strlen, strcmp */
+#include <unistd.h>   /* pread */
+
+
+#define DEFAULT_MIN_TOKENS   64
+#define MIN_MIN_TOKENS       8
+#define SPILL_SHARD_BITS     6
+#define SPILL_NSHARDS        (1u << SPILL_SHARD_BITS)
+#define SPILL_BUF_LEN        1024   /* fingerprints buffered per shard before they are written out */
+#define MAX_GROUP            16     /* a fingerprint found more often is only paired with its first occurrence */
+#define ROLL_BASE            0x9E3779B97F4A7C15ull
+
+
+struct fingerprint
+{
+  uint64_t hash;
+  uint32_t file_id;      /* intern() id of the path */
+  uint32_t pos;          /* index of the first token of the window */
+};
+
+struct clone_pair
+{
+  uint32_t file_a;
+  uint32_t file_b;
+  uint32_t pos_a;
+  uint32_t pos_b;
+};
+
+struct clone_file
+{
+  uint32_t file_id;
+  uint32_t ntoks;
+  uint64_t offset;       /* of the token codes in the token spill - the lines follow them */
+};
+
+/* a stretch of one file's normalized tokens, read back from the token spill */
+struct token_span
+{
+  uint32_t  first;       /* index of code[0] in the file */
+  uint32_t  n;
+  uint8_t*  code;
+  uint32_t* line;
+};
+
+/* a clone: tokens [a, a + n) of file_a, copied to [b, b + n) of file_b */
+struct clone_region
+{
+  uint32_t file_a;
+  uint32_t file_b;
+  uint32_t a;
+  uint32_t b;
+  uint32_t n;
+};
+
+struct clone_finding
+{
+  uint32_t file_id;      /* of the copy */
+  uint32_t lineno;
+  char*    message;
+  uint32_t file_a;       /* of the original */
+  uint32_t first;        /* tokens [first, end) of the copy */
+  uint32_t end;
+};
+
+
+static int       enabled = 0;
+static uint32_t  min_tokens = 0;
+static uint32_t  k = 0;               /* tokens per hashed window */
+static uint32_t  w = 0;               /* windows per winnowing window */
+static uint64_t  base_k1 = 1;         /* ROLL_BASE^(k-1) */
+
+static FILE*               spill_file[SPILL_NSHARDS];
+static struct fingerprint* spill_buf[SPILL_NSHARDS];
+static uint32_t            spill_len[SPILL_NSHARDS];
+
+static struct clone_pair*  pairs = 0;
+static uint32_t            npairs = 0;
+static uint32_t            maxpairs = 0;
+
+static uint64_t*           ring_hash = 0;   /* the last w window hashes */
+static uint32_t*           ring_pos = 0;
+
+static FILE*               token_file = 0;
+static uint64_t            token_file_size = 0;
+static struct clone_file*  files = 0;       /* sorted by file_id for clones_report() */
+static uint32_t            nfiles = 0;
+static uint32_t            maxfiles = 0;
+static uint8_t*            code_buf = 0;
+static uint32_t*           line_buf = 0;
+static uint32_t            token_buf_len = 0;
+
+
+
+void clones_enable(uint32_t tokens)
+{
+  uint32_t i;
+
+  min_tokens = (tokens == 0) ? DEFAULT_MIN_TOKENS : ((tokens < MIN_MIN_TOKENS) ? MIN_MIN_TOKENS : tokens);
+  k = min_tokens / 2;
+  w = min_tokens - k + 1;
+  base_k1 = 1;
+  for (i = 1; i < k; ++i)
+  {
+    base_k1 *= ROLL_BASE;
+  }
+
+  ring_hash = malloc(w * sizeof(*ring_hash));
+  ring_pos = malloc(w * sizeof(*ring_pos));
+  assert((ring_hash != 0) && (ring_pos != 0));
+  enabled = 1;
+}
+
+int clones_enabled(void)
+{
+  return enabled;
+}
+
+
+/* identifiers and type names are one symbol, constants another - renamed copies hash equal */
+static uint8_t token_code(const struct token* t)
+{
+  if (    (t->tokknd == TOK_IDENTIFIER)
+       || (t->toktyp == KW_TYPE_NAME))
+  {
+    return 1;
+  }
+  if (t->tokknd == TOK_CONST)
+  {
+    return 2;
+  }
+  return (uint8_t)(16 + t->toktyp);
+}
+
+static uint64_t token_hash(const struct token* t)
+{
+  return hash_mix64(token_code(t));
+}
+
+
+/* keep the normalized tokens of a file, for extending clones at the end of the run */
+static void spill_tokens(uint32_t file_id, const struct token* toks, uint32_t ntoks)
+{
+  uint32_t i;
+
+  if (token_file == 0)
+  {
+    token_file = tmpfile();
+    assert(token_file != 0);
+  }
+  if (ntoks > token_buf_len)
+  {
+    token_buf_len = ntoks;
+    code_buf = realloc(code_buf, token_buf_len * sizeof(*code_buf));
+    line_buf = realloc(line_buf, token_buf_len * sizeof(*line_buf));
+    assert((code_buf != 0) && (line_buf != 0));
+  }
+  for (i = 0; i < ntoks; ++i)
+  {
+    code_buf[i] = token_code(&toks[i]);
+    line_buf[i] = toks[i].lineno;
+  }
+  size_t nwritten = fwrite(code_buf, sizeof(*code_buf), ntoks, token_file);
+  nwritten += fwrite(line_buf, sizeof(*line_buf), ntoks, token_file);
+  assert(nwritten == (2 * (size_t)ntoks));
+
+  if (nfiles == maxfiles)
+  {
+    maxfiles = (maxfiles == 0) ? 256 : (2 * maxfiles);
+    files = realloc(files, maxfiles * sizeof(*files));
+    assert(files != 0);
+  }
+  files[nfiles].file_id = file_id;
+  files[nfiles].ntoks   = ntoks;
+  files[nfiles].offset  = token_file_size;
+  nfiles += 1;
+  token_file_size += (uint64_t)ntoks * (sizeof(*code_buf) + sizeof(*line_buf));
+}
+
+
+static void spill(const struct fingerprint* fp)
+{
+  uint32_t shard = (uint32_t)(fp->hash >> (64 - SPILL_SHARD_BITS));
+
+  if (spill_buf[shard] == 0)
+  {
+    spill_buf[shard] = malloc(SPILL_BUF_LEN * sizeof(struct fingerprint));
+    assert(spill_buf[shard] != 0);
+  }
+  if (spill_len[shard] == SPILL_BUF_LEN)
+  {
+    if (spill_file[shard] == 0)
+    {
+      spill_file[shard] = tmpfile();
+      assert(spill_file[shard] != 0);
+    }
+    size_t nwritten = fwrite(spill_buf[shard], sizeof(struct fingerprint), SPILL_BUF_LEN, spill_file[shard]);
+    assert(nwritten == SPILL_BUF_LEN);
+    spill_len[shard] = 0;
+  }
+  spill_buf[shard][spill_len[shard]++] = *fp;
+}
+
+
+static void record(uint32_t file_id, uint64_t hash, uint32_t pos)
+{
+  struct fingerprint fp;
+  fp.hash    = hash;
+  fp.file_id = file_id;
+  fp.pos     = pos;
+  spill(&fp);
+}
+
+
+/* Fingerprint a file: rolling hashes over k tokens, winnowed to the rightmost minimum of every w */
+void clones_file(const struct source_file* s, const struct token* toks, uint32_t ntoks)
+{
+  uint32_t file_id;
+  uint64_t h = 0;
+  uint32_t r = 0;
+  uint32_t min = 0;
+  uint32_t i;
+
+  if (ntoks < k)
+  {
+    return;
+  }
+  file_id = intern(s->file_path, (uint32_t)strlen(s->file_path));
+  spill_tokens(file_id, toks, ntoks);
+
+  for (i = 0; i < w; ++i)
+  {
+    ring_hash[i] = UINT64_MAX;
+    ring_pos[i] = 0;
+  }
+
+  for (i = 0; i < ntoks; ++i)
+  {
+    if (i >= k)
+    {
+      h -= token_hash(&toks[i - k]) * base_k1;
+    }
+    h = (h * ROLL_BASE) + token_hash(&toks[i]);
+    if ((i + 1) < k)
+    {
+      continue;
+    }
+
+    r = (r + 1) % w;
+    ring_hash[r] = h;
+    ring_pos[r] = i + 1 - k;
+    if (min == r)
+    {
+      /* the minimum left the window - find the rightmost minimum of the rest */
+      uint32_t j;
+      for (j = (r + w - 1) % w; j != r; j = (j + w - 1) % w)
+      {
+        if (ring_hash[j] < ring_hash[min])
+        {
+          min = j;
+        }
+      }
+      record(file_id, ring_hash[min], ring_pos[min]);
+    }
+    else if (ring_hash[r] <= ring_hash[min])
+    {
+      min = r;
+      record(file_id, ring_hash[min], ring_pos[min]);
+    }
+  }
+}
+
+
+
+/* ================================================== */
+/* End of run:                                        */
+/* ================================================== */
+
+static int fingerprint_cmp(const void* a, const void* b)
+{
+  const struct fingerprint* fa = (const struct fingerprint*)a;
+  const struct fingerprint* fb = (const struct fingerprint*)b;
+
+  if (fa->hash    != fb->hash)    { return (fa->hash    < fb->hash)    ? -1 : 1; }
+  if (fa->file_id != fb->file_id) { return (fa->file_id < fb->file_id) ? -1 : 1; }
+  if (fa->pos     != fb->pos)     { return (fa->pos     < fb->pos)     ? -1 : 1; }
+  return 0;
+}
+
+
+static void add_pair(const struct fingerprint* a, const struct fingerprint* b)
+{
+  /* overlapping windows of repetitive code in one file */
+  if (    (a->file_id == b->file_id)
+       && ((b->pos - a->pos) < k))
+  {
+    return;
+  }
+
+  if (npairs == maxpairs)
+  {
+    maxpairs = (maxpairs == 0) ? 1024 : (2 * maxpairs);
+    pairs = realloc(pairs, maxpairs * sizeof(*pairs));
+    assert(pairs != 0);
+  }
+  pairs[npairs].file_a       = a->file_id;
+  pairs[npairs].file_b       = b->file_id;
+  pairs[npairs].pos_a        = a->pos;
+  pairs[npairs].pos_b        = b->pos;
+  npairs += 1;
+}
+
+
+/* Load one shard, sort it, and turn runs of equal hashes into pairs */
+static void match_shard(uint32_t shard)
+{
+  struct fingerprint* fps;
+  uint32_t nfps = spill_len[shard];
+  uint32_t nspilled = 0;
+  uint32_t i;
+  uint32_t j;
+  uint32_t a;
+  uint32_t b;
+
+  if (spill_file[shard] != 0)
+  {
+    long size;
+    fflush(spill_file[shard]);
+    size = ftell(spill_file[shard]);
+    nspilled = (uint32_t)((size_t)size / sizeof(struct fingerprint));
+    rewind(spill_file[shard]);
+  }
+  nfps += nspilled;
+  if (nfps < 2)
+  {
+    return;
+  }
+
+  fps = malloc(nfps * sizeof(*fps));
+  assert(fps != 0);
+  if (nspilled > 0)
+  {
+    size_t nread = fread(fps, sizeof(*fps), nspilled, spill_file[shard]);
+    assert(nread == nspilled);
+  }
+  memcpy(&fps[nspilled], spill_buf[shard], spill_len[shard] * sizeof(*fps));
+
+  qsort(fps, nfps, sizeof(*fps), fingerprint_cmp);
+
+  for (i = 0; i < nfps; i = j)
+  {
+    for (j = i + 1; (j < nfps) && (fps[j].hash == fps[i].hash); ++j)
+    {
+    }
+    /* all pairs of a small group - a big one, e.g. code copied all over, would square the pairs */
+    for (a = i; a < ((j - i) <= MAX_GROUP ? j : (i + 1)); ++a)
+    {
+      for (b = a + 1; b < j; ++b)
+      {
+        add_pair(&fps[a], &fps[b]);
+      }
+    }
+  }
+
+  free(fps);
+}
+
+
+static int pair_cmp(const void* x, const void* y)
+{
+  const struct clone_pair* pa = (const struct clone_pair*)x;
+  const struct clone_pair* pb = (const struct clone_pair*)y;
+  int64_t da = (int64_t)pa->pos_b - (int64_t)pa->pos_a;
+  int64_t db = (int64_t)pb->pos_b - (int64_t)pb->pos_a;
+
+  if (pa->file_a != pb->file_a) { return (pa->file_a < pb->file_a) ? -1 : 1; }
+  if (pa->file_b != pb->file_b) { return (pa->file_b < pb->file_b) ? -1 : 1; }
+  if (da         != db)         { return (da         < db)         ? -1 : 1; }
+  if (pa->pos_a  != pb->pos_a)  { return (pa->pos_a  < pb->pos_a)  ? -1 : 1; }
+  return 0;
+}
+
+
+static int file_cmp(const void* x, const void* y)
+{
+  const struct clone_file* fa = (const struct clone_file*)x;
+  const struct clone_file* fb = (const struct clone_file*)y;
+  return (fa->file_id < fb->file_id) ? -1 : (fa->file_id > fb->file_id);
+}
+
+static const struct clone_file* find_file(uint32_t file_id)
+{
+  struct clone_file key;
+  key.file_id = file_id;
+  return bsearch(&key, files, nfiles, sizeof(*files), file_cmp);
+}
+
+
+/* read tokens [from, to) of a file back from the token spill */
+static void read_span(struct token_span* span, const struct clone_file* f, uint32_t from, uint32_t to)
+{
+  int fd = fileno(token_file);
+  ssize_t nread;
+
+  span->first = from;
+  span->n = to - from;
+  span->code = realloc(span->code, span->n * sizeof(*span->code) + 1);
+  span->line = realloc(span->line, span->n * sizeof(*span->line) + 1);
+  assert((span->code != 0) && (span->line != 0));
+
+  nread = pread(fd, span->code, span->n * sizeof(*span->code),
+                (off_t)(f->offset + from * sizeof(*span->code)));
+  assert(nread == (ssize_t)(span->n * sizeof(*span->code)));
+  nread = pread(fd, span->line, span->n * sizeof(*span->line),
+                (off_t)(f->offset + f->ntoks * sizeof(*span->code) + from * sizeof(*span->line)));
+  assert(nread == (ssize_t)(span->n * sizeof(*span->line)));
+}
+
+
+/* Grow a clone of n tokens at a / b over the equal tokens on both sides - into sa / sb, from sa->first
+   to sa->first + sa->n. Its fingerprints are less than w windows from its ends, so reading w + k more
+   tokens on each side is enough. */
+static void extend_clone(struct token_span* sa, struct token_span* sb, const struct clone_file* fa, const struct clone_file* fb,
+                         uint32_t a, uint32_t b, uint32_t n)
+{
+  uint32_t reach = w + k;
+  uint32_t before = (a < b) ? a : b;
+  uint32_t after_a = (fa->ntoks > (a + n)) ? (fa->ntoks - (a + n)) : 0;
+  uint32_t after_b = (fb->ntoks > (b + n)) ? (fb->ntoks - (b + n)) : 0;
+  uint32_t after = (after_a < after_b) ? after_a : after_b;
+  uint32_t first;
+  uint32_t end;
+
+  before = (before < reach) ? before : reach;
+  after = (after < reach) ? after : reach;
+  read_span(sa, fa, a - before, a + n + after);
+  read_span(sb, fb, b - before, b + n + after);
+
+  for (first = before; (first > 0) && (sa->code[first - 1] == sb->code[first - 1]); --first)
+  {
+  }
+  for (end = before + n; (end < sa->n) && (sa->code[end] == sb->code[end]); ++end)
+  {
+  }
+
+  /* keep only the clone */
+  memmove(sa->code, &sa->code[first], end - first);
+  memmove(sb->code, &sb->code[first], end - first);
+  memmove(sa->line, &sa->line[first], (end - first) * sizeof(*sa->line));
+  memmove(sb->line, &sb->line[first], (end - first) * sizeof(*sb->line));
+  sa->first += first;
+  sb->first += first;
+  sa->n = end - first;
+  sb->n = end - first;
+}
+
+
+/* by file pair, then by the copy's start - longest first */
+static int region_cmp(const void* x, const void* y)
+{
+  const struct clone_finding* fa = (const struct clone_finding*)x;
+  const struct clone_finding* fb = (const struct clone_finding*)y;
+
+  if (fa->file_a  != fb->file_a)  { return (fa->file_a  < fb->file_a)  ? -1 : 1; }
+  if (fa->file_id != fb->file_id) { return (fa->file_id < fb->file_id) ? -1 : 1; }
+  if (fa->first   != fb->first)   { return (fa->first   < fb->first)   ? -1 : 1; }
+  if (fa->end     != fb->end)     { return (fa->end     > fb->end)     ? -1 : 1; }
+  return 0;
+}
+
+
+static int finding_cmp(const void* x, const void* y)
+{
+  const struct clone_finding* fa = (const struct clone_finding*)x;
+  const struct clone_finding* fb = (const struct clone_finding*)y;
+  int c = strcmp(intern_str(fa->file_id), intern_str(fb->file_id));
+  if (c != 0)                   { return c; }
+  if (fa->lineno != fb->lineno) { return (fa->lineno < fb->lineno) ? -1 : 1; }
+  return strcmp(fa->message, fb->message);
+}
+
+
+/* Report a joined clone, if it is long enough - 'findings' has room for it */
+static void add_finding(struct clone_finding* findings, uint32_t* nfindings, const struct clone_region* r,
+                        struct token_span* sa, struct token_span* sb)
+{
+  char msg[1024];
+
+  if (    (r->n < min_tokens)
+       || (    (r->file_a == r->file_b)
+            && (r->b < (r->a + r->n))))  /* overlaps itself */
+  {
+    return;
+  }
+  read_span(sa, find_file(r->file_a), r->a, r->a + r->n);
+  read_span(sb, find_file(r->file_b), r->b, r->b + r->n);
+
+  snprintf(msg, sizeof(msg), "Lines %u-%u (%u tokens) duplicate [%s:%u-%u].",
+           sb->line[0], sb->line[r->n - 1], r->n,
+           intern_str(r->file_a), sa->line[0], sa->line[r->n - 1]);
+  findings[*nfindings].file_id = r->file_b;
+  findings[*nfindings].lineno  = sb->line[0];
+  findings[*nfindings].message = malloc(strlen(msg) + 1);
+  assert(findings[*nfindings].message != 0);
+  strcpy(findings[*nfindings].message, msg);
+  findings[*nfindings].file_a  = r->file_a;
+  findings[*nfindings].first   = r->b;
+  findings[*nfindings].end     = r->b + r->n;
+  *nfindings += 1;
+}
+
+
+/* Match the fingerprints of all files, join the pairs into clones and report them at the copy */
+void clones_report(uint32_t file_idx)
+{
+  struct clone_finding* findings = 0;
+  uint32_t nfindings = 0;
+  struct token_span span_a = { 0, 0, 0, 0 };
+  struct token_span span_b = { 0, 0, 0, 0 };
+  struct token_span found_a = { 0, 0, 0, 0 };   /* the lines of a clone that is reported */
+  struct token_span found_b = { 0, 0, 0, 0 };
+  struct clone_region cur;
+  int have_cur = 0;
+  uint32_t covered_end = 0;   /* end of the copies kept so far, of one file pair */
+  struct source_file s;
+  uint32_t shard;
+  uint32_t i;
+  uint32_t j;
+
+  for (shard = 0; shard < SPILL_NSHARDS; ++shard)
+  {
+    match_shard(shard);
+  }
+  if (token_file != 0)
+  {
+    fflush(token_file);   /* read back with pread() */
+  }
+
+  qsort(pairs, npairs, sizeof(*pairs), pair_cmp);
+  qsort(files, nfiles, sizeof(*files), file_cmp);
+  findings = malloc((npairs + 1) * sizeof(*findings));
+  assert(findings != 0);
+  memset(&cur, 0, sizeof(cur));
+
+  for (i = 0; i < npairs; i = j)
+  {
+    const struct clone_pair* first = &pairs[i];
+    const struct clone_pair* last = first;
+    int same_offset;
+
+    /* consecutive fingerprints of one clone are at most w windows apart */
+    for (j = i + 1;    (j < npairs)
+                    && (pairs[j].file_a == first->file_a)
+                    && (pairs[j].file_b == first->file_b)
+                    && ((pairs[j].pos_b - pairs[j].pos_a) == (first->pos_b - first->pos_a))
+                    && (pairs[j].pos_a <= (last->pos_a + w)); ++j)
+    {
+      last = &pairs[j];
+    }
+
+    same_offset =    have_cur
+                  && (first->file_a == cur.file_a)
+                  && (first->file_b == cur.file_b)
+                  && ((first->pos_b - first->pos_a) == (cur.b - cur.a));
+    if (    same_offset
+         && ((last->pos_a + k) <= (cur.a + cur.n)))
+    {
+      continue;   /* covered by extending an earlier run of fingerprints */
+    }
+
+    /* fingerprints only mark where the clone is - grow it over the equal tokens around them */
+      extend_clone(&span_a, &span_b, find_file(first->file_a), find_file(first->file_b),
+                 first->pos_a, first->pos_b, last->pos_a + k - first->pos_a);
+
+    if (    same_offset
+         && (span_a.first <= (cur.a + cur.n)))
+    {
+      /* fingerprints of one clone further apart than w, e.g. where copies beyond MAX_GROUP were not paired */
+      uint32_t end = span_a.first + span_a.n;
+      cur.n = (end > (cur.a + cur.n)) ? (end - cur.a) : cur.n;
+      continue;
+    }
+    if (have_cur)
+    {
+      add_finding(findings, &nfindings, &cur, &found_a, &found_b);
+    }
+    cur.file_a = first->file_a;
+    cur.file_b = first->file_b;
+    cur.a = span_a.first;
+    cur.b = span_b.first;
+    cur.n = span_a.n;
+    have_cur = 1;
+  }
+  if (have_cur)
+  {
+    add_finding(findings, &nfindings, &cur, &found_a, &found_b);
+  }
+  free(span_a.code);
+  free(span_a.line);
+  free(span_b.code);
+  free(span_b.line);
+  free(found_a.code);
+  free(found_a.line);
+  free(found_b.code);
+  free(found_b.line);
+
+  /* repetitive code - tables, runs of similar statements - also matches shifted against itself:
+     report only the longest of the clones of the same code */
+  qsort(findings, nfindings, sizeof(*findings), region_cmp);
+  for (i = 0, j = 0; i < nfindings; ++i)
+  {
+    if (    (j > 0)
+         && (findings[i].file_a == findings[j-1].file_a)
+         && (findings[i].file_id == findings[j-1].file_id)
+         && (findings[i].end <= covered_end))
+    {
+      free(findings[i].message);
+      continue;
+    }
+    covered_end = findings[i].end;
+    findings[j++] = findings[i];
+  }
+  nfindings = j;
+
+  qsort(findings, nfindings, sizeof(*findings), finding_cmp);
+
+  memset(&s, 0, sizeof(s));
+  for (i = 0; i < nfindings; ++i)
+  {
+    if (    (i == 0)
+         || (findings[i].file_id != findings[i-1].file_id))
+    {
+      if (i > 0)
+      {
+        report_end_file(&s, 0, 0);
+      }
+      s.file_path = (char*)intern_str(findings[i].file_id);
+      report_begin_file(file_idx, s.file_path);
+    }
+    report_warning(&s, CHK_CLONES, findings[i].lineno, "%s", findings[i].message);
+    free(findings[i].message);
+  }
+  if (nfindings > 0)
+  {
+    report_end_file(&s, 0, 0);
+  }
+  free(findings);
+}
+
+
+void clones_free(void)
+{
+  uint32_t i;
+
+  for (i = 0; i < SPILL_NSHARDS; ++i)
+  {
+    if (spill_file[i] != 0)
+    {
+      fclose(spill_file[i]);
+    }
+    free(spill_buf[i]);
+    spill_file[i] = 0;
+    spill_buf[i] = 0;
+    spill_len[i] = 0;
+  }
+  if (token_file != 0)
+  {
+    fclose(token_file);
+  }
+  free(files);
+  free(code_buf);
+  free(line_buf);
+  token_file = 0;
+  token_file_size = 0;
+  files = 0;
+  nfiles = 0;
+  maxfiles = 0;
+  code_buf = 0;
+  line_buf = 0;
+  token_buf_len = 0;
+  free(pairs);
+  free(ring_hash);
+  free(ring_pos);
+  pairs = 0;
+  npairs = 0;
+  maxpairs = 0;
+  ring_hash = 0;
+  ring_pos = 0;
+  enabled = 0;
+}
+
@@ -0,0 +1,38 @@
+#ifndef __CLONES_H__
+#define __CLONES_H__
+
+/*
+
+Token-level clone detection
+
+  Each file's token stream is normalized - identifiers and type names become one symbol,
+  constants another, keywords and operators stay as they are - so renamed copies match.
+  A rolling hash runs over windows of k tokens, and winnowing keeps the minimum hash of
+  every w consecutive windows as the file's fingerprints. Any clone of at least
+  k + w - 1 = <min-tokens> tokens shares at least one fingerprint with its original.
+
+  Fingerprints are spilled to temporary files, sharded by hash, so memory stays bounded
+  by the largest shard rather than by the size of the code base. At the end of the run,
+  each shard is sorted and equal fingerprints become pairs of locations; pairs with the
+  same offset between the two files are joined into clone regions. The fingerprints only
+  mark where a clone is: each region is grown over the equal tokens of both files - kept
+  in another temporary file, one byte and a line number per token - to the clone's real
+  length before it is compared to <min-tokens> and reported.
+
+*/
+
+#include "lexer.h"
+#include "source.h"
+
+
+
+void clones_enable(uint32_t min_tokens);
+int  clones_enabled(void);
+void clones_file(const struct source_file* s, const struct token* toks, uint32_t ntoks);
+void clones_report(uint32_t file_idx);
+void clones_free(void);
+
+
+
+#endif /* __CLONES_H__ */
+
@@ -0,0 +1,685 @@
+/*
+
+Compilation databases
+
+  - reader:   a pull parser over the buffered file with one character of lookahead. Only
+              the keys of an entry that are used are kept - "directory", "file", "command"
+              and "arguments" - everything else is skipped without being stored.
+  - seen-set: open-addressing hash map of file keys to entries, grown at 50% load. The key
+              of an existing file is (st_dev, st_ino), else (hash of the real path, NO_INODE).
+  - entries:  real path and macro list per unique file, indexed by position in the
+              scheduler's file-list. When more entries compile the file, its list keeps
+              only the -D/-U options all of them agree on - the others become unknown.
+
+*/
+
+#define _GNU_SOURCE   /* getc_unlocked, realpath */
+#include "compdb.h"
+#include "hash.h"
+#include "sched.h"
+#include <assert.h>
+#include <limits.h>    /* realpath */
+#include <stdio.h>     /* fopen, getc_unlocked */
+#include <stdlib.h>    /* malloc, realloc, free, realpath */
+#include <string.h>    /* memcpy, strcmp, strlen */
+#include <sys/stat.h>  /* stat */
+
+
+#define MAXDEPTH   64              /* nesting of skipped JSON values */
+#define NO_INODE   UINT64_MAX      /* key of a file that could not be stat()ed */
+
+
+struct buf
+{
+  char*    data;
+  uint32_t len;
+  uint32_t cap;
+};
+
+struct file_key
+{
+  uint64_t a;
+  uint64_t b;
+  uint32_t entry;   /* index into paths[] and macros[] */
+  int      used;
+};
+
+
+static FILE*            in = 0;
+static int              c = EOF;         /* lookahead */
+static struct buf       skipped = { 0, 0, 0 };   /* strings that are not kept */
+
+static char**           paths = 0;       /* real path per entry */
+static char**           macros = 0;      /* 'D<name>[=<value>]' / 'U<name>' list per entry, or 0 */
+static uint32_t         nentries = 0;
+static uint32_t         maxentries = 0;
+
+static struct file_key* seen = 0;
+static uint32_t         seen_size = 0;   /* number of slots - power of 2 */
+static uint32_t         seen_count = 0;
+
+
+
+static void buf_add(struct buf* b, char ch)
+{
+  if ((b->len + 2) > b->cap)
+  {
+    b->cap = (b->cap == 0) ? 256 : (2 * b->cap);
+    b->data = realloc(b->data, b->cap);
+    assert(b->data != 0);
+  }
+  b->data[b->len++] = ch;
+  b->data[b->len] = 0;
+}
+
+/* empty, but null-terminated */
+static void buf_clear(struct buf* b)
+{
+  b->len = 0;
+  buf_add(b, 0);
+  b->len = 0;
+}
+
+
+/* ================================================== */
+/* JSON:                                              */
+/* ================================================== */
+
+static void next_char(void)
+{
+  c = getc_unlocked(in);
+}
+
+static void skip_ws(void)
+{
+  while ((c == ' ') || (c == '\t') || (c == '\n') || (c == '\r'))
+  {
+    next_char();
+  }
+}
+
+static int expect_char(int ch)
+{
+  skip_ws();
+  if (c != ch)
+  {
+    return 0;
+  }
+  next_char();
+  return 1;
+}
+
+static void add_utf8(struct buf* out, uint32_t cp)
+{
+  if (cp < 0x80)
+  {
+    buf_add(out, (char)cp);
+  }
+  else if (cp < 0x800)
+  {
+    buf_add(out, (char)(0xC0 | (cp >> 6)));
+    buf_add(out, (char)(0x80 | (cp & 0x3F)));
+  }
+  else
+  {
+    buf_add(out, (char)(0xE0 | (cp >> 12)));
+    buf_add(out, (char)(0x80 | ((cp >> 6) & 0x3F)));
+    buf_add(out, (char)(0x80 | (cp & 0x3F)));
+  }
+}
+
+/* a string, unescaped into 'out' - or skipped, for out == 0 */
+static int parse_string(struct buf* out)
+{
+  int ok = 0;
+
+  if (!expect_char('"'))
+  {
+    return 0;
+  }
+  if (out == 0)
+  {
+    out = &skipped;
+  }
+  buf_clear(out);
+
+  while ((c != EOF) && (c != '"'))
+  {
+    if (c == '\\')
+    {
+      next_char();
+      switch (c)
+      {
+        case 'b': buf_add(out, '\b'); break;
+        case 'f': buf_add(out, '\f'); break;
+        case 'n': buf_add(out, '\n'); break;
+        case 'r': buf_add(out, '\r'); break;
+        case 't': buf_add(out, '\t'); break;
+        case 'u':
+        {
+          uint32_t cp = 0;
+          int i;
+          for (i = 0; i < 4; ++i)
+          {
+            next_char();
+            cp = (cp << 4) | (uint32_t)(((c >= '0') && (c <= '9')) ? (c - '0') : ((c | 0x20) - 'a' + 10));
+          }
+          add_utf8(out, cp & 0xFFFF);
+        } break;
+        case EOF: break;
+        default: buf_add(out, (char)c); break;   /* \" \\ \/ */
+      }
+    }
+    else
+    {
+      buf_add(out, (char)c);
+    }
+    next_char();
+  }
+  if (c == '"')
+  {
+    next_char();
+    ok = 1;
+  }
+  return ok;
+}
+
+/* any value: string, number, literal, array or object */
+static int skip_value(int depth)
+{
+  skip_ws();
+  if (depth > MAXDEPTH)
+  {
+    return 0;
+  }
+  if (c == '"')
+  {
+    return parse_string(0);
+  }
+  if ((c == '[') || (c == '{'))
+  {
+    int close = (c == '[') ? ']' : '}';
+    next_char();
+    skip_ws();
+    if (c == close)
+    {
+      next_char();
+      return 1;
+    }
+    for (;;)
+    {
+      if (    (close == '}')
+           && (    !parse_string(0)
+                || !expect_char(':')))
+      {
+        return 0;
+      }
+      if (!skip_value(depth + 1))
+      {
+        return 0;
+      }
+      skip_ws();
+      if (c == close)
+      {
+        next_char();
+        return 1;
+      }
+      if (!expect_char(','))
+      {
+        return 0;
+      }
+    }
+  }
+  while (    (c != EOF)
+          && (c != ',') && (c != '}') && (c != ']')
+          && (c != ' ') && (c != '\t') && (c != '\n') && (c != '\r'))
+  {
+    next_char();   /* number, true, false, null */
+  }
+  return 1;
+}
+
+/* an array of strings, into 'words' - each null-terminated */
+static int parse_words(struct buf* words)
+{
+  struct buf word = { 0, 0, 0 };
+  int ok = 0;
+
+  words->len = 0;
+  if (!expect_char('['))
+  {
+    return 0;
+  }
+  skip_ws();
+  if (c == ']')
+  {
+    next_char();
+    return 1;
+  }
+  while (parse_string(&word))
+  {
+    uint32_t i;
+    for (i = 0; i <= word.len; ++i)
+    {
+      buf_add(words, word.data[i]);
+    }
+    skip_ws();
+    if (c == ']')
+    {
+      next_char();
+      ok = 1;
+      break;
+    }
+    if (!expect_char(','))
+    {
+      break;
+    }
+  }
+  free(word.data);
+  return ok;
+}
+
+
+
+/* ================================================== */
+/* Entries:                                           */
+/* ================================================== */
+
+/* split a shell command line into words - each null-terminated - honoring quotes and backslashes */
+static void split_command(const char* cmd, struct buf* words)
+{
+  words->len = 0;
+  while (*cmd != 0)
+  {
+    int in_word = 0;
+    while ((*cmd == ' ') || (*cmd == '\t') || (*cmd == '\n'))
+    {
+      cmd += 1;
+    }
+    while (    (*cmd != 0)
+            && (*cmd != ' ') && (*cmd != '\t') && (*cmd != '\n'))
+    {
+      if (*cmd == '\'')
+      {
+        for (cmd += 1; (*cmd != 0) && (*cmd != '\''); ++cmd)
+        {
+          buf_add(words, *cmd);
+        }
+      }
+      else if (*cmd == '"')
+      {
+        for (cmd += 1; (*cmd != 0) && (*cmd != '"'); ++cmd)
+        {
+          if (    (cmd[0] == '\\')
+               && ((cmd[1] == '"') || (cmd[1] == '\\')))
+          {
+            cmd += 1;
+          }
+          buf_add(words, *cmd);
+        }
+      }
+      else
+      {
+        if (    (cmd[0] == '\\')
+             && (cmd[1] != 0))
+        {
+          cmd += 1;
+        }
+        buf_add(words, *cmd);
+      }
+      cmd += (*cmd != 0);
+      in_word = 1;
+    }
+    if (in_word)
+    {
+      buf_add(words, 0);
+    }
+  }
+}
+
+/* the -D and -U options among the words, as a macro list for ppcond_set_file_macros() - 0 if none */
+static char* extract_macros(const struct buf* words)
+{
+  struct buf list = { 0, 0, 0 };
+  uint32_t i = 0;
+
+  while (i < words->len)
+  {
+    const char* w = &words->data[i];
+    i += (uint32_t)strlen(w) + 1;
+
+    if (    (w[0] == '-')
+         && ((w[1] == 'D') || (w[1] == 'U')))
+    {
+      const char* name = &w[2];
+      if (    (name[0] == 0)
+           && (i < words->len))
+      {
+        name = &words->data[i];   /* '-D NAME' */
+        i += (uint32_t)strlen(name) + 1;
+      }
+      if (name[0] != 0)
+      {
+        buf_add(&list, w[1]);
+        for (; *name != 0; ++name)
+        {
+          buf_add(&list, *name);
+        }
+        buf_add(&list, 0);
+      }
+    }
+  }
+  if (list.len > 0)
+  {
+    buf_add(&list, 0);   /* end of the list */
+  }
+  return list.data;
+}
+
+
+static uint32_t hash_key(uint64_t a, uint64_t b)
+{
+  uint64_t h = hash_fnv1a64(&a, sizeof(a), HASH_FNV1A64_INIT);
+  return (uint32_t)hash_fnv1a64(&b, sizeof(b), h);
+}
+
+/* the entry of the file with the key - 'entry' if the key was not in the set before */
+static uint32_t seen_insert(uint64_t a, uint64_t b, uint32_t entry)
+{
+  uint32_t i;
+
+  if ((seen_count * 2) >= seen_size)
+  {
+    struct file_key* old = seen;
+    uint32_t old_size = seen_size;
+
+    seen_size = (seen_size == 0) ? 1024 : (seen_size * 2);
+    seen = calloc(seen_size, sizeof(*seen));
+    assert(seen != 0);
+    seen_count = 0;
+    for (i = 0; i < old_size; ++i)
+    {
+      if (old[i].used)
+      {
+        seen_insert(old[i].a, old[i].b, old[i].entry);
+      }
+    }
+    free(old);
+  }
+
+  i = hash_key(a, b) & (seen_size - 1);
+  while (seen[i].used)
+  {
+    if ((seen[i].a == a) && (seen[i].b == b))
+    {
+      return seen[i].entry;
+    }
+    i = (i + 1) & (seen_size - 1);
+  }
+  seen[i].a = a;
+  seen[i].b = b;
+  seen[i].entry = entry;
+  seen[i].used = 1;
+  seen_count += 1;
+  return entry;
+}
+
+
+/* the option for the macro 'name' that is in effect at the end of a macro list - the last one, or 0 */
+static const char* find_macro(const char* list, const char* name, size_t len)
+{
+  const char* found = 0;
+  for (; (list != 0) && (list[0] != 0); list += strlen(list) + 1)
+  {
+    if (    (strncmp(&list[1], name, len) == 0)
+         && ((list[1 + len] == 0) || (list[1 + len] == '=')))
+    {
+      found = list;
+    }
+  }
+  return found;
+}
+
+/* Keep only the options of an entry that another entry of the same file has, too - a macro
+   that is defined differently, or not mentioned, is not known for the file */
+static void agree_macros(uint32_t entry, const char* other)
+{
+  struct buf list = { 0, 0, 0 };
+  const char* m;
+
+  for (m = macros[entry]; (m != 0) && (m[0] != 0); m += strlen(m) + 1)
+  {
+    size_t len = strcspn(&m[1], "=");
+    const char* theirs = find_macro(other, &m[1], len);
+    if (    (find_macro(macros[entry], &m[1], len) == m)   /* in effect, not overridden later */
+         && (theirs != 0)
+         && (strcmp(theirs, m) == 0))
+    {
+      for (; *m != 0; ++m)
+      {
+        buf_add(&list, *m);
+      }
+      buf_add(&list, 0);
+    }
+  }
+  if (list.len > 0)
+  {
+    buf_add(&list, 0);   /* end of the list */
+  }
+  free(macros[entry]);
+  macros[entry] = list.data;
+}
+
+
+static void add_entry(const struct buf* directory, const struct buf* file, const struct buf* words)
+{
+  struct buf path = { 0, 0, 0 };
+  struct stat st;
+  char* real;
+  uint32_t entry;
+  uint32_t i;
+
+  if (file->len == 0)
+  {
+    return;
+  }
+  if (    (file->data[0] != '/')
+       && (directory->len > 0))
+  {
+    for (i = 0; i < directory->len; ++i)
+    {
+      buf_add(&path, directory->data[i]);
+    }
+    buf_add(&path, '/');
+  }
+  for (i = 0; i < file->len; ++i)
+  {
+    buf_add(&path, file->data[i]);
+  }
+
+  real = realpath(path.data, 0);
+  if (real == 0)
+  {
+    real = path.data;   /* does not exist (yet) - keep the path as given */
+    path.data = 0;
+  }
+  free(path.data);
+
+  entry = (stat(real, &st) == 0) ? seen_insert((uint64_t)st.st_dev, (uint64_t)st.st_ino, nentries)
+                                 : seen_insert(hash_fnv1a64(real, strlen(real), HASH_FNV1A64_INIT), NO_INODE, nentries);
+  if (entry != nentries)
+  {
+    /* compiled by an earlier entry already - e.g. in another configuration */
+    char* list = extract_macros(words);
+    agree_macros(entry, list);
+    free(list);
+    free(real);
+    return;
+  }
+
+  if (nentries == maxentries)
+  {
+    maxentries = (maxentries == 0) ? 256 : (2 * maxentries);
+    paths = realloc(paths, maxentries * sizeof(*paths));
+    macros = realloc(macros, maxentries * sizeof(*macros));
+    assert((paths != 0) && (macros != 0));
+  }
+  paths[nentries] = real;
+  macros[nentries] = extract_macros(words);
+  nentries += 1;
+  sched_add_file(real);
+}
+
+
+/* one '{ ... }' of the database */
+static int parse_entry(struct buf* directory, struct buf* file, struct buf* command, struct buf* words)
+{
+  struct buf key = { 0, 0, 0 };
+  int has_arguments = 0;
+  int ok = 0;
+
+  directory->len = 0;
+  file->len = 0;
+  command->len = 0;
+  words->len = 0;
+
+  if (!expect_char('{'))
+  {
+    return 0;
+  }
+  skip_ws();
+  if (c == '}')
+  {
+    next_char();
+    free(key.data);
+    return 1;
+  }
+  while (    parse_string(&key)
+          && expect_char(':'))
+  {
+    int parsed;
+    skip_ws();
+    if ((strcmp(key.data, "directory") == 0) && (c == '"'))
+    {
+      parsed = parse_string(directory);
+    }
+    else if ((strcmp(key.data, "file") == 0) && (c == '"'))
+    {
+      parsed = parse_string(file);
+    }
+    else if ((strcmp(key.data, "command") == 0) && (c == '"'))
+    {
+      parsed = parse_string(command);
+    }
+    else if ((strcmp(key.data, "arguments") == 0) && (c == '['))
+    {
+      parsed = parse_words(words);
+      has_arguments = 1;
+    }
+    else
+    {
+      parsed = skip_value(0);
+    }
+    if (!parsed)
+    {
+      break;
+    }
+    skip_ws();
+    if (c == '}')
+    {
+      next_char();
+      ok = 1;
+      break;
+    }
+    if (!expect_char(','))
+    {
+      break;
+    }
+  }
+  free(key.data);
+
+  if (    ok
+       && !has_arguments
+       && (command->len > 0))
+  {
+    split_command(command->data, words);
+  }
+  return ok;
+}
+
+
+/* Read the database and add each unique file to the scheduler - returns 0 on errors */
+int compdb_load(const char* json_path)
+{
+  struct buf directory = { 0, 0, 0 };
+  struct buf file = { 0, 0, 0 };
+  struct buf command = { 0, 0, 0 };
+  struct buf words = { 0, 0, 0 };
+  int ok = 0;
+
+  in = fopen(json_path, "rb");
+  if (in == 0)
+  {
+    return 0;
+  }
+  next_char();
+
+  if (expect_char('['))
+  {
+    skip_ws();
+    ok = (c == ']');
+    while (    !ok
+            && parse_entry(&directory, &file, &command, &words))
+    {
+      add_entry(&directory, &file, &words);
+      skip_ws();
+      if (c == ']')
+      {
+        ok = 1;
+      }
+      else if (!expect_char(','))
+      {
+        break;
+      }
+    }
+  }
+
+  fclose(in);
+  in = 0;
+  free(directory.data);
+  free(file.data);
+  free(command.data);
+  free(words.data);
+  free(skipped.data);
+  memset(&skipped, 0, sizeof(skipped));
+  return ok;
+}
+
+
+/* -D / -U options of a file, by its position in the file-list - 0 if none */
+const char* compdb_macros(uint32_t list_idx)
+{
+  return (list_idx < nentries) ? macros[list_idx] : 0;
+}
+
+
+void compdb_free(void)
+{
+  uint32_t i;
+  for (i = 0; i < nentries; ++i)
+  {
+    free(paths[i]);
+    free(macros[i]);
+  }
+  free(paths);
+  free(macros);
+  free(seen);
+  paths = 0;
+  macros = 0;
+  nentries = 0;
+  maxentries = 0;
+  seen = 0;
+  seen_size = 0;
+  seen_count = 0;
+}
+
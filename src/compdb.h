@@ -0,0 +1,36 @@
+#ifndef __COMPDB_H__
+#define __COMPDB_H__
+
+/*
+
+Compilation databases
+
+  Reads a 'compile_commands.json' as written by CMake, Bear, Meson and others, instead of
+  a file-list:
+
+    [ { "directory": "...", "file": "...", "command": "cc -DX=1 -c ..." },
+      { "directory": "...", "file": "...", "arguments": [ "cc", "-DX=1", ... ] }, ... ]
+
+  The file is parsed as a stream, one entry at a time - no document tree is built, so
+  memory stays small for databases of many thousands of entries. Relative paths are
+  taken from "directory", and every file is added to the scheduler once under its real
+  path: entries naming the same file - through other paths, links, or several build
+  configurations - are de-duplicated by device and inode (by real path when the file
+  does not exist). The -D and -U options that all entries of a file agree on are kept
+  for evaluating its '#if' conditions, see ppcond.h - a macro the entries set differently
+  is not known, and both sides of its '#if' are analyzed.
+
+*/
+
+#include <stdint.h>
+
+
+
+int         compdb_load(const char* json_path);
+const char* compdb_macros(uint32_t list_idx);
+void        compdb_free(void);
+
+
+
+#endif /* __COMPDB_H__ */
+
@@ -0,0 +1,346 @@
+/*
+
+Diff-aware mode
+
+  - files[]:     touched files, each with its sorted, merged ranges of added line numbers.
+  - file_index:  open-addressing hash table path -> files[] entry, grown at 50% load.
+
+  Hunks are followed by their line counts, so removed lines that happen to start with
+  '--' are never mistaken for file headers.
+
+*/
+
+#include "diff.h"
+#include "hash.h"
+#include <assert.h>
+#include <stdio.h>     /* fopen, getline */
+#include <stdlib.h>    /* malloc, realloc, free */
+#include <string.h>    /* strncmp, strlen */
+
+
+struct line_range
+{
+  uint32_t first;
+  uint32_t last;
+};
+
+struct diff_file
+{
+  char*              path;
+  uint64_t           hash;
+  struct line_range* ranges;
+  uint32_t           nranges;
+  uint32_t           maxranges;
+  uint32_t           ncode_lines;   /* added lines that hold more than whitespace and comments */
+};
+
+
+static int               enabled = 0;
+static struct diff_file* files = 0;
+static uint32_t          nfiles = 0;
+static uint32_t          maxfiles = 0;
+static uint32_t*         file_index = 0;   /* files[] entry + 1, 0 for an empty slot */
+static uint32_t          index_size = 0;   /* number of slots - power of 2 */
+
+
+
+static uint32_t* index_slot(const char* path, uint64_t h)
+{
+  uint32_t i = (uint32_t)hash_mix64(h) & (index_size - 1);
+  while (    (file_index[i] != 0)
+          && (    (files[file_index[i] - 1].hash != h)
+               || (strcmp(files[file_index[i] - 1].path, path) != 0)))
+  {
+    i = (i + 1) & (index_size - 1);
+  }
+  return &file_index[i];
+}
+
+static struct diff_file* find_file(const char* path)
+{
+  if (nfiles == 0)
+  {
+    return 0;
+  }
+  while ((path[0] == '.') && (path[1] == '/'))
+  {
+    path += 2; /* './src/a.c' in a file-list is 'src/a.c' in the diff */
+  }
+  uint32_t* slot = index_slot(path, hash_fnv1a64(path, strlen(path), HASH_FNV1A64_INIT));
+  return (*slot != 0) ? &files[*slot - 1] : 0;
+}
+
+static struct diff_file* add_file(const char* path, uint32_t len)
+{
+  uint32_t i;
+
+  if ((nfiles * 2) >= index_size)
+  {
+    /* grow and re-hash */
+    index_size = (index_size == 0) ? 64 : (index_size * 2);
+    free(file_index);
+    file_index = calloc(index_size, sizeof(*file_index));
+    assert(file_index != 0);
+    for (i = 0; i < nfiles; ++i)
+    {
+      *index_slot(files[i].path, files[i].hash) = i + 1;
+    }
+  }
+  if (nfiles == maxfiles)
+  {
+    maxfiles = (maxfiles == 0) ? 64 : (maxfiles * 2);
+    files = realloc(files, maxfiles * sizeof(*files));
+    assert(files != 0);
+  }
+
+  struct diff_file* f = &files[nfiles];
+  memset(f, 0, sizeof(*f));
+  f->path = malloc(len + 1);
+  assert(f->path != 0);
+  memcpy(f->path, path, len);
+  f->path[len] = 0;
+  f->hash = hash_fnv1a64(f->path, len, HASH_FNV1A64_INIT);
+
+  uint32_t* slot = index_slot(f->path, f->hash);
+  if (*slot != 0)
+  {
+    free(f->path);
+    return &files[*slot - 1]; /* file appears twice in the diff */
+  }
+  *slot = ++nfiles;
+  return f;
+}
+
+
+/* added lines arrive in ascending order - extend the last range or start a new one */
+static void add_line(struct diff_file* f, uint32_t lineno)
+{
+  if (    (f->nranges > 0)
+       && (f->ranges[f->nranges - 1].last + 1 == lineno))
+  {
+    f->ranges[f->nranges - 1].last = lineno;
+    return;
+  }
+  if (f->nranges == f->maxranges)
+  {
+    f->maxranges = (f->maxranges == 0) ? 16 : (f->maxranges * 2);
+    f->ranges = realloc(f->ranges, f->maxranges * sizeof(*f->ranges));
+    assert(f->ranges != 0);
+  }
+  f->ranges[f->nranges].first = lineno;
+  f->ranges[f->nranges].last  = lineno;
+  f->nranges += 1;
+}
+
+
+/* Does an added line hold code? Blank lines and lines that are a single comment do not. */
+static int is_code_line(const char* line)
+{
+  while ((*line == ' ') || (*line == '\t'))
+  {
+    line += 1;
+  }
+  if ((*line == 0) || (*line == '\n') || (*line == '\r'))
+  {
+    return 0;
+  }
+  if ((line[0] == '/') && (line[1] == '/'))
+  {
+    return 0;
+  }
+  if ((line[0] == '/') && (line[1] == '*'))
+  {
+    const char* end = strstr(line + 2, "*/");
+    if (end != 0)
+    {
+      return is_code_line(end + 2); /* code after the comment? */
+    }
+  }
+  return 1; /* conservatively: this may be code, even inside a multi-line comment */
+}
+
+
+/* parse '<start>[,<count>]' - the count defaults to 1 */
+static const char* parse_range(const char* p, uint32_t* start, uint32_t* count)
+{
+  char* end;
+  *start = (uint32_t)strtoul(p, &end, 10);
+  *count = 1;
+  if (*end == ',')
+  {
+    *count = (uint32_t)strtoul(end + 1, &end, 10);
+  }
+  return end;
+}
+
+
+/* the path of a '--- ' or '+++ ' header: up to a tab (timestamp) or the end of the line */
+static uint32_t header_path_len(const char* path)
+{
+  uint32_t len = 0;
+  while ((path[len] != 0) && (path[len] != '\t') && (path[len] != '\n') && (path[len] != '\r'))
+  {
+    len += 1;
+  }
+  return len;
+}
+
+
+int diff_load(const char* diff_path)
+{
+  FILE* f = (strcmp(diff_path, "-") == 0) ? stdin : fopen(diff_path, "r");
+  char*  line = 0;
+  size_t line_cap = 0;
+  int    old_has_prefix = 0;         /* '--- a/...': strip 'b/' from the new path */
+  struct diff_file* cur = 0;
+  uint32_t old_left = 0;
+  uint32_t new_left = 0;
+  uint32_t new_lineno = 0;
+
+  if (f == 0)
+  {
+    return 0;
+  }
+  enabled = 1;
+
+  while (getline(&line, &line_cap, f) > 0)
+  {
+    if ((old_left > 0) || (new_left > 0))
+    {
+      /* inside a hunk */
+      switch (line[0])
+      {
+        case '+':
+        {
+          if (cur != 0)
+          {
+            add_line(cur, new_lineno);
+            cur->ncode_lines += (uint32_t)is_code_line(line + 1);
+          }
+          new_lineno += 1;
+          new_left -= (new_left > 0);
+        } break;
+        case '-':
+        {
+          old_left -= (old_left > 0);
+        } break;
+        case '\\':  /* '\ No newline at end of file' */
+          break;
+        default:    /* context line - a blank one may have lost its leading space */
+        {
+          new_lineno += 1;
+          old_left -= (old_left > 0);
+          new_left -= (new_left > 0);
+        } break;
+      }
+    }
+    else if (strncmp(line, "--- ", 4) == 0)
+    {
+      old_has_prefix = (strncmp(line + 4, "a/", 2) == 0);
+      cur = 0;
+    }
+    else if (strncmp(line, "+++ ", 4) == 0)
+    {
+      const char* path = line + 4;
+      if (old_has_prefix && (strncmp(path, "b/", 2) == 0))
+      {
+        path += 2;
+      }
+      uint32_t len = header_path_len(path);
+      cur = ((len == 9) && (strncmp(path, "/dev/null", 9) == 0)) ? 0 : add_file(path, len);
+    }
+    else if (strncmp(line, "@@ -", 4) == 0)
+    {
+      uint32_t old_start;
+      const char* p = parse_range(line + 4, &old_start, &old_left);
+      if (strncmp(p, " +", 2) == 0)
+      {
+        parse_range(p + 2, &new_lineno, &new_left);
+      }
+      else
+      {
+        old_left = 0; /* malformed hunk header */
+      }
+    }
+  }
+
+  free(line);
+  if (f != stdin)
+  {
+    fclose(f);
+  }
+  return 1;
+}
+
+
+int diff_enabled(void)
+{
+  return enabled;
+}
+
+uint32_t diff_nfiles(void)
+{
+  return nfiles;
+}
+
+const char* diff_file_path(uint32_t i)
+{
+  return (i < nfiles) ? files[i].path : 0;
+}
+
+
+/* was the file touched, with code on an added line? */
+int diff_file_relevant(const char* file_path)
+{
+  const struct diff_file* f = find_file(file_path);
+  return (f != 0) && (f->ncode_lines > 0);
+}
+
+
+int diff_line_changed(const char* file_path, uint32_t lineno)
+{
+  const struct diff_file* f = find_file(file_path);
+  uint32_t lo = 0;
+  uint32_t hi;
+
+  if (f == 0)
+  {
+    return 0;
+  }
+
+  /* binary search for the range starting at or before 'lineno' */
+  hi = f->nranges;
+  while (lo < hi)
+  {
+    uint32_t mid = (lo + hi) / 2;
+    if (f->ranges[mid].first <= lineno)
+    {
+      lo = mid + 1;
+    }
+    else
+    {
+      hi = mid;
+    }
+  }
+  return (lo > 0) && (lineno <= f->ranges[lo - 1].last);
+}
+
+
+void diff_free(void)
+{
+  uint32_t i;
+  for (i = 0; i < nfiles; ++i)
+  {
+    free(files[i].path);
+    free(files[i].ranges);
+  }
+  free(files);
+  free(file_index);
+  files = 0;
+  nfiles = 0;
+  maxfiles = 0;
+  file_index = 0;
+  index_size = 0;
+  enabled = 0;
+}
+
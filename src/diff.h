@@ -0,0 +1,32 @@
+#ifndef __DIFF_H__
+#define __DIFF_H__
+
+/*
+
+Diff-aware mode
+
+  Reads a unified diff (as produced by 'git diff' or 'diff -u') and records, per touched
+  file, the line numbers added or changed in the new version. Only those files are
+  analyzed, and only findings on those lines are reported.
+
+  A file is skipped altogether when none of its added lines holds code - e.g. when only
+  blank lines or '//' comments were added - as no finding could be reported for it.
+
+*/
+
+#include <stdint.h>
+
+
+
+int         diff_load(const char* diff_path);
+int         diff_enabled(void);
+uint32_t    diff_nfiles(void);
+const char* diff_file_path(uint32_t i);
+int         diff_file_relevant(const char* file_path);
+int         diff_line_changed(const char* file_path, uint32_t lineno);
+void        diff_free(void);
+
+
+
+#endif /* __DIFF_H__ */
+
@@ -0,0 +1,47 @@
+#ifndef __HASH_H__
+#define __HASH_H__
+
+/*
+
+Small, stable, non-cryptographic hash functions
+
+  Stable means: same input, same value - across runs and machines (byte-order aside).
+  Used for content hashes, path hashes and fingerprints that are stored in files.
+
+*/
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+
+/* 64-bit FNV-1a */
+static inline uint64_t hash_fnv1a64(const void* data, size_t len, uint64_t h)
+{
+  const uint8_t* p = (const uint8_t*)data;
+  size_t i;
+  for (i = 0; i < len; ++i)
+  {
+    h = (h ^ p[i]) * 0x100000001B3ull;
+  }
+  return h;
+}
+
+#define HASH_FNV1A64_INIT   0xCBF29CE484222325ull
+
+
+/* mix the bits of a 64-bit value - for hash-table slots */
+static inline uint64_t hash_mix64(uint64_t x)
+{
+  x ^= x >> 33;
+  x *= 0xFF51AFD7ED558CCDull;
+  x ^= x >> 33;
+  x *= 0xC4CEB9FE1A85EC53ull;
+  x ^= x >> 33;
+  return x;
+}
+
+
+
+#endif /* __HASH_H__ */
+
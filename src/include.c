@@ -0,0 +1,267 @@
+/*
+
+Following '#include "..."' directives
+
+  - seen-set:  open-addressing hash set of (st_dev, st_ino) pairs, grown at 50% load.
+  - pending:   FIFO of resolved header paths that have not been analyzed yet.
+
+*/
+
+#include "include.h"
+#include <assert.h>
+#include <stdio.h>     /* snprintf */
+#include <stdlib.h>    /* malloc, free */
+#include <string.h>    /* memcpy, strrchr */
+#include <sys/stat.h>  /* stat */
+
+
+#define MAXINCPATHS      64
+#define MAXPATHLEN     1024
+
+
+struct file_id
+{
+  uint64_t dev;
+  uint64_t ino;
+  int      used;
+};
+
+
+static int            follow = 0;
+static const char*    inc_paths[MAXINCPATHS];
+static int            ninc_paths = 0;
+
+static struct file_id* seen = 0;        /* hash set of analyzed files */
+static uint32_t       seen_size = 0;    /* number of slots - power of 2 */
+static uint32_t       seen_count = 0;
+
+static char**         pending = 0;      /* queue of headers to analyze */
+static uint32_t       pending_head = 0;
+static uint32_t       pending_tail = 0;
+static uint32_t       pending_cap = 0;
+static char*          pending_last = 0; /* last path handed out - freed on next call */
+
+
+
+void include_set_follow(int enabled)
+{
+  follow = enabled;
+}
+
+int include_follow_enabled(void)
+{
+  return follow;
+}
+
+void include_add_path(const char* dir)
+{
+  if (ninc_paths < MAXINCPATHS)
+  {
+    inc_paths[ninc_paths++] = dir;
+  }
+  else
+  {
+    fprintf(stderr, "WARNING: too many include paths, ignoring '%s'\n", dir);
+  }
+}
+
+
+static uint32_t hash_id(uint64_t dev, uint64_t ino)
+{
+  uint64_t h = (ino * 0x9E3779B97F4A7C15ull) ^ (dev * 0xC2B2AE3D27D4EB4Full);
+  return (uint32_t)(h ^ (h >> 32));
+}
+
+/* insert (dev, ino) - returns 1 if it was not present before */
+static int seen_insert(uint64_t dev, uint64_t ino)
+{
+  uint32_t i;
+
+  if ((seen_count * 2) >= seen_size)
+  {
+    /* grow and re-hash */
+    struct file_id* old = seen;
+    uint32_t old_size = seen_size;
+
+    seen_size = (seen_size == 0) ? 256 : (seen_size * 2);
+    seen = calloc(seen_size, sizeof(*seen));
+    assert(seen != 0);
+    seen_count = 0;
+
+    for (i = 0; i < old_size; ++i)
+    {
+      if (old[i].used)
+      {
+        seen_insert(old[i].dev, old[i].ino);
+      }
+    }
+    free(old);
+  }
+
+  i = hash_id(dev, ino) & (seen_size - 1);
+  while (seen[i].used)
+  {
+    if ((seen[i].dev == dev) && (seen[i].ino == ino))
+    {
+      return 0;
+    }
+    i = (i + 1) & (seen_size - 1);
+  }
+  seen[i].dev  = dev;
+  seen[i].ino  = ino;
+  seen[i].used = 1;
+  seen_count += 1;
+
+  return 1;
+}
+
+
+int include_mark_seen(const char* file_path)
+{
+  struct stat st;
+  if (stat(file_path, &st) != 0)
+  {
+    return -1;
+  }
+  return seen_insert((uint64_t)st.st_dev, (uint64_t)st.st_ino);
+}
+
+
+static void pending_push(const char* file_path)
+{
+  uint32_t len = (uint32_t)strlen(file_path) + 1;
+
+  if (pending_tail == pending_cap)
+  {
+    pending_cap = (pending_cap == 0) ? 64 : (pending_cap * 2);
+    pending = realloc(pending, pending_cap * sizeof(*pending));
+    assert(pending != 0);
+  }
+  pending[pending_tail] = malloc(len);
+  assert(pending[pending_tail] != 0);
+  memcpy(pending[pending_tail], file_path, len);
+  pending_tail += 1;
+}
+
+
+/* try 'dir/name' - queue it if it exists and has not been seen before. Returns 1 if the file exists. */
+static int try_resolve(const char* dir, int dir_len, const char* name, int name_len)
+{
+  char path[MAXPATHLEN];
+  int n;
+
+  if (dir_len > 0)
+  {
+    n = snprintf(path, sizeof(path), "%.*s/%.*s", dir_len, dir, name_len, name);
+  }
+  else
+  {
+    n = snprintf(path, sizeof(path), "%.*s", name_len, name);
+  }
+  if ((n <= 0) || (n >= (int)sizeof(path)))
+  {
+    return 0;
+  }
+
+  int is_new = include_mark_seen(path);
+  if (is_new < 0)
+  {
+    return 0;
+  }
+  if (is_new)
+  {
+    pending_push(path);
+  }
+  return 1;
+}
+
+
+void include_directive(const char* file_path, const char* directive, uint32_t len)
+{
+  const char* p   = directive;
+  const char* end = directive + len;
+
+  if (!follow)
+  {
+    return;
+  }
+
+  /* Match '#' [ws] 'include' [ws] '"' name '"' */
+  p += 1;
+  while ((p < end) && ((*p == ' ') || (*p == '\t')))
+  {
+    p += 1;
+  }
+  if (((end - p) < 7) || (strncmp(p, "include", 7) != 0))
+  {
+    return;
+  }
+  p += 7;
+  while ((p < end) && ((*p == ' ') || (*p == '\t')))
+  {
+    p += 1;
+  }
+  if ((p >= end) || (*p != '"'))
+  {
+    return; /* <system> headers and macro-includes are not followed */
+  }
+  p += 1;
+
+  const char* name = p;
+  while ((p < end) && (*p != '"') && (*p != '\n'))
+  {
+    p += 1;
+  }
+  if ((p >= end) || (*p != '"') || (p == name))
+  {
+    return;
+  }
+  int name_len = (int)(p - name);
+
+  /* Search the directory of the including file first, then the include paths in order */
+  const char* slash = strrchr(file_path, '/');
+  int found = (name[0] == '/')
+            ? try_resolve("", 0, name, name_len)
+            : try_resolve(file_path, (slash != 0) ? (int)(slash - file_path) : 0, name, name_len);
+
+  int i;
+  for (i = 0; (i < ninc_paths) && !found && (name[0] != '/'); ++i)
+  {
+    found = try_resolve(inc_paths[i], (int)strlen(inc_paths[i]), name, name_len);
+  }
+}
+
+
+const char* include_next_pending(void)
+{
+  if (pending_last != 0)
+  {
+    free(pending_last);
+    pending_last = 0;
+  }
+  if (pending_head == pending_tail)
+  {
+    pending_head = 0;
+    pending_tail = 0;
+    return 0;
+  }
+  pending_last = pending[pending_head++];
+  return pending_last;
+}
+
+
+void include_free(void)
+{
+  while (include_next_pending() != 0)
+  {
+    /* drain and free queued paths */
+  }
+  free(pending);
+  free(seen);
+  pending = 0;
+  pending_cap = 0;
+  seen = 0;
+  seen_size = 0;
+  seen_count = 0;
+}
+
@@ -0,0 +1,30 @@
+#ifndef __INCLUDE_H__
+#define __INCLUDE_H__
+
+/*
+
+Following '#include "..."' directives
+
+  When enabled, quoted includes are resolved against the directory of the including file
+  and then against the configured include paths. Headers found this way are queued for
+  analysis. Every file is analyzed at most once per run - files are identified by their
+  device and inode number, so different paths to the same file are de-duplicated too.
+
+*/
+
+#include <stdint.h>
+
+
+
+void        include_set_follow(int enabled);
+int         include_follow_enabled(void);
+void        include_add_path(const char* dir);
+int         include_mark_seen(const char* file_path);
+void        include_directive(const char* file_path, const char* directive, uint32_t len);
+const char* include_next_pending(void);
+void        include_free(void);
+
+
+
+#endif /* __INCLUDE_H__ */
+
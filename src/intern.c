@@ -0,0 +1,215 @@
+/*
+
+String interner
+
+  Per shard:
+    - slots:    open-addressing hash table of entry index + 1 (0: empty), grown at 50% load.
+    - entries:  pointer, length and hash of each string, indexed by the id's upper bits.
+    - chunks:   linked list of character blocks the strings are copied into.
+
+*/
+
+#include "intern.h"
+#include "hash.h"
+#include <assert.h>
+#include <pthread.h>
+#include <stdlib.h>  /* malloc, calloc, realloc, free */
+#include <string.h>  /* memcmp, memcpy */
+
+
+#define CHUNK_SIZE   (64 * 1024)
+
+
+struct intern_entry
+{
+  const char* str;
+  uint32_t    len;
+  uint32_t    hash;
+};
+
+struct intern_chunk
+{
+  struct intern_chunk* next;
+  char                 data[];
+};
+
+struct intern_shard
+{
+  pthread_mutex_t      lock;
+  uint32_t*            slots;
+  uint32_t             nslots;     /* power of 2 */
+  struct intern_entry* entries;
+  uint32_t             nentries;
+  uint32_t             maxentries;
+  struct intern_chunk* chunks;
+  uint32_t             chunk_used;
+  uint32_t             chunk_size;
+};
+
+
+static struct intern_shard shards[INTERN_NSHARDS];
+static pthread_once_t      init_once = PTHREAD_ONCE_INIT;
+
+
+
+static void intern_init(void)
+{
+  uint32_t i;
+  for (i = 0; i < INTERN_NSHARDS; ++i)
+  {
+    memset(&shards[i], 0, sizeof(shards[i]));
+    pthread_mutex_init(&shards[i].lock, 0);
+  }
+}
+
+
+/* copy a string into the shard's chunks, null-terminated */
+static const char* shard_copy(struct intern_shard* sh, const char* str, uint32_t len)
+{
+  if ((sh->chunks == 0) || ((sh->chunk_used + len + 1) > sh->chunk_size))
+  {
+    uint32_t size = (len + 1 > CHUNK_SIZE) ? (len + 1) : CHUNK_SIZE;
+    struct intern_chunk* c = malloc(sizeof(*c) + size);
+    assert(c != 0);
+    c->next = sh->chunks;
+    sh->chunks = c;
+    sh->chunk_used = 0;
+    sh->chunk_size = size;
+  }
+  char* copy = &sh->chunks->data[sh->chunk_used];
+  memcpy(copy, str, len);
+  copy[len] = 0;
+  sh->chunk_used += len + 1;
+  return copy;
+}
+
+
+static uint32_t* shard_slot(struct intern_shard* sh, const char* str, uint32_t len, uint32_t h)
+{
+  uint32_t i = h & (sh->nslots - 1);
+  while (sh->slots[i] != 0)
+  {
+    const struct intern_entry* e = &sh->entries[sh->slots[i] - 1];
+    if (    (e->hash == h)
+         && (e->len == len)
+         && (memcmp(e->str, str, len) == 0))
+    {
+      break;
+    }
+    i = (i + 1) & (sh->nslots - 1);
+  }
+  return &sh->slots[i];
+}
+
+
+static void shard_grow(struct intern_shard* sh)
+{
+  uint32_t i;
+
+  free(sh->slots);
+  sh->nslots = (sh->nslots == 0) ? 256 : (2 * sh->nslots);
+  sh->slots = calloc(sh->nslots, sizeof(*sh->slots));
+  assert(sh->slots != 0);
+
+  for (i = 0; i < sh->nentries; ++i)
+  {
+    const struct intern_entry* e = &sh->entries[i];
+    *shard_slot(sh, e->str, e->len, e->hash) = i + 1;
+  }
+}
+
+
+uint32_t intern(const char* str, uint32_t len)
+{
+  uint64_t h64 = hash_mix64(hash_fnv1a64(str, len, HASH_FNV1A64_INIT));
+  uint32_t shard = (uint32_t)(h64 >> 58) & (INTERN_NSHARDS - 1);  /* top bits pick the shard, low bits the slot */
+  uint32_t h = (uint32_t)h64;
+  struct intern_shard* sh = &shards[shard];
+  uint32_t idx;
+
+  pthread_once(&init_once, intern_init);
+  pthread_mutex_lock(&sh->lock);
+
+  if ((sh->nentries * 2) >= sh->nslots)
+  {
+    shard_grow(sh);
+  }
+
+  uint32_t* slot = shard_slot(sh, str, len, h);
+  if (*slot != 0)
+  {
+    idx = *slot - 1;
+  }
+  else
+  {
+    if (sh->nentries == sh->maxentries)
+    {
+      sh->maxentries = (sh->maxentries == 0) ? 256 : (2 * sh->maxentries);
+      sh->entries = realloc(sh->entries, sh->maxentries * sizeof(*sh->entries));
+      assert(sh->entries != 0);
+    }
+    idx = sh->nentries++;
+    sh->entries[idx].str  = shard_copy(sh, str, len);
+    sh->entries[idx].len  = len;
+    sh->entries[idx].hash = h;
+    *slot = idx + 1;
+  }
+
+  pthread_mutex_unlock(&sh->lock);
+  return (idx << INTERN_SHARD_BITS) | shard;
+}
+
+
+const char* intern_str(uint32_t id)
+{
+  struct intern_shard* sh = &shards[id & (INTERN_NSHARDS - 1)];
+  uint32_t idx = id >> INTERN_SHARD_BITS;
+  const char* str = 0;
+
+  pthread_once(&init_once, intern_init);
+  pthread_mutex_lock(&sh->lock);
+  if (idx < sh->nentries)
+  {
+    str = sh->entries[idx].str;
+  }
+  pthread_mutex_unlock(&sh->lock);
+  return str;
+}
+
+
+uint32_t intern_count(void)
+{
+  uint32_t n = 0;
+  uint32_t i;
+  for (i = 0; i < INTERN_NSHARDS; ++i)
+  {
+    n += shards[i].nentries;
+  }
+  return n;
+}
+
+
+void intern_free(void)
+{
+  uint32_t i;
+  for (i = 0; i < INTERN_NSHARDS; ++i)
+  {
+    struct intern_shard* sh = &shards[i];
+    while (sh->chunks != 0)
+    {
+      struct intern_chunk* next = sh->chunks->next;
+      free(sh->chunks);
+      sh->chunks = next;
+    }
+    free(sh->slots);
+    free(sh->entries);
+    sh->slots = 0;
+    sh->nslots = 0;
+    sh->entries = 0;
+    sh->nentries = 0;
+    sh->maxentries = 0;
+    sh->chunk_used = 0;
+    sh->chunk_size = 0;
+  }
+}
+
@@ -0,0 +1,39 @@
+#ifndef __INTERN_H__
+#define __INTERN_H__
+
+/*
+
+String interner
+
+  Maps strings to small, dense 32-bit ids - equal strings get equal ids, so names can be
+  stored and compared as integers. Strings are copied into large chunks that never move,
+  so the pointer returned by intern_str() stays valid until intern_free().
+
+  The table is split into 2^INTERN_SHARD_BITS shards by hash, each with its own lock, so
+  threads interning different names rarely wait for each other. The shard is part of the
+  id: id = (index within shard << INTERN_SHARD_BITS) | shard.
+
+  The lexer interns every identifier, keyword and operator, so each token carries the id
+  of its symbol in token.symid - checkers compare names as integers, and can key per-name
+  state by id.
+
+*/
+
+#include <stdint.h>
+
+
+#define INTERN_SHARD_BITS   6
+#define INTERN_NSHARDS      (1u << INTERN_SHARD_BITS)
+#define INTERN_NONE         0xFFFFFFFFu
+
+
+
+uint32_t    intern(const char* str, uint32_t len);
+const char* intern_str(uint32_t id);
+uint32_t    intern_count(void);
+void        intern_free(void);
+
+
+
+#endif /* __INTERN_H__ */
+
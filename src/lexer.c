@@ -8,14 +8,14 @@
       - single- and multi-line comments
       - string literals
       - char literals
-      - hex, int and float numerals
-      - ANSI C89 keywords
+      - C99 numeric literals: decimal, octal, hex, floats, hex floats, suffixes
       - ANSI C89 operators
+      - keywords of the selected dialect: C89, C99, C11 or GNU C
 
 
     Work-flow:
     ----------
-      - define list of reserved keywords + operators
+      - pick the keyword + operator table of a dialect - built-in, shared by all lexers
       - read a file
       - try treating input as (in prioritized sequence):
           comment
@@ -43,27 +43,258 @@
 
 
 #include "lexer.h"
+#include "intern.h"
+#include "ppcond.h"
 #include "str.h"
 #include <assert.h> /* for assert            */
+#include <pthread.h> /* for pthread_once     */
 #include <stdlib.h> /* for exit              */
 #include <stdio.h>  /* for printf + fgetc    */
 #include <stdint.h> /* for intX_t            */
-#include <string.h> /* for strncmp           */
+#include <string.h> /* for strncmp, memcpy   */
 
 
 
-static int idx_first_tok_keyword;
+
+/* Character classes - one table lookup per byte instead of chains of range compares */
+#define CC_SPACE     0x01   /* ' ' \t \n \v \f \r          */
+#define CC_DIGIT     0x02   /* 0-9                        */
+#define CC_HEX       0x04   /* 0-9 a-f A-F                */
+#define CC_IDSTART   0x08   /* _ a-z A-Z                  */
+#define CC_OPERATOR  0x10   /* first char of an operator  */
+#define CC_IDENT     (CC_IDSTART | CC_DIGIT)
+
+#define S  CC_SPACE
+#define D  CC_DIGIT
+#define X  CC_HEX
+#define I  CC_IDSTART
+#define O  CC_OPERATOR
+static const uint8_t char_class[256] =
+{
+  0  , 0  , 0  , 0  , 0  , 0  , 0  , 0  , 0  , S  , S  , S  , S  , S  , 0  , 0  ,
+  0  , 0  , 0  , 0  , 0  , 0  , 0  , 0  , 0  , 0  , 0  , 0  , 0  , 0  , 0  , 0  ,
+  S  , O  , 0  , 0  , 0  , O  , O  , 0  , O  , O  , O  , O  , O  , O  , O  , O  ,
+  D|X, D|X, D|X, D|X, D|X, D|X, D|X, D|X, D|X, D|X, O  , O  , O  , O  , O  , O  ,
+  0  , X|I, X|I, X|I, X|I, X|I, X|I, I  , I  , I  , I  , I  , I  , I  , I  , I  ,
+  I  , I  , I  , I  , I  , I  , I  , I  , I  , I  , I  , O  , 0  , O  , O  , I  ,
+  0  , X|I, X|I, X|I, X|I, X|I, X|I, I  , I  , I  , I  , I  , I  , I  , I  , I  ,
+  I  , I  , I  , I  , I  , I  , I  , I  , I  , I  , I  , O  , O  , O  , O  , 0  ,
+  0  , 0  , 0  , 0  , 0  , 0  , 0  , 0  , 0  , 0  , 0  , 0  , 0  , 0  , 0  , 0  ,
+  0  , 0  , 0  , 0  , 0  , 0  , 0  , 0  , 0  , 0  , 0  , 0  , 0  , 0  , 0  , 0  ,
+  0  , 0  , 0  , 0  , 0  , 0  , 0  , 0  , 0  , 0  , 0  , 0  , 0  , 0  , 0  , 0  ,
+  0  , 0  , 0  , 0  , 0  , 0  , 0  , 0  , 0  , 0  , 0  , 0  , 0  , 0  , 0  , 0  ,
+  0  , 0  , 0  , 0  , 0  , 0  , 0  , 0  , 0  , 0  , 0  , 0  , 0  , 0  , 0  , 0  ,
+  0  , 0  , 0  , 0  , 0  , 0  , 0  , 0  , 0  , 0  , 0  , 0  , 0  , 0  , 0  , 0  ,
+  0  , 0  , 0  , 0  , 0  , 0  , 0  , 0  , 0  , 0  , 0  , 0  , 0  , 0  , 0  , 0  ,
+  0  , 0  , 0  , 0  , 0  , 0  , 0  , 0  , 0  , 0  , 0  , 0  , 0  , 0  , 0  , 0  ,
+};
+#undef S
+#undef D
+#undef X
+#undef I
+#undef O
+
+#define char_is(c, cls)   (char_class[(uint8_t)(c)] & (cls))
+
+
+/* ============================================ */
+/* Lexer alphabets: operators + dialect keywords */
+/* ============================================ */
+
+#define STD(x)     (1u << LEXER_STD_##x)
+#define C89_UP     (STD(C89) | STD(C99) | STD(C11) | STD(GNU))
+#define C99_UP     (STD(C99) | STD(C11) | STD(GNU))
+#define C11_UP     (STD(C11) | STD(GNU))
+#define GNU        STD(GNU)
+
+/* One entry of the built-in table - 'stds' are the dialects that have it */
+struct lexeme_def
+{
+  const char* symbol;
+  uint8_t     symlen;
+  uint8_t     tokknd;
+  uint8_t     toktyp;
+  uint8_t     stds;
+};
+
+#define LEXEME(symbol, kind, type, stds)   { symbol, (sizeof(symbol) - 1), kind, type, stds }
+
+static const struct lexeme_def lexeme_defs[] =
+{
+  /* The 43 primitives / operators in C89 - first, in type order: kwid == toktyp */
+  LEXEME(">>=",            TOK_OPERATOR,   OP_ASSIGN_LSH,       C89_UP),
+  LEXEME("<<=",            TOK_OPERATOR,   OP_ASSIGN_RSH,       C89_UP),
+  LEXEME(">>",             TOK_OPERATOR,   OP_LSH,              C89_UP),
+  LEXEME("<<",             TOK_OPERATOR,   OP_RSH,              C89_UP),
+  LEXEME("!=",             TOK_OPERATOR,   OP_NOT_EQUAL,        C89_UP),
+  LEXEME("==",             TOK_OPERATOR,   OP_EQUAL,            C89_UP),
+  LEXEME("+=",             TOK_OPERATOR,   OP_ASSIGN_PLUS,      C89_UP),
+  LEXEME("-=",             TOK_OPERATOR,   OP_ASSIGN_MINUS,     C89_UP),
+  LEXEME("*=",             TOK_OPERATOR,   OP_ASSIGN_MULTIPLY,  C89_UP),
+  LEXEME("/=",             TOK_OPERATOR,   OP_ASSIGN_DIVIDE,    C89_UP),
+  LEXEME("&=",             TOK_OPERATOR,   OP_ASSIGN_AND,       C89_UP),
+  LEXEME("|=",             TOK_OPERATOR,   OP_ASSIGN_OR,        C89_UP),
+  LEXEME("^=",             TOK_OPERATOR,   OP_ASSIGN_XOR,       C89_UP),
+  LEXEME("++",             TOK_OPERATOR,   OP_INCREMENT,        C89_UP),
+  LEXEME("--",             TOK_OPERATOR,   OP_DECREMENT,        C89_UP),
+  LEXEME("&&",             TOK_OPERATOR,   OP_LOGICAL_AND,      C89_UP),
+  LEXEME("||",             TOK_OPERATOR,   OP_LOGICAL_OR,       C89_UP),
+  LEXEME("->",             TOK_OPERATOR,   OP_ARROW,            C89_UP),
+  LEXEME(">=",             TOK_OPERATOR,   OP_LOGICAL_GTE,      C89_UP),
+  LEXEME("<=",             TOK_OPERATOR,   OP_LOGICAL_LTE,      C89_UP),
+  LEXEME("!",              TOK_OPERATOR,   OP_LOGICAL_NOT,      C89_UP),
+  LEXEME("~",              TOK_OPERATOR,   OP_BITWISE_NOT,      C89_UP),
+  LEXEME(";",              TOK_OPERATOR,   OP_SEMICOLON,        C89_UP),
+  LEXEME(":",              TOK_OPERATOR,   OP_COLON,            C89_UP),
+  LEXEME("?",              TOK_OPERATOR,   OP_QUESTIONMARK,     C89_UP),
+  LEXEME(",",              TOK_OPERATOR,   OP_COMMA,            C89_UP),
+  LEXEME(".",              TOK_OPERATOR,   OP_DOT,              C89_UP),
+  LEXEME("+",              TOK_OPERATOR,   OP_PLUS,             C89_UP),
+  LEXEME("-",              TOK_OPERATOR,   OP_MINUS,            C89_UP),
+  LEXEME("*",              TOK_OPERATOR,   OP_MULTIPLY,         C89_UP),
+  LEXEME("/",              TOK_OPERATOR,   OP_DIVIDE,           C89_UP),
+  LEXEME(">",              TOK_OPERATOR,   OP_LOGICAL_GT,       C89_UP),
+  LEXEME("<",              TOK_OPERATOR,   OP_LOGICAL_LT,       C89_UP),
+  LEXEME("&",              TOK_OPERATOR,   OP_BITWISE_AND,      C89_UP),
+  LEXEME("|",              TOK_OPERATOR,   OP_BITWISE_OR,       C89_UP),
+  LEXEME("^",              TOK_OPERATOR,   OP_BITWISE_XOR,      C89_UP),
+  LEXEME("%",              TOK_OPERATOR,   OP_MODULO,           C89_UP),
+  LEXEME("=",              TOK_OPERATOR,   OP_ASSIGN,           C89_UP),
+  LEXEME("(",              TOK_OPERATOR,   OP_LPAREN,           C89_UP),
+  LEXEME(")",              TOK_OPERATOR,   OP_RPAREN,           C89_UP),
+  LEXEME("{",              TOK_OPERATOR,   OP_LBRACE,           C89_UP),
+  LEXEME("}",              TOK_OPERATOR,   OP_RBRACE,           C89_UP),
+  LEXEME("[",              TOK_OPERATOR,   OP_LBRACKET,         C89_UP),
+  LEXEME("]",              TOK_OPERATOR,   OP_RBRACKET,         C89_UP),
+
+  /* Fixed-width integer types of <stdint.h> - treated as keywords in every dialect */
+  LEXEME("int8_t",         TOK_KEYWORD,    KW_INT,              C89_UP),
+  LEXEME("int16_t",        TOK_KEYWORD,    KW_INT,              C89_UP),
+  LEXEME("int32_t",        TOK_KEYWORD,    KW_INT,              C89_UP),
+  LEXEME("int64_t",        TOK_KEYWORD,    KW_INT,              C89_UP),
+  LEXEME("uint8_t",        TOK_KEYWORD,    KW_INT,              C89_UP),
+  LEXEME("uint16_t",       TOK_KEYWORD,    KW_INT,              C89_UP),
+  LEXEME("uint32_t",       TOK_KEYWORD,    KW_INT,              C89_UP),
+  LEXEME("uint64_t",       TOK_KEYWORD,    KW_INT,              C89_UP),
+
+  /* The 32 reserved keywords of C: */
+  LEXEME("auto",           TOK_KEYWORD,    KW_AUTO,             C89_UP),
+  LEXEME("break",          TOK_KEYWORD,    KW_BREAK,            C89_UP),
+  LEXEME("case",           TOK_KEYWORD,    KW_CASE,             C89_UP),
+  LEXEME("char",           TOK_KEYWORD,    KW_CHAR,             C89_UP),
+  LEXEME("const",          TOK_KEYWORD,    KW_CONST,            C89_UP),
+  LEXEME("continue",       TOK_KEYWORD,    KW_CONTINUE,         C89_UP),
+  LEXEME("default",        TOK_KEYWORD,    KW_DEFAULT,          C89_UP),
+  LEXEME("do",             TOK_KEYWORD,    KW_DO,               C89_UP),
+  LEXEME("double",         TOK_KEYWORD,    KW_DOUBLE,           C89_UP),
+  LEXEME("else",           TOK_KEYWORD,    KW_ELSE,             C89_UP),
+  LEXEME("enum",           TOK_KEYWORD,    KW_ENUM,             C89_UP),
+  LEXEME("extern",         TOK_KEYWORD,    KW_EXTERN,           C89_UP),
+  LEXEME("float",          TOK_KEYWORD,    KW_FLOAT,            C89_UP),
+  LEXEME("for",            TOK_KEYWORD,    KW_FOR,              C89_UP),
+  LEXEME("goto",           TOK_KEYWORD,    KW_GOTO,             C89_UP),
+  LEXEME("if",             TOK_KEYWORD,    KW_IF,               C89_UP),
+  LEXEME("int",            TOK_KEYWORD,    KW_INT,              C89_UP),
+  LEXEME("long",           TOK_KEYWORD,    KW_LONG,             C89_UP),
+  LEXEME("register",       TOK_KEYWORD,    KW_REGISTER,         C89_UP),
+  LEXEME("return",         TOK_KEYWORD,    KW_RETURN,           C89_UP),
+  LEXEME("short",          TOK_KEYWORD,    KW_SHORT,            C89_UP),
+  LEXEME("signed",         TOK_KEYWORD,    KW_SIGNED,           C89_UP),
+  LEXEME("sizeof",         TOK_KEYWORD,    KW_SIZEOF,           C89_UP),
+  LEXEME("static",         TOK_KEYWORD,    KW_STATIC,           C89_UP),
+  LEXEME("struct",         TOK_KEYWORD,    KW_STRUCT,           C89_UP),
+  LEXEME("switch",         TOK_KEYWORD,    KW_SWITCH,           C89_UP),
+  LEXEME("typedef",        TOK_KEYWORD,    KW_TYPEDEF,          C89_UP),
+  LEXEME("union",          TOK_KEYWORD,    KW_UNION,            C89_UP),
+  LEXEME("unsigned",       TOK_KEYWORD,    KW_UNSIGNED,         C89_UP),
+  LEXEME("void",           TOK_KEYWORD,    KW_VOID,             C89_UP),
+  LEXEME("volatile",       TOK_KEYWORD,    KW_VOLATILE,         C89_UP),
+  LEXEME("while",          TOK_KEYWORD,    KW_WHILE,            C89_UP),
+
+  /* C99: */
+  LEXEME("inline",         TOK_KEYWORD,    KW_INLINE,           C99_UP),
+  LEXEME("restrict",       TOK_KEYWORD,    KW_RESTRICT,         C99_UP),
+  LEXEME("_Bool",          TOK_KEYWORD,    KW_BOOL,             C99_UP),
+  LEXEME("_Complex",       TOK_KEYWORD,    KW_COMPLEX,          C99_UP),
+  LEXEME("_Imaginary",     TOK_KEYWORD,    KW_IMAGINARY,        C99_UP),
+
+  /* C11: */
+  LEXEME("_Alignas",       TOK_KEYWORD,    KW_ALIGNAS,          C11_UP),
+  LEXEME("_Alignof",       TOK_KEYWORD,    KW_ALIGNOF,          C11_UP),
+  LEXEME("_Atomic",        TOK_KEYWORD,    KW_ATOMIC,           C11_UP),
+  LEXEME("_Generic",       TOK_KEYWORD,    KW_GENERIC,          C11_UP),
+  LEXEME("_Noreturn",      TOK_KEYWORD,    KW_NORETURN,         C11_UP),
+  LEXEME("_Static_assert", TOK_KEYWORD,    KW_STATIC_ASSERT,    C11_UP),
+  LEXEME("_Thread_local",  TOK_KEYWORD,    KW_THREAD_LOCAL,     C11_UP),
+
+  /* GNU C - plain asm and typeof only in gnu; the reserved __x__ spellings in every dialect, as compilers do: */
+  LEXEME("asm",            TOK_KEYWORD,    KW_ASM,              GNU),
+  LEXEME("__asm",          TOK_KEYWORD,    KW_ASM,              C89_UP),
+  LEXEME("__asm__",        TOK_KEYWORD,    KW_ASM,              C89_UP),
+  LEXEME("typeof",         TOK_KEYWORD,    KW_TYPEOF,           GNU),
+  LEXEME("__typeof",       TOK_KEYWORD,    KW_TYPEOF,           C89_UP),
+  LEXEME("__typeof__",     TOK_KEYWORD,    KW_TYPEOF,           C89_UP),
+  LEXEME("__attribute",    TOK_KEYWORD,    KW_ATTRIBUTE,        C89_UP),
+  LEXEME("__attribute__",  TOK_KEYWORD,    KW_ATTRIBUTE,        C89_UP),
+  LEXEME("__extension__",  TOK_KEYWORD,    KW_EXTENSION,        C89_UP),
+  LEXEME("__inline",       TOK_KEYWORD,    KW_INLINE,           C89_UP),
+  LEXEME("__inline__",     TOK_KEYWORD,    KW_INLINE,           C89_UP),
+  LEXEME("__restrict",     TOK_KEYWORD,    KW_RESTRICT,         C89_UP),
+  LEXEME("__restrict__",   TOK_KEYWORD,    KW_RESTRICT,         C89_UP),
+  LEXEME("__complex__",    TOK_KEYWORD,    KW_COMPLEX,          C89_UP),
+  LEXEME("__alignof",      TOK_KEYWORD,    KW_ALIGNOF,          C89_UP),
+  LEXEME("__alignof__",    TOK_KEYWORD,    KW_ALIGNOF,          C89_UP),
+  LEXEME("__thread",       TOK_KEYWORD,    KW_THREAD_LOCAL,     C89_UP),
+  LEXEME("__const",        TOK_KEYWORD,    KW_CONST,            C89_UP),
+  LEXEME("__const__",      TOK_KEYWORD,    KW_CONST,            C89_UP),
+  LEXEME("__signed",       TOK_KEYWORD,    KW_SIGNED,           C89_UP),
+  LEXEME("__signed__",     TOK_KEYWORD,    KW_SIGNED,           C89_UP),
+  LEXEME("__volatile",     TOK_KEYWORD,    KW_VOLATILE,         C89_UP),
+  LEXEME("__volatile__",   TOK_KEYWORD,    KW_VOLATILE,         C89_UP),
+};
+
+#undef LEXEME
+#undef STD
+#undef C89_UP
+#undef C99_UP
+#undef C11_UP
+#undef GNU
+
+#define NLEXEME_DEFS   (sizeof(lexeme_defs) / sizeof(lexeme_defs[0]))
+#define ALPHABET_HASH  512   /* slots of a dialect's keyword lookup - keeps the load factor below 50% */
+
+
+/* The table of one dialect with its lookup structures - filled in once per process, then read-only */
+struct alphabet
+{
+  struct token lexemes[NLEXEME_DEFS];
+  uint32_t     nlexemes;
+  uint32_t     kwhash[ALPHABET_HASH];
+};
+
+static struct alphabet  alphabets[LEXER_NSTDS];
+static pthread_once_t   alphabets_once = PTHREAD_ONCE_INIT;
+
+
+/* Operators by first char, longest first - the same in every dialect */
+#define MAXOPCANDS   8
+static uint8_t op_cands[256][MAXOPCANDS];
+static uint8_t op_ncands[256];
 
 
 /* assertion function that prints out line and char number before exiting. */
 static void _expect(struct lexer* l, int p, int line);
 #define expect(l, p) _expect(l, p, __LINE__)
 
-static void print_token(struct lexer* l, struct token* t);
 static void emit(struct lexer* l, struct token* next_tok, int token_kind, int token_type);
 static void next(struct lexer* l);
 static void consume(struct lexer* l);
+static void consume_run(struct lexer* l, uint32_t len);
+static void skip_space(struct lexer* l);
 static void skip_comments(struct lexer* l);
+static void skip_directive_line(struct lexer* l);
+static void pp_conditional(struct lexer* l, const char* directive);
+static void alphabets_build(void);
 
 
 
@@ -76,20 +307,43 @@ void lexer_reset_state(struct lexer* l)
   l->buffer_original = 0;
   l->token_buffer[0] = 0;
   l->token_length = 0;
+  l->token_start = 0;
   l->cur_lineno = 1;
   l->cur_byteno = 0;
+  l->pp_depth = 0;
 }
 
 void lexer_init(struct lexer* l)
 {
-  l->nkeywords = 0;
+  l->lexemes = 0;
+  l->nlexemes = 0;
+  l->types = 0;
+  l->ntypes = 0;
+  l->maxtypes = 0;
+  l->kwhash = 0;
+  l->types_kwhash = 0;
+  l->kwhash_size = 0;
   l->continue_on_error = 0;//1;
+  l->on_directive = 0;
   lexer_reset_state(l);
 }
 
 void lexer_free(struct lexer* l)
 {
-  (void) l;
+  uint32_t i;
+  for (i = 0; i < l->ntypes; ++i)
+  {
+    free(l->types[i].symbol); /* names copied by lexer_add_type() */
+  }
+  free(l->types);
+  free(l->types_kwhash);
+  l->types = 0;
+  l->types_kwhash = 0;
+  l->ntypes = 0;
+  l->maxtypes = 0;
+  l->kwhash = 0;
+  l->lexemes = 0;
+  l->nlexemes = 0;
 }
 
 void lexer_set_char_buf(struct lexer* l, char* char_buf)
@@ -102,15 +356,116 @@ void lexer_set_char_buf(struct lexer* l, char* char_buf)
   l->buffer_original = char_buf;
 }
 
-void lexer_add_token(struct lexer* l, char* token_symbol, int token_strlen, int token_kind, int token_type)
+
+static uint32_t kwhash_calc(const char* symbol, uint32_t symlen)
+{
+  /* FNV-1a */
+  uint32_t h = 2166136261u;
+  uint32_t i;
+  for (i = 0; i < symlen; ++i)
+  {
+    h = (h ^ (uint8_t)symbol[i]) * 16777619u;
+  }
+  return h;
+}
+
+static void kwhash_put(uint32_t* kwhash, uint32_t kwhash_size, const struct token* kw)
+{
+  uint32_t mask = kwhash_size - 1;
+  uint32_t h = kwhash_calc(kw->symbol, kw->symlen) & mask;
+  while (kwhash[h] != 0)
+  {
+    h = (h + 1) & mask;
+  }
+  kwhash[h] = kw->kwid + 1;
+}
+
+/* (re-)build the lexer's own lookup table: the dialect's keywords + the registered types */
+static void kwhash_rebuild(struct lexer* l, uint32_t kwhash_size)
+{
+  uint32_t i;
+  free(l->types_kwhash);
+  l->types_kwhash = calloc(kwhash_size, sizeof(*l->types_kwhash));
+  expect(l, l->types_kwhash != 0);
+  l->kwhash = l->types_kwhash;
+  l->kwhash_size = kwhash_size;
+
+  for (i = 0; i < l->nlexemes; ++i)
+  {
+    if (l->lexemes[i].tokknd == TOK_KEYWORD)
+    {
+      kwhash_put(l->types_kwhash, kwhash_size, &l->lexemes[i]);
+    }
+  }
+  for (i = 0; i < l->ntypes; ++i)
+  {
+    kwhash_put(l->types_kwhash, kwhash_size, &l->types[i]);
+  }
+}
+
+/* Register a type name (e.g. from a typedef) as a keyword. Returns its keyword id. */
+uint32_t lexer_add_type(struct lexer* l, const char* type_name, uint32_t type_len)
 {
-  expect(l, l->nkeywords < (sizeof(l->lexemes) / sizeof(*l->lexemes)));
+  uint32_t kwid = lexer_find_keyword(l, type_name, type_len);
+  if (kwid == KWID_NONE)
+  {
+    struct token* t;
+    char* symbol = malloc(type_len + 1);
+    expect(l, symbol != 0);
+    memcpy(symbol, type_name, type_len);
+    symbol[type_len] = 0;
+
+    if (l->ntypes == l->maxtypes)
+    {
+      l->maxtypes = (l->maxtypes == 0) ? MAXNTOKENS : (2 * l->maxtypes);
+      l->types = realloc(l->types, l->maxtypes * sizeof(*l->types));
+      expect(l, l->types != 0);
+    }
 
-  l->lexemes[l->nkeywords].symbol = token_symbol;  /* string symbol, e.g. "+" for the plus operator, or "goto" etc. */
-  l->lexemes[l->nkeywords].symlen = token_strlen;  /* length of above string excluding null-termination. */
-  l->lexemes[l->nkeywords].tokknd = token_kind;    /* overall lexeme class / type differentiator. */
-  l->lexemes[l->nkeywords].toktyp = token_type;    /* e.g. tokknd == TOK_OPERATOR && toktyp == OP_LSH. */
-  l->nkeywords += 1;
+    kwid = l->nlexemes + l->ntypes;
+    t = &l->types[l->ntypes++];
+    t->symbol = symbol;
+    t->symlen = type_len;
+    t->tokknd = TOK_KEYWORD;
+    t->toktyp = KW_TYPE_NAME;
+    t->kwid   = kwid;
+    t->symid  = intern(symbol, type_len);
+
+    /* the dialect's table is shared: copy it on the first type, keep the load factor below 50% */
+    if (    (l->types_kwhash == 0)
+         || ((2 * (kwid + 1)) > l->kwhash_size))
+    {
+      uint32_t size = l->kwhash_size;
+      while ((2 * (kwid + 1)) > size)
+      {
+        size *= 2;
+      }
+      kwhash_rebuild(l, size);
+    }
+    else
+    {
+      kwhash_put(l->types_kwhash, l->kwhash_size, t);
+    }
+  }
+  return kwid;
+}
+
+/* Look up a keyword by name - returns its keyword id or KWID_NONE. */
+uint32_t lexer_find_keyword(const struct lexer* l, const char* symbol, uint32_t symlen)
+{
+  uint32_t mask = l->kwhash_size - 1;
+  uint32_t h = kwhash_calc(symbol, symlen) & mask;
+  while (l->kwhash[h] != 0)
+  {
+    const struct token* kw = lexer_lexeme(l, l->kwhash[h] - 1);
+    if (    (kw->symlen == symlen)
+         && (memcmp(kw->symbol, symbol, symlen) == 0))
+    {
+      return l->kwhash[h] - 1;
+    }
+    h = (h + 1) & mask;
+  }
+  return KWID_NONE;
 }
 
 struct token lexer_next_token(struct lexer* l)
@@ -132,28 +487,30 @@ struct token lexer_next_token(struct lexer* l)
         t.symlen = 5;
         t.tokknd = TOK_EOF;
         t.toktyp = 0;
+        t.kwid   = KWID_NONE;
+        t.symid  = SYMID_NONE;
       return t;
 
       /* Whitespace: ignore it. */
-      case '\f': next(l); continue;
-      case '\r': next(l); continue;
-      case '\n': next(l); continue;
-      case '\t': next(l); continue;
-      case ' ':  next(l); continue;
+      case '\f':
+      case '\v':
+      case '\r':
+      case '\n':
+      case '\t':
+      case ' ':
+        skip_space(l);
+        continue;
 
       /* Preprocessor directives; lines starting with <'#'> : ignore them. */
       case '#':
       {
-        while (    (    (l->buffer[0] != 0)
-                     && (l->buffer[0] != '\n')
-                     && (l->buffer[0] != EOF))
-                || (l->buffer[-1] == '\\'))
-        { 
-          /* Handle comments: */
-          //skip_comments(l);
-
-          next(l); /* NOTE: next(l) could be changed to consume(l) and emit() added after the loop, if you wanna save preprocessor-directives. */
+        const char* directive = l->buffer;
+        skip_directive_line(l);
+        if (l->on_directive != 0)
+        {
+          l->on_directive(l, directive, (uint32_t)(l->buffer - directive));
         }
+        pp_conditional(l, directive);   /* may skip a disabled '#if' branch */
         continue;
       }
 
@@ -161,12 +518,28 @@ struct token lexer_next_token(struct lexer* l)
       case '\'':
       {
         next(l); /* skip <'> */
-        if (l->buffer[0] == '\\') /* handle escape-characters */
+        /* NOTE: malformed input (binary files, unterminated literals) must not walk past the end of the
+                 buffer or the line - multi-char constants and escapes such as '\x41' are kept whole. */
+        while (    (l->buffer[0] != 0)
+                && (l->buffer[0] != '\'')
+                && (l->buffer[0] != '\n'))
         {
+          if (    (l->buffer[0] == '\\') /* handle escape-characters */
+               && (l->buffer[1] != 0)
+               && (l->buffer[1] != '\n'))
+          {
+            consume(l);
+          }
           consume(l);
         }
-        consume(l);
-        next(l); /* skip <'> */
+        if (l->buffer[0] == '\'')
+        {
+          next(l); /* skip <'> */
+        }
+        if (l->token_length == 0)
+        {
+          continue; /* empty or unterminated at end of line: '' */
+        }
         emit(l, &t, TOK_CONST, CNST_CHAR);
         return t;
       }
@@ -191,7 +564,10 @@ struct token lexer_next_token(struct lexer* l)
           }
           consume(l);
         }
-        consume(l);   /* eat <"> */
+        if (l->buffer[0] == '"')
+        {
+          consume(l);   /* eat <"> - not the terminating null of an unterminated literal */
+        }
         emit(l, &t, TOK_CONST, CNST_STRING); /* NOTE: integrity check in emit() asserting we read at least one char */
         return t; 
       }
@@ -219,90 +595,79 @@ struct token lexer_next_token(struct lexer* l)
       /* Everything else: Numbers, Keywords and Identifiers. */
       default:
       {
-        /* Numbers */
-        if (    (l->buffer[0] >= '0')
-             && (l->buffer[0] <= '9'))
+        const char* p = l->buffer;
+
+        /* Numbers - C99 literals: 42, 052, 0x2A, 0X2a, 42UL, 1.5f, .5, 1e-5, 0x1.8p+3 */
+        if (    char_is(p[0], CC_DIGIT)
+             || (    (p[0] == '.')
+                  && char_is(p[1], CC_DIGIT)))
         {
-          /* Hexadecimal */
-          if (    (l->buffer[0] == '0')
-               && (l->buffer[1] == 'x'))
+          /* The whole pre-processing number is one token, suffixes included, as the compiler sees it.
+             Exponents are 'e' in decimal and 'p' in hexadecimal literals - both may carry a sign. */
+          int is_hex = (p[0] == '0') && ((p[1] | 0x20) == 'x');
+          int is_float = 0;
+          char exponent = is_hex ? 'p' : 'e';
+
+          p += is_hex ? 2 : 0;
+          for (;;)
           {
-            consume(l);
-            consume(l);
-            while (    (    (l->buffer[0] >= '0')
-                         && (l->buffer[0] <= '9'))
-                    || (    (l->buffer[0] >= 'a')
-                         && (l->buffer[0] <= 'f'))
-                    || (    (l->buffer[0] >= 'A')
-                         && (l->buffer[0] <= 'F')))
+            if (char_is(p[0], CC_IDENT))
             {
-              consume(l);
+              if ((p[0] | 0x20) == exponent)
+              {
+                is_float = 1;
+                p += ((p[1] == '+') || (p[1] == '-'));
+              }
+              p += 1;
             }
-            emit(l, &t, TOK_CONST, CNST_INT); /* NOTE: integrity check in emit() asserting we read at least one char */
-            return t;
-          }
-          else
-          {
-            /* Decimal, octal or float? */
-            int is_float = 0;
-            while (    (l->buffer[0] == '.')
-                    || (
-                           (l->buffer[0] >= '0')
-                        && (l->buffer[0] <= '9')))
+            else if (p[0] == '.')
             {
-              is_float |= (l->buffer[0] == '.');
-              consume(l);
+              is_float = 1;
+              p += 1;
             }
-            emit(l, &t, TOK_CONST, is_float ? CNST_FLOAT : CNST_INT); /* NOTE: integrity check in emit() asserting we read at least one char */
-            return t;
-          }
-        }
-
-        /* Keywords */
-        uint32_t i;
-        for (i = 0; i < idx_first_tok_keyword; ++i) /* only searching for operators */
-        {
-          if (    (l->lexemes[i].tokknd == TOK_OPERATOR)
-               && (strncmp(l->buffer, l->lexemes[i].symbol, l->lexemes[i].symlen) == 0))
-          {
-            uint32_t j;
-            for (j = 0; j < l->lexemes[i].symlen; ++j)
+            else
             {
-              consume(l);
+              break;
             }
-            break;
           }
-        }
-        /* Found a match? */
-        if (i != idx_first_tok_keyword)
-        {
-          emit(l, &t, l->lexemes[i].tokknd, l->lexemes[i].toktyp);
+          consume_run(l, (uint32_t)(p - l->buffer));
+          emit(l, &t, TOK_CONST, is_float ? CNST_FLOAT : CNST_INT); /* NOTE: integrity check in emit() asserting we read at least one char */
           return t;
         }
 
-        /* Id / Symbols */
-        if (    (l->buffer[0] == '_')       /* Identifiers are of form '[_a-zA-Z][_a-zA-Z0-9]*' */
-             || (    (l->buffer[0] >= 'a')  /* NOTE: first char cannot be a number. */
-                  && (l->buffer[0] <= 'z'))
-             || (    (l->buffer[0] >= 'A')
-                  && (l->buffer[0] <= 'Z')))
+        /* Id / Symbols - no operator starts with a letter, so identifiers skip the operator table */
+        if (char_is(p[0], CC_IDSTART))      /* Identifiers are of form '[_a-zA-Z][_a-zA-Z0-9]*' */
         {
           do
           {
-            consume(l);
+            p += 1;
           }
-          while (    (l->buffer[0] != 0)
-                  && (    (l->buffer[0] == '_')
-                       || (    (l->buffer[0] >= 'a')
-                            && (l->buffer[0] <= 'z'))
-                       || (    (l->buffer[0] >= '0')
-                            && (l->buffer[0] <= '9'))
-                       || (    (l->buffer[0] >= 'A')
-                            && (l->buffer[0] <= 'Z'))));
+          while (char_is(p[0], CC_IDENT));
+          consume_run(l, (uint32_t)(p - l->buffer));
           emit(l, &t, TOK_IDENTIFIER, CNST_STRING);
           return t;
         }
 
+        /* Operators - only those starting with this char, longest first */
+        if (char_is(p[0], CC_OPERATOR))
+        {
+          const uint8_t* cands = op_cands[(uint8_t)p[0]];
+          uint32_t i;
+          for (i = 0; i < op_ncands[(uint8_t)p[0]]; ++i)
+          {
+            const struct token* op = &l->lexemes[cands[i]];   /* operators are in every dialect's table */
+            if (    (op->symlen == 1)      /* first char already matches - e.g. ',' in constant tables */
+                 || (strncmp(p, op->symbol, op->symlen) == 0))
+            {
+              consume_run(l, op->symlen);
+              emit(l, &t, op->tokknd, op->toktyp);
+              t.kwid = cands[i];
+              t.symid = op->symid;
+              return t;
+            }
+          }
+        }
+
         /* Integrity check - abort if input-text is not matched at this point */
         if (l->continue_on_error == 0)
         {
@@ -319,116 +684,98 @@ struct token lexer_next_token(struct lexer* l)
   t.symlen = 5;
   t.tokknd = TOK_EOF;
   t.toktyp = 0;
+  t.kwid   = KWID_NONE;
+  t.symid  = SYMID_NONE;
 
   return t;
 }
 
 
 
-void lexer_setup_alphabet(struct lexer* l)
+/* Fill in the table of every dialect from lexeme_defs[] - once per process */
+static void alphabets_build(void)
 {
-  /* ====================================== */
-  /* Lexer Alphabet defined in table below: */
-  /* ====================================== */
-
-
-  /* Macro to define a token/lexeme to match along with its kind and type (int/enum) */
-  #define ADD_TOKEN(symbol, kind, type)     lexer_add_token(l, symbol, (sizeof(symbol) - 1), kind, type)
-
-
-  /* The 43 primitives / operators in C89: */
-  ADD_TOKEN(">>=",        TOK_OPERATOR,   OP_ASSIGN_LSH);
-  ADD_TOKEN("<<=",        TOK_OPERATOR,   OP_ASSIGN_RSH);
-  ADD_TOKEN(">>",         TOK_OPERATOR,   OP_LSH);
-  ADD_TOKEN("<<",         TOK_OPERATOR,   OP_RSH);
-  ADD_TOKEN("!=",         TOK_OPERATOR,   OP_NOT_EQUAL);
-  ADD_TOKEN("==",         TOK_OPERATOR,   OP_EQUAL);
-  ADD_TOKEN("+=",         TOK_OPERATOR,   OP_ASSIGN_PLUS);
-  ADD_TOKEN("-=",         TOK_OPERATOR,   OP_ASSIGN_MINUS);
-  ADD_TOKEN("*=",         TOK_OPERATOR,   OP_ASSIGN_MULTIPLY);
-  ADD_TOKEN("/=",         TOK_OPERATOR,   OP_ASSIGN_DIVIDE);
-  ADD_TOKEN("&=",         TOK_OPERATOR,   OP_ASSIGN_AND);
-  ADD_TOKEN("|=",         TOK_OPERATOR,   OP_ASSIGN_OR);
-  ADD_TOKEN("^=",         TOK_OPERATOR,   OP_ASSIGN_XOR);
-  ADD_TOKEN("++",         TOK_OPERATOR,   OP_INCREMENT);
-  ADD_TOKEN("--",         TOK_OPERATOR,   OP_DECREMENT);
-  ADD_TOKEN("&&",         TOK_OPERATOR,   OP_LOGICAL_AND);
-  ADD_TOKEN("||",         TOK_OPERATOR,   OP_LOGICAL_OR);
-  ADD_TOKEN("->",         TOK_OPERATOR,   OP_ARROW);
-  ADD_TOKEN(">=",         TOK_OPERATOR,   OP_LOGICAL_GTE);
-  ADD_TOKEN("<=",         TOK_OPERATOR,   OP_LOGICAL_LTE);
-  ADD_TOKEN("!",          TOK_OPERATOR,   OP_LOGICAL_NOT);
-  ADD_TOKEN("~",          TOK_OPERATOR,   OP_BITWISE_NOT);
-  ADD_TOKEN(";",          TOK_OPERATOR,   OP_SEMICOLON);
-  ADD_TOKEN(":",          TOK_OPERATOR,   OP_COLON);
-  ADD_TOKEN("?",          TOK_OPERATOR,   OP_QUESTIONMARK);
-  ADD_TOKEN(",",          TOK_OPERATOR,   OP_COMMA);
-  ADD_TOKEN(".",          TOK_OPERATOR,   OP_DOT);
-  ADD_TOKEN("+",          TOK_OPERATOR,   OP_PLUS);
-  ADD_TOKEN("-",          TOK_OPERATOR,   OP_MINUS);
-  ADD_TOKEN("*",          TOK_OPERATOR,   OP_MULTIPLY);
-  ADD_TOKEN("/",          TOK_OPERATOR,   OP_DIVIDE);
-  ADD_TOKEN(">",          TOK_OPERATOR,   OP_LOGICAL_GT);
-  ADD_TOKEN("<",          TOK_OPERATOR,   OP_LOGICAL_LT);
-  ADD_TOKEN("&",          TOK_OPERATOR,   OP_BITWISE_AND);
-  ADD_TOKEN("|",          TOK_OPERATOR,   OP_BITWISE_OR);
-  ADD_TOKEN("^",          TOK_OPERATOR,   OP_BITWISE_XOR);
-  ADD_TOKEN("%",          TOK_OPERATOR,   OP_MODULO);
-  ADD_TOKEN("=",          TOK_OPERATOR,   OP_ASSIGN);
-  ADD_TOKEN("(",          TOK_OPERATOR,   OP_LPAREN);
-  ADD_TOKEN(")",          TOK_OPERATOR,   OP_RPAREN);
-  ADD_TOKEN("{",          TOK_OPERATOR,   OP_LBRACE);
-  ADD_TOKEN("}",          TOK_OPERATOR,   OP_RBRACE);
-  ADD_TOKEN("[",          TOK_OPERATOR,   OP_LBRACKET);
-  ADD_TOKEN("]",          TOK_OPERATOR,   OP_RBRACKET);
-
-  /* Setup sentinel-index for first keyword-token.
-     This is used to stop greedy keyword-matching inside identifiers. */
-  idx_first_tok_keyword = OP_RBRACKET + 1;
-
-  /* Some C99 Keywords */
-  ADD_TOKEN("int8_t",     TOK_KEYWORD,    KW_INT);
-  ADD_TOKEN("int16_t",    TOK_KEYWORD,    KW_INT);
-  ADD_TOKEN("int32_t",    TOK_KEYWORD,    KW_INT);
-  ADD_TOKEN("int64_t",    TOK_KEYWORD,    KW_INT);
-  ADD_TOKEN("uint8_t",    TOK_KEYWORD,    KW_INT);
-  ADD_TOKEN("uint16_t",   TOK_KEYWORD,    KW_INT);
-  ADD_TOKEN("uint32_t",   TOK_KEYWORD,    KW_INT);
-  ADD_TOKEN("uint64_t",   TOK_KEYWORD,    KW_INT);
+  uint32_t std;
+  uint32_t i;
 
-  /* The 32 reserved keywords of C: */
-  ADD_TOKEN("auto",       TOK_KEYWORD,    KW_AUTO);
-  ADD_TOKEN("break",      TOK_KEYWORD,    KW_BREAK);
-  ADD_TOKEN("case",       TOK_KEYWORD,    KW_CASE);
-  ADD_TOKEN("char",       TOK_KEYWORD,    KW_CHAR);
-  ADD_TOKEN("const",      TOK_KEYWORD,    KW_CONST);
-  ADD_TOKEN("continue",   TOK_KEYWORD,    KW_CONTINUE);
-  ADD_TOKEN("default",    TOK_KEYWORD,    KW_DEFAULT);
-  ADD_TOKEN("do",         TOK_KEYWORD,    KW_DO);
-  ADD_TOKEN("double",     TOK_KEYWORD,    KW_DOUBLE);
-  ADD_TOKEN("else",       TOK_KEYWORD,    KW_ELSE);
-  ADD_TOKEN("enum",       TOK_KEYWORD,    KW_ENUM);
-  ADD_TOKEN("extern",     TOK_KEYWORD,    KW_EXTERN);
-  ADD_TOKEN("float",      TOK_KEYWORD,    KW_FLOAT);
-  ADD_TOKEN("for",        TOK_KEYWORD,    KW_FOR);
-  ADD_TOKEN("goto",       TOK_KEYWORD,    KW_GOTO);
-  ADD_TOKEN("if",         TOK_KEYWORD,    KW_IF);
-  ADD_TOKEN("int",        TOK_KEYWORD,    KW_INT);
-  ADD_TOKEN("long",       TOK_KEYWORD,    KW_LONG);
-  ADD_TOKEN("register",   TOK_KEYWORD,    KW_REGISTER);
-  ADD_TOKEN("return",     TOK_KEYWORD,    KW_RETURN);
-  ADD_TOKEN("short",      TOK_KEYWORD,    KW_SHORT);
-  ADD_TOKEN("signed",     TOK_KEYWORD,    KW_SIGNED);
-  ADD_TOKEN("sizeof",     TOK_KEYWORD,    KW_SIZEOF);
-  ADD_TOKEN("static",     TOK_KEYWORD,    KW_STATIC);
-  ADD_TOKEN("struct",     TOK_KEYWORD,    KW_STRUCT);
-  ADD_TOKEN("switch",     TOK_KEYWORD,    KW_SWITCH);
-  ADD_TOKEN("typedef",    TOK_KEYWORD,    KW_TYPEDEF);
-  ADD_TOKEN("union",      TOK_KEYWORD,    KW_UNION);
-  ADD_TOKEN("unsigned",   TOK_KEYWORD,    KW_UNSIGNED);
-  ADD_TOKEN("void",       TOK_KEYWORD,    KW_VOID);
-  ADD_TOKEN("volatile",   TOK_KEYWORD,    KW_VOLATILE);
-  ADD_TOKEN("while",      TOK_KEYWORD,    KW_WHILE);
+  for (std = 0; std < LEXER_NSTDS; ++std)
+  {
+    struct alphabet* a = &alphabets[std];
+    for (i = 0; i < NLEXEME_DEFS; ++i)
+    {
+      const struct lexeme_def* d = &lexeme_defs[i];
+      if (d->stds & (1u << std))
+      {
+        struct token* t = &a->lexemes[a->nlexemes];
+        t->symbol  = (char*)d->symbol;   /* read-only: checkers never write to symbols */
+        t->symlen  = d->symlen;
+        t->tokknd  = d->tokknd;
+        t->toktyp  = d->toktyp;
+        t->lineno  = 0;
+        t->byteno  = 0;
+        t->foffset = 0;
+        t->kwid    = a->nlexemes;
+        t->symid   = intern(d->symbol, d->symlen);
+        a->nlexemes += 1;
+        if (t->tokknd == TOK_KEYWORD)
+        {
+          kwhash_put(a->kwhash, ALPHABET_HASH, t);
+        }
+      }
+    }
+    assert((2 * a->nlexemes) <= ALPHABET_HASH);
+  }
+
+  for (i = 0; i < NLEXEME_DEFS; ++i)
+  {
+    if (lexeme_defs[i].tokknd == TOK_OPERATOR)
+    {
+      uint8_t c = (uint8_t)lexeme_defs[i].symbol[0];
+      assert((lexeme_defs[i].toktyp == i) && (op_ncands[c] < MAXOPCANDS));
+      op_cands[c][op_ncands[c]++] = (uint8_t)i;
+    }
+  }
+}
+
+
+/* Use the operators + keywords of dialect 'std' (LEXER_STD_*) - a shared table, nothing is copied */
+void lexer_setup_alphabet(struct lexer* l, int std)
+{
+  const struct alphabet* a;
+
+  expect(l, (std >= 0) && (std < LEXER_NSTDS));
+  pthread_once(&alphabets_once, alphabets_build);
+
+  a = &alphabets[std];
+  free(l->types_kwhash);
+  l->types_kwhash = 0;
+  l->lexemes = a->lexemes;
+  l->nlexemes = a->nlexemes;
+  l->kwhash = a->kwhash;
+  l->kwhash_size = ALPHABET_HASH;
+  expect(l, l->ntypes == 0);
+}
+
+/* Dialect of a '--std=' name as given to GCC/Clang, or -1 */
+int lexer_std_by_name(const char* name)
+{
+  static const struct { const char* name; int std; } names[] =
+  {
+    { "c89",   LEXER_STD_C89 }, { "c90",   LEXER_STD_C89 }, { "ansi",  LEXER_STD_C89 },
+    { "c99",   LEXER_STD_C99 },
+    { "c11",   LEXER_STD_C11 }, { "c17",   LEXER_STD_C11 }, { "c18",   LEXER_STD_C11 },
+    { "gnu",   LEXER_STD_GNU }, { "gnu89", LEXER_STD_GNU }, { "gnu99", LEXER_STD_GNU },
+    { "gnu11", LEXER_STD_GNU }, { "gnu17", LEXER_STD_GNU },
+  };
+  uint32_t i;
+  for (i = 0; i < sizeof(names) / sizeof(names[0]); ++i)
+  {
+    if (strcmp(name, names[i].name) == 0)
+    {
+      return names[i].std;
+    }
+  }
+  return -1;
 }
 
 
@@ -447,7 +794,8 @@ static void _expect(struct lexer* l, int p, int line)
 }
 
 
-static void print_token(struct lexer* l, struct token* t)
+/* print a token in human-readable form - used for dumping token streams */
+void lexer_print_token(struct lexer* l, const struct token* t)
 {
   expect(l, t != 0);
 
@@ -461,7 +809,7 @@ static void print_token(struct lexer* l, struct token* t)
   };
 
   //printf("'%s' @ %u:%u [%d/%d] \n", t->symbol, t->lineno, t->byteno, t->tokknd, t->toktyp);
-  fprintf(stdout, "%-15s : '%s' @ %u:%u \n", tok_knds[t->tokknd], t->symbol, t->lineno, t->byteno);
+  fprintf(stdout, "%-15s : '%s' @ %u:%u [type %u, offset %u, length %u]\n", tok_knds[t->tokknd], t->symbol, t->lineno, t->byteno, t->toktyp, t->foffset, t->symlen);
 }
 
 
@@ -470,27 +818,30 @@ static void emit(struct lexer* l, struct token* next_tok, int token_kind, int to
 {
   expect(l, l->token_length > 0);
   l->token_buffer[l->token_length] = 0;
-  next_tok->symbol  = str_copy(l->token_buffer);
+  next_tok->symbol  = str_copy_len(l->token_buffer, l->token_length);
   next_tok->symlen  = l->token_length;
   next_tok->tokknd  = token_kind;
   next_tok->toktyp  = token_type;
   next_tok->lineno  = l->cur_lineno;
   next_tok->byteno  = l->cur_byteno;
-  next_tok->foffset = (l->buffer - l->buffer_original);
+  next_tok->foffset = (l->token_start - l->buffer_original);
+  next_tok->kwid    = KWID_NONE;
+  next_tok->symid   = SYMID_NONE;
 
   if (next_tok->tokknd == TOK_IDENTIFIER) /* Did we match a keyword? */
   {
-    uint32_t i;
-    for (i = idx_first_tok_keyword; i < l->nkeywords; ++i)
+    uint32_t i = lexer_find_keyword(l, l->token_buffer, l->token_length);
+    if (i != KWID_NONE)
     {
-      if (    (l->lexemes[i].tokknd == TOK_KEYWORD)
-           && (l->lexemes[i].symlen == l->token_length)
-           && (strncmp(l->token_buffer, l->lexemes[i].symbol, l->token_length) == 0))
-      {
-        next_tok->tokknd = l->lexemes[i].tokknd;
-        next_tok->toktyp = l->lexemes[i].toktyp;
-        break;
-      }
+      const struct token* kw = lexer_lexeme(l, i);
+      next_tok->tokknd = kw->tokknd;
+      next_tok->toktyp = kw->toktyp;
+      next_tok->kwid   = i;
+      next_tok->symid  = kw->symid;
+    }
+    else
+    {
+      next_tok->symid  = intern(l->token_buffer, l->token_length);
     }
   }
 
@@ -512,15 +863,57 @@ static void next(struct lexer* l)
 }
 
 
-/* add the current character to l->token_buffer and advance to next char in input stream. */
+/* add the current character to l->token_buffer and advance to next char in input stream.
+   Tokens longer than MAXTOKENLEN (e.g. in generated or minified input) are truncated. */
 static void consume(struct lexer* l)
 {
-  l->token_buffer[l->token_length++] = l->buffer[0];
-  expect(l, l->token_length < sizeof(l->token_buffer));
+  if (l->token_length == 0)
+  {
+    l->token_start = l->buffer;
+  }
+  if ((l->token_length + 1) < sizeof(l->token_buffer))
+  {
+    l->token_buffer[l->token_length++] = l->buffer[0];
+  }
   next(l);
 }
 
 
+/* add a run of 'len' characters without line breaks to l->token_buffer - e.g. an identifier - in one go */
+static void consume_run(struct lexer* l, uint32_t len)
+{
+  uint32_t room = (uint32_t)sizeof(l->token_buffer) - 1 - l->token_length;
+
+  if (l->token_length == 0)
+  {
+    l->token_start = l->buffer;
+  }
+  memcpy(&l->token_buffer[l->token_length], l->buffer, (len < room) ? len : room);
+  l->token_length += (len < room) ? len : room;
+  l->buffer += len;
+  l->cur_byteno += len;
+}
+
+
+/* skip a run of whitespace, counting lines */
+static void skip_space(struct lexer* l)
+{
+  const char* p = l->buffer;
+
+  while (char_is(p[0], CC_SPACE))
+  {
+    if (p[0] == '\n')
+    {
+      l->cur_lineno += 1;
+      l->cur_byteno = 0;
+    }
+    l->cur_byteno += 1;
+    p += 1;
+  }
+  l->buffer = (char*)p;
+}
+
+
 static void skip_comments(struct lexer* l)
 {
   /* Handle comments: */
@@ -535,8 +928,11 @@ static void skip_comments(struct lexer* l)
     {
       next(l); /* body of comment: ignore it */
     }
-    next(l);   /* skip <*> */
-    next(l);   /* skip </> */
+    if (l->buffer[0] != 0)                /* unterminated comment: stop at the end of the buffer */
+    {
+      next(l); /* skip <*> */
+      next(l); /* skip </> */
+    }
   }
   else if (    (l->buffer[0] == '/')      /* C++ style comment: // .... */
             && (l->buffer[1] == '/'))
@@ -550,4 +946,250 @@ static void skip_comments(struct lexer* l)
 }
 
 
+/* skip the rest of a pre-processor line, up to its line break - continued lines included */
+static void skip_directive_line(struct lexer* l)
+{
+  while (    (l->buffer[0] != 0)  /* a continuation at the very end must not run past the buffer */
+          && (    (    (l->buffer[0] != '\n')
+                    && (l->buffer[0] != EOF))
+               || (l->buffer[-1] == '\\')))
+  {
+    next(l); /* NOTE: next(l) could be changed to consume(l) and emit() added after the loop, if you wanna save preprocessor-directives. */
+  }
+}
+
+
+
+/* ================================================== */
+/* Conditional compilation:                           */
+/* ================================================== */
+
+/*
+  Each open '#if' block has a frame on l->pp_cond[]:
+    PP_UNKNOWN  no branch is known to be taken so far - the current branch is lexed
+    PP_TAKEN    the current branch is known to be taken - all later ones are skipped
+
+  A branch whose condition is known to be false is skipped without being lexed: the next
+  '#' at the start of a line is found with strchr(), so the bytes in between are never
+  looked at one by one. Note that a '#' starting a line inside a comment of a skipped
+  branch is taken as a directive too.
+*/
+
+enum { PP_UNKNOWN, PP_TAKEN };
+enum { PPD_OTHER, PPD_IF, PPD_IFDEF, PPD_IFNDEF, PPD_ELIF, PPD_ELSE, PPD_ENDIF, PPD_EOF };
+
+
+/* kind of the directive at 'directive' ('#'), and where its argument starts */
+static int pp_directive_kind(const char* directive, const char** arg)
+{
+  const char* p = directive + 1;
+  const char* word;
+  uint32_t len;
+
+  while ((*p == ' ') || (*p == '\t'))
+  {
+    p += 1;
+  }
+  for (word = p; char_is(*p, CC_IDENT); ++p)
+  {
+  }
+  len = (uint32_t)(p - word);
+  *arg = p;
+
+  if ((len == 2) && (memcmp(word, "if", 2) == 0))     { return PPD_IF; }
+  if ((len == 5) && (memcmp(word, "ifdef", 5) == 0))  { return PPD_IFDEF; }
+  if ((len == 6) && (memcmp(word, "ifndef", 6) == 0)) { return PPD_IFNDEF; }
+  if ((len == 4) && (memcmp(word, "elif", 4) == 0))   { return PPD_ELIF; }
+  if ((len == 4) && (memcmp(word, "else", 4) == 0))   { return PPD_ELSE; }
+  if ((len == 5) && (memcmp(word, "endif", 5) == 0))  { return PPD_ENDIF; }
+  return PPD_OTHER;
+}
+
+
+/* PPCOND_TRUE, PPCOND_FALSE or PPCOND_UNKNOWN for the condition in [arg, end) */
+static int pp_condition(int kind, const char* arg, const char* end)
+{
+  const char* name;
+  int defined;
+
+  if (    (kind == PPD_IF)
+       || (kind == PPD_ELIF))
+  {
+    return ppcond_eval(arg, (uint32_t)(end - arg));
+  }
+
+  while ((arg < end) && ((*arg == ' ') || (*arg == '\t')))
+  {
+    arg += 1;
+  }
+  for (name = arg; (arg < end) && char_is(*arg, CC_IDENT); ++arg)
+  {
+  }
+  defined = ppcond_eval_defined(name, (uint32_t)(arg - name));
+  if (    (kind == PPD_IFNDEF)
+       && (defined != PPCOND_UNKNOWN))
+  {
+    defined = (defined == PPCOND_TRUE) ? PPCOND_FALSE : PPCOND_TRUE;
+  }
+  return defined;
+}
+
+
+/* Skip to the '#elif' / '#else' / '#endif' ending a disabled branch - or to the '#endif' only.
+   Nested blocks are skipped whole. Returns the directive found, with l->buffer at its '#'. */
+static int skip_disabled(struct lexer* l, int to_endif)
+{
+  const char* start = l->buffer;
+  const char* p = start;
+  const char* nl;
+  const char* last_nl = 0;
+  const char* arg;
+  uint32_t nested = 0;
+  int kind = PPD_EOF;
+
+  for (;;)
+  {
+    const char* hash = strchr(p, '#');
+    const char* q = hash;
+    if (hash == 0)
+    {
+      p += strlen(p);
+      break;
+    }
+    p = hash + 1;
+
+    while ((q > l->buffer_original) && ((q[-1] == ' ') || (q[-1] == '\t')))
+    {
+      q -= 1;
+    }
+    if (    (q > l->buffer_original)
+         && (q[-1] != '\n'))
+    {
+      continue;   /* not the first non-blank of its line */
+    }
+
+    kind = pp_directive_kind(hash, &arg);
+    if (    (kind == PPD_IF)
+         || (kind == PPD_IFDEF)
+         || (kind == PPD_IFNDEF))
+    {
+      nested += 1;
+    }
+    else if (    (kind == PPD_ENDIF)
+              && (nested > 0))
+    {
+      nested -= 1;
+    }
+    else if (    (kind == PPD_ENDIF)
+              || (    !to_endif
+                   && (nested == 0)
+                   && (    (kind == PPD_ELIF)
+                        || (kind == PPD_ELSE))))
+    {
+      p = hash;
+      break;
+    }
+    kind = PPD_EOF;
+  }
+
+  /* keep line and byte numbers right */
+  for (nl = memchr(start, '\n', (size_t)(p - start)); nl != 0; nl = memchr(nl + 1, '\n', (size_t)(p - nl - 1)))
+  {
+    l->cur_lineno += 1;
+    last_nl = nl;
+  }
+  l->cur_byteno = (last_nl != 0) ? (uint32_t)(p - last_nl) : (l->cur_byteno + (uint32_t)(p - start));
+  l->buffer = (char*)p;
+  return kind;
+}
+
+
+/* Enter the branch of the innermost block, skipping it - and the following ones - while they are known to be disabled */
+static void pp_branch(struct lexer* l, int cond)
+{
+  while (cond == PPCOND_FALSE)
+  {
+    const char* directive;
+    const char* arg;
+    int kind;
+
+    if (skip_disabled(l, 0) == PPD_EOF)
+    {
+      l->pp_depth -= 1;
+      return;
+    }
+    directive = l->buffer;
+    skip_directive_line(l);
+    kind = pp_directive_kind(directive, &arg);
+    if (kind == PPD_ENDIF)
+    {
+      l->pp_depth -= 1;
+      return;
+    }
+    if (kind == PPD_ELSE)
+    {
+      return;   /* taken, unless an earlier branch was */
+    }
+    cond = pp_condition(kind, arg, l->buffer);
+  }
+  if (cond == PPCOND_TRUE)
+  {
+    l->pp_cond[l->pp_depth - 1] = PP_TAKEN;
+  }
+}
+
+
+/* Track '#if' blocks, and skip the branches known not to be compiled */
+static void pp_conditional(struct lexer* l, const char* directive)
+{
+  const char* arg;
+  int kind = pp_directive_kind(directive, &arg);
+
+  switch (kind)
+  {
+    case PPD_IF:
+    case PPD_IFDEF:
+    case PPD_IFNDEF:
+    {
+      if (l->pp_depth < MAXPPDEPTH)
+      {
+        l->pp_cond[l->pp_depth++] = PP_UNKNOWN;
+        pp_branch(l, pp_condition(kind, arg, l->buffer));
+      }
+      else
+      {
+        l->pp_depth += 1;   /* too deep: not tracked, always lexed */
+      }
+    } break;
+
+    case PPD_ELIF:
+    case PPD_ELSE:
+    {
+      if (    (l->pp_depth == 0)
+           || (l->pp_depth > MAXPPDEPTH))
+      {
+        break;
+      }
+      if (l->pp_cond[l->pp_depth - 1] == PP_TAKEN)
+      {
+        skip_disabled(l, 1);
+        skip_directive_line(l);   /* the '#endif' */
+        l->pp_depth -= 1;
+      }
+      else if (kind == PPD_ELIF)
+      {
+        pp_branch(l, pp_condition(kind, arg, l->buffer));
+      }
+    } break;
+
+    case PPD_ENDIF:
+    {
+      l->pp_depth -= (l->pp_depth > 0);
+    } break;
+
+    default:
+    {
+    } break;
+  }
+}
 
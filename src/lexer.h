@@ -9,13 +9,14 @@
       - string literals
       - char literals
       - integer numerals
-      - ANSI C89 keywords
+      - '#if' blocks that are known to be disabled are skipped
       - ANSI C89 operators
+      - keywords of the selected dialect: C89, C99, C11 or GNU C
 
 
     Work-flow:
     ----------
-      - define list of reserved keywords + operators
+      - pick the keyword + operator table of a dialect - built-in, shared by all lexers
       - read a file
       - try treating input as (in prioritized sequence):
           comment
@@ -47,24 +48,45 @@
 #include <stdint.h>
 
 
-#define MAXNTOKENS     1024 /* max number of keywords/lexemes to support - set high enough to accomodate typedef'd types etc. */
+#define MAXNTOKENS      256 /* initial size of a lexer's table of typedef'd type names - grows as types are registered. */
 #define MAXTOKENLEN   65536 /* max supported token_length - this is the maximum supported token (and string) length. */
+#define MAXPPDEPTH       64 /* max tracked nesting of '#if' blocks - deeper blocks are always lexed. */
 
 
 
+/* C dialects - each has its own keyword table, see lexer_setup_alphabet() */
+enum
+{
+  LEXER_STD_C89,
+  LEXER_STD_C99,                      /* + inline, restrict, _Bool, _Complex, _Imaginary */
+  LEXER_STD_C11,                      /* + _Alignas, _Alignof, _Atomic, _Generic, _Noreturn, _Static_assert, _Thread_local */
+  LEXER_STD_GNU,                      /* + asm, typeof - the __x__ spellings (__asm__, __attribute__, ...) are keywords in every dialect */
+  LEXER_NSTDS
+};
+
 
 /* Lexer context object */
 struct lexer 
 {
-  struct token lexemes[MAXNTOKENS];   /* Set of valid C tokens: operators + keywords (excluding trigraphs). */
-  uint32_t nkeywords;                 /* Number of keywords in lexemes[]. */
+  const struct token* lexemes;        /* Valid C tokens of the dialect: operators + keywords - a shared, read-only table. */
+  uint32_t nlexemes;                  /* Number of entries in lexemes[]. */
+  struct token* types;                /* Type names registered at run-time - keyword ids nlexemes and up. */
+  uint32_t ntypes;                    /* Number of type names in types[]. */
+  uint32_t maxtypes;                  /* Allocated size of types[]. */
+  const uint32_t* kwhash;             /* Keyword lookup: indices (+1, 0 is empty) - the dialect's table, or types_kwhash. */
+  uint32_t* types_kwhash;             /* Own copy of the lookup table, made when the first type name is registered. */
+  uint32_t kwhash_size;               /* Number of slots in kwhash[] - power of 2. */
   char*    buffer;                    /* Pointer to char buffer where tokens are read from (src file). */
   char*    buffer_original;           /* Pointer to start of buffer - 'buffer' points to next lex-point. */
   char     token_buffer[MAXTOKENLEN]; /* Buffer to accumulate chars to build current token from. */
   uint32_t token_length;              /* Length of current token. */
+  char*    token_start;               /* Position in buffer of the first char of current token. */
   uint32_t cur_lineno;                /* Line number in current input source code file. */
   uint32_t cur_byteno;                /* Byte/column number in current line. */
   int      continue_on_error;      
+  void   (*on_directive)(struct lexer* l, const char* directive, uint32_t len); /* Optional hook, called for each pre-processor line. */
+  uint8_t  pp_cond[MAXPPDEPTH];       /* State of each open '#if' block: branch taken, or not known. */
+  uint32_t pp_depth;                  /* Number of open '#if' blocks. */
 };
 
 
@@ -72,11 +94,20 @@ struct lexer
 void lexer_init(struct lexer* l);
 void lexer_free(struct lexer* l);
 void lexer_reset_state(struct lexer* l);
-void lexer_setup_alphabet(struct lexer* l);
+void lexer_setup_alphabet(struct lexer* l, int std);
+int  lexer_std_by_name(const char* name);
 void lexer_set_char_buf(struct lexer* l, char* char_buf);
-void lexer_add_token(struct lexer* l, char* token_symbol, int token_strlen, int token_kind, int token_type);
+uint32_t lexer_add_type(struct lexer* l, const char* type_name, uint32_t type_len);
+uint32_t lexer_find_keyword(const struct lexer* l, const char* symbol, uint32_t symlen);
+
+/* The operator or keyword with id 'kwid' - an entry of the dialect's table or a registered type name. */
+static inline const struct token* lexer_lexeme(const struct lexer* l, uint32_t kwid)
+{
+  return (kwid < l->nlexemes) ? &l->lexemes[kwid] : &l->types[kwid - l->nlexemes];
+}
 
 struct token lexer_next_token(struct lexer* l);
+void lexer_print_token(struct lexer* l, const struct token* t);
 
 #endif /* __LEXER_H__ */
 
@@ -0,0 +1,632 @@
+/*
+
+Batched file loading
+
+  - slots[]:  one per file of the current batch - the file, its buffer and the result of
+              each step. Buffers grow to the largest file seen and are kept.
+  - io_uring: one ring with an entry per slot. Each step - open, read, close - queues one
+              request per slot still in the game, submits them all and waits for all of
+              their completions in a single io_uring_enter().
+  - pool:     LOADER_THREADS threads wait for a batch, take slots off a shared counter
+              and load them; the last one done wakes up the caller.
+
+  The ring or the pool is set up on first use, so forked workers each get their own.
+
+*/
+
+#define _GNU_SOURCE   /* O_CLOEXEC, syscall */
+#include "loader.h"
+#include "source.h"
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>       /* open, AT_FDCWD */
+#include <pthread.h>
+#include <stdlib.h>      /* realloc, free */
+#include <string.h>      /* memset */
+#include <sys/mman.h>    /* mmap */
+#include <sys/syscall.h> /* __NR_io_uring_* */
+#include <unistd.h>      /* read, close, syscall */
+
+#if defined(__linux__) && defined(__NR_io_uring_setup)
+  #include <linux/io_uring.h>
+  #define HAVE_IO_URING 1
+#else
+  #define HAVE_IO_URING 0
+#endif
+
+
+#define LOADER_THREADS   4
+
+
+struct slot
+{
+  struct loaded_file lf;
+  uint32_t cap;        /* size of the buffer, padding included */
+  int      fd;         /* -1 when not open */
+  int      res;        /* result of the last request */
+};
+
+
+static uint32_t     batch_size = 0;
+static struct slot* slots = 0;
+static uint32_t     nslots = 0;     /* slots filled in the current batch */
+static uint32_t     next_slot = 0;  /* next slot to hand out */
+static int          started = 0;
+static int          use_uring = 0;
+
+
+
+/* make room for the contents of the file in a slot, and get ready to load it */
+static void slot_prepare(struct slot* sl, const struct sched_file* f)
+{
+  uint32_t size = (f->size <= SRC_MAX_FILE_SIZE) ? (uint32_t)f->size : 0;
+
+  if ((size + SRC_CONTENT_PADDING) > sl->cap)
+  {
+    sl->cap = size + SRC_CONTENT_PADDING;
+    sl->lf.content = realloc(sl->lf.content, sl->cap);
+    assert(sl->lf.content != 0);
+  }
+  sl->lf.file = f;
+  sl->lf.size = size;
+  sl->fd = -1;
+  sl->res = 0;
+}
+
+/* the contents are in: zero the padding - or mark the file as not readable */
+static void slot_finish(struct slot* sl, int64_t nread)
+{
+  if (nread <= 0)
+  {
+    sl->lf.size = 0;
+    return;
+  }
+  sl->lf.size = (uint32_t)nread;   /* never more than planned, should the file have grown */
+  memset(sl->lf.content + nread, 0, SRC_CONTENT_PADDING);
+}
+
+/* the rest of a file after a short read */
+static int64_t read_rest(int fd, char* buf, int64_t have, uint32_t size)
+{
+  while (have < size)
+  {
+    ssize_t n = pread(fd, buf + have, size - (size_t)have, (off_t)have);
+    if (n <= 0)
+    {
+      break;
+    }
+    have += n;
+  }
+  return have;
+}
+
+/* load one file the plain way */
+static void slot_load(struct slot* sl)
+{
+  int64_t nread = 0;
+  if (sl->lf.size > 0)
+  {
+    int fd = open(sl->lf.file->path, O_RDONLY | O_CLOEXEC);
+    if (fd >= 0)
+    {
+      nread = read_rest(fd, sl->lf.content, 0, sl->lf.size);
+      close(fd);
+    }
+  }
+  slot_finish(sl, nread);
+}
+
+
+
+/* ================================================== */
+/* io_uring:                                          */
+/* ================================================== */
+
+#if HAVE_IO_URING
+
+static struct
+{
+  int       fd;
+  uint32_t  entries;
+  uint32_t* sq_head;
+  uint32_t* sq_tail;
+  uint32_t* sq_mask;
+  uint32_t* sq_array;
+  uint32_t* cq_head;
+  uint32_t* cq_tail;
+  uint32_t* cq_mask;
+  struct io_uring_sqe* sqes;
+  struct io_uring_cqe* cqes;
+  void*     sq_ptr;
+  size_t    sq_len;
+  void*     cq_ptr;
+  size_t    cq_len;
+  size_t    sqes_len;
+} ring = { -1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+
+
+static int uring_setup(uint32_t entries, struct io_uring_params* p)
+{
+  return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int uring_enter(uint32_t to_submit, uint32_t min_complete, uint32_t flags)
+{
+  return (int)syscall(__NR_io_uring_enter, ring.fd, to_submit, min_complete, flags, 0, 0);
+}
+
+static void uring_close(void)
+{
+  if (ring.sqes != 0)
+  {
+    munmap(ring.sqes, ring.sqes_len);
+  }
+  if (    (ring.cq_ptr != 0)
+       && (ring.cq_ptr != ring.sq_ptr))
+  {
+    munmap(ring.cq_ptr, ring.cq_len);
+  }
+  if (ring.sq_ptr != 0)
+  {
+    munmap(ring.sq_ptr, ring.sq_len);
+  }
+  if (ring.fd >= 0)
+  {
+    close(ring.fd);
+  }
+  memset(&ring, 0, sizeof(ring));
+  ring.fd = -1;
+}
+
+/* are open, read and close supported? - they came with Linux 5.6, as did the probe */
+static int uring_probe(void)
+{
+  struct io_uring_probe* probe = calloc(1, sizeof(*probe) + 256 * sizeof(struct io_uring_probe_op));
+  int supported = 0;
+
+  assert(probe != 0);
+  if (syscall(__NR_io_uring_register, ring.fd, IORING_REGISTER_PROBE, probe, 256) == 0)
+  {
+    supported =    (probe->last_op >= IORING_OP_CLOSE)
+                && (probe->last_op >= IORING_OP_READ)
+                && (probe->ops[IORING_OP_OPENAT].flags & IO_URING_OP_SUPPORTED)
+                && (probe->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED)
+                && (probe->ops[IORING_OP_CLOSE].flags & IO_URING_OP_SUPPORTED);
+  }
+  free(probe);
+  return supported;
+}
+
+static int uring_open(uint32_t entries)
+{
+  struct io_uring_params p;
+  memset(&p, 0, sizeof(p));
+
+  ring.fd = uring_setup(entries, &p);
+  if (ring.fd < 0)
+  {
+    ring.fd = -1;
+    return 0;   /* ENOSYS, EPERM, ... */
+  }
+  ring.entries = p.sq_entries;
+
+  ring.sq_len = p.sq_off.array + (p.sq_entries * sizeof(uint32_t));
+  ring.cq_len = p.cq_off.cqes + (p.cq_entries * sizeof(struct io_uring_cqe));
+  if (p.features & IORING_FEAT_SINGLE_MMAP)
+  {
+    ring.sq_len = (ring.cq_len > ring.sq_len) ? ring.cq_len : ring.sq_len;
+  }
+  ring.sq_ptr = mmap(0, ring.sq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring.fd, IORING_OFF_SQ_RING);
+  if (ring.sq_ptr == MAP_FAILED)
+  {
+    ring.sq_ptr = 0;
+    uring_close();
+    return 0;
+  }
+  ring.cq_ptr = ring.sq_ptr;
+  if (!(p.features & IORING_FEAT_SINGLE_MMAP))
+  {
+    ring.cq_ptr = mmap(0, ring.cq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring.fd, IORING_OFF_CQ_RING);
+    if (ring.cq_ptr == MAP_FAILED)
+    {
+      ring.cq_ptr = 0;
+      uring_close();
+      return 0;
+    }
+  }
+  ring.sqes_len = p.sq_entries * sizeof(struct io_uring_sqe);
+  ring.sqes = mmap(0, ring.sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring.fd, IORING_OFF_SQES);
+  if (ring.sqes == MAP_FAILED)
+  {
+    ring.sqes = 0;
+    uring_close();
+    return 0;
+  }
+
+  ring.sq_head  = (uint32_t*)((char*)ring.sq_ptr + p.sq_off.head);
+  ring.sq_tail  = (uint32_t*)((char*)ring.sq_ptr + p.sq_off.tail);
+  ring.sq_mask  = (uint32_t*)((char*)ring.sq_ptr + p.sq_off.ring_mask);
+  ring.sq_array = (uint32_t*)((char*)ring.sq_ptr + p.sq_off.array);
+  ring.cq_head  = (uint32_t*)((char*)ring.cq_ptr + p.cq_off.head);
+  ring.cq_tail  = (uint32_t*)((char*)ring.cq_ptr + p.cq_off.tail);
+  ring.cq_mask  = (uint32_t*)((char*)ring.cq_ptr + p.cq_off.ring_mask);
+  ring.cqes     = (struct io_uring_cqe*)((char*)ring.cq_ptr + p.cq_off.cqes);
+
+  if (!uring_probe())
+  {
+    uring_close();
+    return 0;
+  }
+  return 1;
+}
+
+
+/* queue a request for a slot - the caller fills in the operation */
+static struct io_uring_sqe* uring_queue(uint32_t slot_idx)
+{
+  uint32_t tail = *ring.sq_tail;
+  uint32_t idx = tail & *ring.sq_mask;
+  struct io_uring_sqe* sqe = &ring.sqes[idx];
+
+  memset(sqe, 0, sizeof(*sqe));
+  sqe->user_data = slot_idx;
+  ring.sq_array[idx] = idx;
+  __atomic_store_n(ring.sq_tail, tail + 1, __ATOMIC_RELEASE);
+  return sqe;
+}
+
+/* submit 'n' queued requests and wait for all of them - the results go to slots[].res */
+static int uring_run(uint32_t n)
+{
+  uint32_t submitted = 0;
+  uint32_t completed = 0;
+
+  while (completed < n)
+  {
+    int r = uring_enter(n - submitted, n - completed, IORING_ENTER_GETEVENTS);
+    if (r < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      return 0;
+    }
+    submitted += (uint32_t)r;
+
+    uint32_t head = *ring.cq_head;
+    while (head != __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE))
+    {
+      const struct io_uring_cqe* cqe = &ring.cqes[head & *ring.cq_mask];
+      slots[cqe->user_data].res = cqe->res;
+      head += 1;
+      completed += 1;
+    }
+    __atomic_store_n(ring.cq_head, head, __ATOMIC_RELEASE);
+  }
+  return 1;
+}
+
+/* open, read and close the files of the batch - one system call each
+   returns 0 when the ring failed; '*loaded' tells whether the contents were in by then */
+static int uring_load_batch(int* loaded)
+{
+  uint32_t i;
+  uint32_t n;
+
+  *loaded = 0;
+
+  /* open */
+  for (i = 0, n = 0; i < nslots; ++i)
+  {
+    if (slots[i].lf.size > 0)
+    {
+      struct io_uring_sqe* sqe = uring_queue(i);
+      sqe->opcode = IORING_OP_OPENAT;
+      sqe->fd = AT_FDCWD;
+      sqe->addr = (uint64_t)(uintptr_t)slots[i].lf.file->path;
+      sqe->open_flags = O_RDONLY | O_CLOEXEC;
+      slots[i].res = -1;
+      n += 1;
+    }
+  }
+  int opened = uring_run(n);
+
+  /* keep the descriptors of completed opens at once - should the ring fail, the fallback closes them */
+  for (i = 0; i < nslots; ++i)
+  {
+    if (    (slots[i].lf.size > 0)
+         && (slots[i].res >= 0))
+    {
+      slots[i].fd = slots[i].res;
+    }
+  }
+  if (!opened)
+  {
+    return 0;
+  }
+
+  /* read */
+  for (i = 0, n = 0; i < nslots; ++i)
+  {
+    if (slots[i].fd >= 0)
+    {
+      struct io_uring_sqe* sqe = uring_queue(i);
+      sqe->opcode = IORING_OP_READ;
+      sqe->fd = slots[i].fd;
+      sqe->addr = (uint64_t)(uintptr_t)slots[i].lf.content;
+      sqe->len = slots[i].lf.size;
+      sqe->off = 0;
+      n += 1;
+    }
+    else
+    {
+      slots[i].res = -1;
+    }
+  }
+  if (!uring_run(n))
+  {
+    return 0;
+  }
+  for (i = 0; i < nslots; ++i)
+  {
+    int64_t nread = slots[i].res;
+    if (    (nread > 0)
+         && (nread < slots[i].lf.size))
+    {
+      nread = read_rest(slots[i].fd, slots[i].lf.content, nread, slots[i].lf.size);
+    }
+    slot_finish(&slots[i], nread);
+  }
+  *loaded = 1;
+
+  /* close - a descriptor is given up only once its close completed, should the ring fail */
+  for (i = 0, n = 0; i < nslots; ++i)
+  {
+    if (slots[i].fd >= 0)
+    {
+      struct io_uring_sqe* sqe = uring_queue(i);
+      sqe->opcode = IORING_OP_CLOSE;
+      sqe->fd = slots[i].fd;
+      slots[i].res = 1;   /* a close never completes with a positive result */
+      n += 1;
+    }
+  }
+  int closed = uring_run(n);
+  for (i = 0; i < nslots; ++i)
+  {
+    if (    (slots[i].fd >= 0)
+         && (slots[i].res <= 0))
+    {
+      slots[i].fd = -1;
+    }
+  }
+  return closed;
+}
+
+#endif /* HAVE_IO_URING */
+
+
+
+/* ================================================== */
+/* Thread pool:                                       */
+/* ================================================== */
+
+static pthread_t       pool[LOADER_THREADS];
+static uint32_t        npool = 0;
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  pool_work = PTHREAD_COND_INITIALIZER;   /* a new batch, or the end */
+static pthread_cond_t  pool_done = PTHREAD_COND_INITIALIZER;   /* all slots of the batch loaded */
+static uint32_t        pool_batch = 0;     /* number of the current batch */
+static uint32_t        pool_next = 0;      /* next slot to load */
+static uint32_t        pool_ndone = 0;     /* slots loaded */
+static int             pool_quit = 0;
+
+
+static void* pool_main(void* arg)
+{
+  uint32_t seen = 0;   /* last batch worked on */
+
+  (void) arg;
+
+  pthread_mutex_lock(&pool_lock);
+  for (;;)
+  {
+    while (    !pool_quit
+            && (pool_batch == seen))
+    {
+      pthread_cond_wait(&pool_work, &pool_lock);
+    }
+    if (pool_quit)
+    {
+      break;
+    }
+    seen = pool_batch;
+
+    while (pool_next < nslots)
+    {
+      struct slot* sl = &slots[pool_next++];
+      pthread_mutex_unlock(&pool_lock);
+      slot_load(sl);
+      pthread_mutex_lock(&pool_lock);
+      if (++pool_ndone == nslots)
+      {
+        pthread_cond_signal(&pool_done);
+      }
+    }
+  }
+  pthread_mutex_unlock(&pool_lock);
+  return 0;
+}
+
+static void pool_start(void)
+{
+  for (npool = 0; npool < LOADER_THREADS; ++npool)
+  {
+    if (pthread_create(&pool[npool], 0, pool_main, 0) != 0)
+    {
+      break;
+    }
+  }
+}
+
+static void pool_load_batch(void)
+{
+  uint32_t i;
+
+  if (npool == 0)
+  {
+    for (i = 0; i < nslots; ++i)
+    {
+      slot_load(&slots[i]);   /* no threads: load them here */
+    }
+    return;
+  }
+
+  pthread_mutex_lock(&pool_lock);
+  pool_next = 0;
+  pool_ndone = 0;
+  pool_batch += 1;
+  pthread_cond_broadcast(&pool_work);
+  while (pool_ndone < nslots)
+  {
+    pthread_cond_wait(&pool_done, &pool_lock);
+  }
+  pthread_mutex_unlock(&pool_lock);
+}
+
+static void pool_stop(void)
+{
+  uint32_t i;
+
+  pthread_mutex_lock(&pool_lock);
+  pool_quit = 1;
+  pthread_cond_broadcast(&pool_work);
+  pthread_mutex_unlock(&pool_lock);
+  for (i = 0; i < npool; ++i)
+  {
+    pthread_join(pool[i], 0);
+  }
+  npool = 0;
+  pool_quit = 0;
+}
+
+
+
+/* ================================================== */
+/* Batches:                                           */
+/* ================================================== */
+
+void loader_set_batch(uint32_t nfiles)
+{
+  batch_size = nfiles;
+}
+
+int loader_enabled(void)
+{
+  return (batch_size > 0);
+}
+
+
+static void loader_start(void)
+{
+  slots = calloc(batch_size, sizeof(*slots));
+  assert(slots != 0);
+#if HAVE_IO_URING
+  use_uring = uring_open(batch_size);
+  if (    use_uring
+       && (ring.entries < batch_size))
+  {
+    batch_size = ring.entries;   /* capped by the kernel */
+  }
+#endif
+  if (!use_uring)
+  {
+    pool_start();
+  }
+  started = 1;
+}
+
+
+/* next file to analyze, with its contents - 0 when all files are taken */
+const struct loaded_file* loader_next(void)
+{
+  if (!started)
+  {
+    loader_start();
+  }
+
+  if (next_slot == nslots)
+  {
+    const struct sched_file* f;
+
+    /* claim and load the next batch */
+    next_slot = 0;
+    nslots = 0;
+    while (    (nslots < batch_size)
+            && ((f = sched_claim()) != 0))
+    {
+      slot_prepare(&slots[nslots++], f);
+    }
+
+    int loaded = 0;   /* by the ring, before it failed */
+#if HAVE_IO_URING
+    if (    use_uring
+         && !uring_load_batch(&loaded))
+    {
+      /* the ring failed: close what it left open, and load with the thread pool from now on */
+      uint32_t i;
+      for (i = 0; i < nslots; ++i)
+      {
+        if (slots[i].fd >= 0)
+        {
+          close(slots[i].fd);
+          slots[i].fd = -1;
+        }
+        if (!loaded)
+        {
+          slot_prepare(&slots[i], slots[i].lf.file);
+        }
+      }
+      uring_close();
+      use_uring = 0;
+      pool_start();
+    }
+#endif
+    if (    !use_uring
+         && !loaded)
+    {
+      pool_load_batch();
+    }
+  }
+
+  return (next_slot < nslots) ? &slots[next_slot++].lf : 0;
+}
+
+
+void loader_free(void)
+{
+  uint32_t i;
+
+  if (started)
+  {
+#if HAVE_IO_URING
+    if (use_uring)
+    {
+      uring_close();
+    }
+#endif
+    pool_stop();
+  }
+  for (i = 0; (slots != 0) && (i < batch_size); ++i)
+  {
+    free(slots[i].lf.content);
+  }
+  free(slots);
+  slots = 0;
+  nslots = 0;
+  next_slot = 0;
+  started = 0;
+  use_uring = 0;
+}
+
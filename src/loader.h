@@ -0,0 +1,46 @@
+#ifndef __LOADER_H__
+#define __LOADER_H__
+
+/*
+
+Batched file loading
+
+  Instead of an fopen/fseek/ftell/fclose and an fopen/fread/fclose for every file, files
+  are claimed from the scheduler in batches and loaded together:
+
+    - io_uring: the opens, the reads and the closes of a whole batch are each submitted
+      with one system call - three calls per batch instead of several per file. The ring
+      is driven through the raw system calls, no library is needed.
+    - where io_uring is not available (older kernels, blocked by seccomp): a small pool
+      of threads loads the files of a batch in parallel with plain open/read/close.
+
+  Sizes come from the stat() the scheduler made when planning. Contents are read into
+  per-slot buffers that are reused from batch to batch, zero padded like the buffers of
+  source.c, and handed to the analysis without copying. A buffer is valid until the next
+  call of loader_next().
+
+*/
+
+#include "sched.h"
+#include <stdint.h>
+
+
+
+struct loaded_file
+{
+  const struct sched_file* file;
+  char*    content;   /* 'size' bytes, zero padded      */
+  uint32_t size;      /* 0 when empty or not readable  */
+};
+
+
+
+void loader_set_batch(uint32_t nfiles);
+int  loader_enabled(void);
+const struct loaded_file* loader_next(void);
+void loader_free(void);
+
+
+
+#endif /* __LOADER_H__ */
+
@@ -7,55 +7,748 @@ Static analysis at the lexical abstraction level
 
 #include <assert.h>              /* for assert            */
 #include <stdio.h>               /* for printf + fgetc    */
+#include <stdlib.h>              /* for getenv, strtoul   */
+#include <string.h>              /* for strcmp            */
+#include <unistd.h>              /* for mkstemp, sysconf  */
 #include "lexer.h"
 #include "analysis.h"
+#include "include.h"
+#include "typedefs.h"
+#include "check_misleading_var_name.h"
+#include "tokcache.h"
+#include "report.h"
+#include "hash.h"
+#include "sched.h"
+#include "source.h"
+#include "diff.h"
+#include "watch.h"
+#include "baseline.h"
+#include "check_project_decls.h"
+#include "intern.h"
+#include "symindex.h"
+#include "metrics.h"
+#include "clones.h"
+#include "ppcond.h"
+#include "readahead.h"
+#include "loader.h"
+#include "compdb.h"
 
 
+#define MAXJOBS            256
+#define PROJECT_FILE_IDX   UINT32_MAX   /* whole-project findings are merged after those of all files */
+
+
+static uint32_t shard_idx = 0;     /* --shard i/N: analyze only files whose path-hash modulo N is i */
+static uint32_t nshards   = 1;
+
+static struct lexer* lex = 0;
+static char*  worker_results[MAXJOBS]; /* per-worker result files, with --jobs */
+static int    use_worker_results = 0;
+static int    print_alloc_stats = 0;
+
+
+
+static void check_one_file(struct lexer* l, const char* file_path, const struct loaded_file* loaded)
+{
+  if (    (loaded != 0)
+       && (loaded->file->size <= SRC_MAX_FILE_SIZE))   /* larger files are noted as skipped below */
+  {
+    analysis_check_loaded(l, file_path, loaded->content, loaded->size);
+  }
+  else
+  {
+    analysis_check_file(l, file_path);
+  }
+}
+
+/* Analyze a file from the input list - and the headers it pulls in, when following includes.
+   'loaded' holds its contents when they were loaded in a batch, else 0. */
+static void check_listed_file(struct lexer* l, const char* file_path, const struct loaded_file* loaded)
+{
+  if (include_follow_enabled())
+  {
+    /* analyze every file once - listed files may have been reached through an #include already */
+    if (include_mark_seen(file_path) == 0)
+    {
+      return;
+    }
+    check_one_file(l, file_path, loaded);
+
+    const char* header;
+    while ((header = include_next_pending()) != 0)
+    {
+      analysis_check_file(l, header);
+    }
+  }
+  else
+  {
+    check_one_file(l, file_path, loaded);
+  }
+}
+
+
+/* next file to analyze, as handed out by the scheduler - with its contents when loading in batches */
+static const struct sched_file* next_file(const struct loaded_file** loaded)
+{
+  if (!loader_enabled())
+  {
+    *loaded = 0;
+    return sched_claim();
+  }
+  *loaded = loader_next();
+  return (*loaded != 0) ? (*loaded)->file : 0;
+}
+
+
+/* Worker loop: analyze files as handed out by the scheduler, timing each */
+static void check_files(uint32_t worker_idx)
+{
+  const struct sched_file* f;
+  const struct loaded_file* loaded;
+
+  if (    use_worker_results
+       && (report_open_results(worker_results[worker_idx]) == 0))
+  {
+    fprintf(stderr, "\nError: cannot write result file '%s'\n", worker_results[worker_idx]);
+    exit(1);
+  }
+
+  while ((f = next_file(&loaded)) != 0)
+  {
+    uint64_t start = sched_now_us();
+    report_begin_file(f->list_idx, f->path);
+    ppcond_set_file_macros(compdb_macros(f->list_idx));
+    check_listed_file(lex, f->path, loaded);
+    sched_record(f, sched_now_us() - start);
+  }
+  loader_free();
+
+  if (use_worker_results)
+  {
+    if (print_alloc_stats)
+    {
+      src_print_alloc_stats(stderr); /* per worker process */
+    }
+    if (report_close_results() == 0)
+    {
+      exit(1);
+    }
+  }
+}
+
+
+/* stable shard assignment - the same on every host and run */
+static int in_shard(const char* file_path)
+{
+  uint64_t h = hash_fnv1a64(file_path, strlen(file_path), HASH_FNV1A64_INIT);
+  return ((h % nshards) == shard_idx);
+}
+
+
+/* Analyze a stream of '<size> <path>\n<size bytes>\n' records - contents are never written to disk */
+static int check_blobs(FILE* in)
+{
+  char     header[4096];
+  uint32_t blob_idx = 0;
+
+  while (fgets(header, sizeof(header), in) != 0)
+  {
+    char* path = 0;
+    char* nl = strchr(header, '\n');
+    unsigned long size = strtoul(header, &path, 10);
+    if (nl != 0)
+    {
+      *nl = 0;
+    }
+    if (    (path == header)
+         || (*path != ' ')
+         || (path[1] == 0))
+    {
+      fprintf(stderr, "\nError: malformed blob header '%s', expected '<size> <path>'\n", header);
+      return 0;
+    }
+    path += 1;
+
+    int success = 1;
+    if (    in_shard(path)
+         && (!diff_enabled() || diff_file_relevant(path)))
+    {
+      report_begin_file(blob_idx, path);
+      success = analysis_check_stream(lex, path, in, size);
+    }
+    else
+    {
+      success = src_skip_stream(in, size);
+    }
+    if (!success)
+    {
+      fprintf(stderr, "\nError: blob stream ended inside '%s'\n", path);
+      return 0;
+    }
+
+    int c = fgetc(in); /* records end with a newline, as in 'git cat-file --batch' output */
+    if ((c != '\n') && (c != EOF))
+    {
+      ungetc(c, in);
+    }
+    blob_idx += 1;
+  }
+  return 1;
+}
+
 
 
 /* Main driver: */
 int main(int argc, char* argv[])
 {
-  if (argc < 2)
+  const char* list_path = 0;
+  const char* compdb_path = 0;
+  const char* types_path = 0;
+  const char* rules_path = 0;
+  const char* emit_dir = 0;
+  const char* cache_dir = 0;
+  const char* dump_path = 0;
+  const char* results_path = 0;
+  const char* timings_path = 0;
+  const char* diff_path = 0;
+  const char* baseline_path = 0;
+  const char* new_baseline_path = 0;
+  const char* metrics_path = 0;
+  int stdin_blobs = 0;
+  uint32_t max_ms = 0;
+  uint32_t max_tokens = 0;
+  uint32_t njobs = 1;
+  int std = LEXER_STD_GNU;
+  int success = 1;
+  int i;
+  uint32_t j;
+
+  /* 'tlint merge <result-files...>' */
+  if ((argc >= 2) && (strcmp(argv[1], "merge") == 0))
   {
-    fprintf(stderr, "\nError: No file-list given as input\n\nUsage: %s <input-file>\n\n", argv[0]);
-    return 1;
+    if (argc < 3)
+    {
+      fprintf(stderr, "\nError: No result files given\n\nUsage: %s merge <result-file>...\n\n", argv[0]);
+      return 1;
+    }
+    return report_merge(argc - 2, &argv[2], 1) ? 0 : 1;
   }
 
-  FILE* f = fopen(argv[1], "rb");
-  if (f != 0)
+  for (i = 1; i < argc; ++i)
   {
-    struct lexer l;
+    if (strcmp(argv[i], "--no-prefilter") == 0)
+    {
+      analysis_set_prefilter(0);
+    }
+    else if (strcmp(argv[i], "--vector-match") == 0)
+    {
+      analysis_set_vector_match(1);
+    }
+    else if ((strcmp(argv[i], "--emit-tokens") == 0) && ((i + 1) < argc))
+    {
+      emit_dir = argv[++i];
+    }
+    else if ((strcmp(argv[i], "--token-cache") == 0) && ((i + 1) < argc))
+    {
+      cache_dir = argv[++i];
+    }
+    else if ((strcmp(argv[i], "--dump-tokens") == 0) && ((i + 1) < argc))
+    {
+      dump_path = argv[++i];
+    }
+    else if ((strcmp(argv[i], "--shard") == 0) && ((i + 1) < argc))
+    {
+      if (    (sscanf(argv[++i], "%u/%u", &shard_idx, &nshards) != 2)
+           || (nshards == 0)
+           || (shard_idx >= nshards))
+      {
+        fprintf(stderr, "\nError: invalid shard '%s', expected 'i/N' with 0 <= i < N\n", argv[i]);
+        return 1;
+      }
+    }
+    else if (strncmp(argv[i], "--std=", 6) == 0)
+    {
+      std = lexer_std_by_name(&argv[i][6]);
+      if (std < 0)
+      {
+        fprintf(stderr, "\nError: unknown dialect '%s', expected c89, c99, c11 or gnu\n", &argv[i][6]);
+        return 1;
+      }
+    }
+    else if ((strcmp(argv[i], "--results") == 0) && ((i + 1) < argc))
+    {
+      results_path = argv[++i];
+    }
+    else if ((strcmp(argv[i], "--jobs") == 0) && ((i + 1) < argc))
+    {
+      njobs = (uint32_t)strtoul(argv[++i], 0, 10);
+      if (njobs == 0)
+      {
+        njobs = (uint32_t)sysconf(_SC_NPROCESSORS_ONLN);
+      }
+      if (njobs > MAXJOBS)
+      {
+        njobs = MAXJOBS;
+      }
+    }
+    else if ((strcmp(argv[i], "--timings") == 0) && ((i + 1) < argc))
+    {
+      timings_path = argv[++i];
+    }
+    else if ((strcmp(argv[i], "--compile-commands") == 0) && ((i + 1) < argc))
+    {
+      compdb_path = argv[++i];
+    }
+    else if ((strcmp(argv[i], "--diff") == 0) && ((i + 1) < argc))
+    {
+      diff_path = argv[++i];
+    }
+    else if ((strcmp(argv[i], "--watch") == 0) && ((i + 1) < argc))
+    {
+      watch_add_dir(argv[++i]);
+    }
+    else if ((strcmp(argv[i], "--baseline") == 0) && ((i + 1) < argc))
+    {
+      baseline_path = argv[++i];
+    }
+    else if ((strcmp(argv[i], "--write-baseline") == 0) && ((i + 1) < argc))
+    {
+      new_baseline_path = argv[++i];
+    }
+    else if (strcmp(argv[i], "--stdin-blobs") == 0)
+    {
+      stdin_blobs = 1;
+    }
+    else if (strcmp(argv[i], "--project-checks") == 0)
+    {
+      check_project_decls_enable(1);
+    }
+    else if ((strcmp(argv[i], "--clones") == 0) && ((i + 1) < argc))
+    {
+      clones_enable((uint32_t)strtoul(argv[++i], 0, 10));
+    }
+    else if ((strcmp(argv[i], "--metrics") == 0) && ((i + 1) < argc))
+    {
+      metrics_path = argv[++i];
+    }
+    else if ((strcmp(argv[i], "--max-ms") == 0) && ((i + 1) < argc))
+    {
+      max_ms = (uint32_t)strtoul(argv[++i], 0, 10);
+    }
+    else if ((strcmp(argv[i], "--max-tokens") == 0) && ((i + 1) < argc))
+    {
+      max_tokens = (uint32_t)strtoul(argv[++i], 0, 10);
+    }
+    else if ((strcmp(argv[i], "--readahead") == 0) && ((i + 1) < argc))
+    {
+      readahead_set_window((uint32_t)strtoul(argv[++i], 0, 10));
+    }
+    else if ((strcmp(argv[i], "--load-batch") == 0) && ((i + 1) < argc))
+    {
+      loader_set_batch((uint32_t)strtoul(argv[++i], 0, 10));
+    }
+    else if (strcmp(argv[i], "--alloc-stats") == 0)
+    {
+      print_alloc_stats = 1;
+    }
+    else if ((strcmp(argv[i], "--types") == 0) && ((i + 1) < argc))
+    {
+      types_path = argv[++i];
+    }
+    else if ((strcmp(argv[i], "--name-rules") == 0) && ((i + 1) < argc))
+    {
+      rules_path = argv[++i];
+    }
+    else if (strcmp(argv[i], "--follow-includes") == 0)
+    {
+      include_set_follow(1);
+    }
+    else if ((argv[i][0] == '-') && (argv[i][1] == 'I'))
+    {
+      if (argv[i][2] != 0)
+      {
+        include_add_path(&argv[i][2]);
+      }
+      else if ((i + 1) < argc)
+      {
+        include_add_path(argv[++i]);
+      }
+    }
+    else if ((argv[i][0] == '-') && (argv[i][1] == 'D'))
+    {
+      if (argv[i][2] != 0)
+      {
+        ppcond_define(&argv[i][2]);
+      }
+      else if ((i + 1) < argc)
+      {
+        ppcond_define(argv[++i]);
+      }
+    }
+    else if ((argv[i][0] == '-') && (argv[i][1] == 'U'))
+    {
+      if (argv[i][2] != 0)
+      {
+        ppcond_undefine(&argv[i][2]);
+      }
+      else if ((i + 1) < argc)
+      {
+        ppcond_undefine(argv[++i]);
+      }
+    }
+    else if (argv[i][0] != '-')
+    {
+      list_path = argv[i];
+    }
+    else
+    {
+      fprintf(stderr, "\nError: unknown option '%s'\n", argv[i]);
+      list_path = 0;
+      break;
+    }
+  }
 
+  if (dump_path != 0)
+  {
+    struct lexer l;
     lexer_init(&l);
-    lexer_setup_alphabet(&l);
+    lexer_setup_alphabet(&l, std);
+    int dumped = tokcache_dump(&l, dump_path);
+    lexer_free(&l);
+    if (!dumped)
+    {
+      fprintf(stderr, "\nError: '%s' is not a valid token cache\n", dump_path);
+    }
+    return dumped ? 0 : 1;
+  }
 
-    l.continue_on_error = 1;
+  if (    (list_path == 0)
+       && (compdb_path == 0)
+       && (diff_path == 0)
+       && !stdin_blobs
+       && !watch_enabled())
+  {
+    fprintf(stderr, "\nError: No file-list given as input\n\nUsage: %s [options] <input-file>\n"
+                    "       %s [options] --compile-commands <compile_commands.json>\n"
+                    "       %s [options] --diff <file|->\n"
+                    "       %s [options] --stdin-blobs\n"
+                    "       %s [options] --watch <dir> [--watch <dir>...]\n"
+                    "       %s merge <result-file>...\n\n"
+                    "Options:\n"
+                    "  --compile-commands <file> analyze each file of a compilation database once, with its -D/-U options\n"
+                    "  --shard <i/N>        analyze only the files of shard i (0-based) out of N, by path hash\n"
+                    "  --results <file>     write findings to a result file for 'merge', instead of printing them\n"
+                    "  --jobs <N>           analyze files in N worker processes, 0 for one per CPU\n"
+                    "  --timings <file>     per-file times of earlier runs, to start the slowest files first - updated\n"
+                    "  --no-prefilter       lex and check every file, even when no checker can fire\n"
+                    "  --vector-match       run sequence-shaped checks over the whole file with SIMD compares\n"
+                    "  --emit-tokens <dir>  write each file's token stream to '<dir>/<path-hash>.tlt'\n"
+                    "  --token-cache <dir>  check from up-to-date '.tlt' token streams in <dir> instead of lexing\n"
+                    "  --dump-tokens <file> print the tokens of a '.tlt' token stream and exit\n"
+                    "  --follow-includes    also analyze headers named in '#include \"...\"', each unique file once\n"
+                    "  -I <dir>             include path used with --follow-includes\n"
+                    "  -D <name>[=<value>]  macro known to be defined, for skipping '#if' branches that are not compiled\n"
+                    "  -U <name>            macro known not to be defined\n"
+                    "  --std=<dialect>      keywords of c89, c99, c11 or gnu (default): e.g. 'inline' is an identifier in c89\n"
+                    "  --diff <file|->      analyze only files touched by a unified diff and report only on added lines\n"
+                    "  --stdin-blobs        read '<size> <path>' headers, each followed by the file contents, from stdin\n"
+                    "  --watch <dir>        analyze the sources below <dir>, then re-analyze files as they change\n"
+                    "  --baseline <file>    report only findings whose fingerprint is not in the baseline file\n"
+                    "  --write-baseline <file> write the fingerprints of all findings to a baseline file\n"
+                    "  --project-checks     compare declarations across files, e.g. 'f()' vs 'f(void)', global types\n"
+                    "  --clones <N>         report copied code of at least N tokens (0: 64), identifiers and constants may differ\n"
+                    "  --metrics <file>     write lines, code, statements, comments, functions, nesting and complexity per file/function\n"
+                    "  --max-ms <N>         stop analyzing a file after N milliseconds, noted on stderr as skipped\n"
+                    "  --max-tokens <N>     stop analyzing a file after N tokens, noted on stderr as skipped\n"
+                    "  --readahead <N>      read the next N files into the page cache on a background thread, in on-disk order\n"
+                    "  --load-batch <N>     open and read files N at a time, through io_uring where available\n"
+                    "  --alloc-stats        print heap allocations of the arena for file paths and contents to stderr\n"
+                    "  --types <file>       project-wide type names, one '<name> [<base-type>]' per line\n"
+                    "  --name-rules <file>  extra variable-name rules, one '<prefix> <type>' per line\n\n", argv[0], argv[0], argv[0], argv[0], argv[0], argv[0]);
+    return 1;
+  }
 
-    char file_path[1024];
-    int  file_len = 0;
-    int  c;
-    while ((c = fgetc(f)) != EOF)
+  if (    (njobs > 1)
+       && include_follow_enabled())
+  {
+    fprintf(stderr, "\nError: --follow-includes cannot be combined with --jobs\n");
+    return 1;
+  }
+  if (    (compdb_path != 0)
+       && (list_path != 0))
+  {
+    fprintf(stderr, "\nError: --compile-commands replaces the file-list - give only one of them\n");
+    return 1;
+  }
+  if (    stdin_blobs
+       && (    (njobs > 1)
+            || include_follow_enabled()
+            || (list_path != 0)
+            || (compdb_path != 0)
+            || ((diff_path != 0) && (strcmp(diff_path, "-") == 0))))
+  {
+    fprintf(stderr, "\nError: --stdin-blobs reads all input from stdin - it cannot be combined with a file-list, --jobs, --follow-includes or '--diff -'\n");
+    return 1;
+  }
+  if (    watch_enabled()
+       && (    stdin_blobs
+            || (njobs > 1)
+            || (list_path != 0)
+            || (compdb_path != 0)
+            || (diff_path != 0)
+            || (results_path != 0)))
+  {
+    fprintf(stderr, "\nError: --watch cannot be combined with a file-list, --stdin-blobs, --jobs, --diff or --results\n");
+    return 1;
+  }
+
+  if (    (check_project_decls_enabled() || clones_enabled())
+       && (    (njobs > 1)
+            || watch_enabled()))
+  {
+    fprintf(stderr, "\nError: --project-checks and --clones cannot be combined with --jobs or --watch\n");
+    return 1;
+  }
+
+  if (    (new_baseline_path != 0)
+       && (njobs > 1))
+  {
+    fprintf(stderr, "\nError: --write-baseline cannot be combined with --jobs\n");
+    return 1;
+  }
+
+  analysis_set_token_cache(emit_dir, cache_dir);
+  analysis_set_budget(max_ms, max_tokens);
+
+  if (    (baseline_path != 0)
+       && (baseline_load(baseline_path) == 0))
+  {
+    fprintf(stderr, "\nError: cannot read baseline file '%s'\n", baseline_path);
+    return 1;
+  }
+  if (    (new_baseline_path != 0)
+       && (baseline_open_output(new_baseline_path) == 0))
+  {
+    fprintf(stderr, "\nError: cannot write baseline file '%s'\n", new_baseline_path);
+    return 1;
+  }
+
+  if (    (metrics_path != 0)
+       && (metrics_open(metrics_path) == 0))
+  {
+    fprintf(stderr, "\nError: cannot write metrics file '%s'\n", metrics_path);
+    return 1;
+  }
+
+  if (    (diff_path != 0)
+       && (diff_load(diff_path) == 0))
+  {
+    fprintf(stderr, "\nError: cannot read diff '%s'\n", diff_path);
+    return 1;
+  }
+
+  if (list_path != 0)
+  {
+    if (sched_load_list(list_path) == 0)
+    {
+      fprintf(stderr, "\nError: cannot read file-list '%s'\n", list_path);
+      return 1;
+    }
+  }
+  else if (compdb_path != 0)
+  {
+    if (compdb_load(compdb_path) == 0)
+    {
+      fprintf(stderr, "\nError: cannot read compilation database '%s'\n", compdb_path);
+      return 1;
+    }
+  }
+  else if (!stdin_blobs)
+  {
+    /* no file-list: the C sources and headers touched by the diff */
+    for (j = 0; j < diff_nfiles(); ++j)
     {
-      /* begin scanning a new file from 'file_path' */
-      if ((char)c == '\n')
+      const char* path = diff_file_path(j);
+      const char* ext = strrchr(path, '.');
+      if (    (ext != 0)
+           && ((strcmp(ext, ".c") == 0) || (strcmp(ext, ".h") == 0)))
       {
-        file_path[file_len] = 0; /* terminate string */
-        analysis_check_file(&l, file_path);
-        file_len = 0;
+        sched_add_file(path);
       }
-      else
+    }
+  }
+
+  for (j = 0; j < sched_nfiles(); ++j)
+  {
+    const char* path = sched_file(j)->path;
+    sched_file(j)->selected = in_shard(path)
+                           && (!diff_enabled() || diff_file_relevant(path));
+  }
+  if (timings_path != 0)
+  {
+    sched_load_timings(timings_path);
+  }
+
+  /* workers finish in any order - only reorder when results are merged back into list order */
+  sched_plan(njobs > 1);
+
+  struct lexer l;
+  lexer_init(&l);
+  lexer_setup_alphabet(&l, std);
+  typedefs_init(&l);
+  lex = &l;
+
+  if (    (types_path != 0)
+       && (typedefs_load(types_path) == 0))
+  {
+    fprintf(stderr, "\nError: cannot read types file '%s'\n", types_path);
+    return 1;
+  }
+
+  check_misleading_var_name_setup(&l);
+  if (    (rules_path != 0)
+       && (check_misleading_var_name_load_rules(rules_path) == 0))
+  {
+    fprintf(stderr, "\nError: cannot read name-rules file '%s'\n", rules_path);
+    return 1;
+  }
+
+  l.continue_on_error = 1;
+
+  if (njobs > 1)
+  {
+    /* type names are learned per process - learn those of all files before the workers are forked */
+    for (j = 0; j < sched_nfiles(); ++j)
+    {
+      const struct sched_file* f = sched_file(j);
+      if (f->selected)
       {
-        file_path[file_len++] = (char)c;
+        ppcond_set_file_macros(compdb_macros(f->list_idx));
+        analysis_learn_types(&l, f->path);
       }
     }
-    fclose(f);
-    lexer_free(&l);
+    ppcond_set_file_macros(0);
+
 
-    return 0;
+    const char* tmp_dir = getenv("TMPDIR");
+    for (j = 0; j < njobs; ++j)
+    {
+      char tmp_path[1024];
+      snprintf(tmp_path, sizeof(tmp_path), "%s/tlint-results-XXXXXX", (tmp_dir != 0) ? tmp_dir : "/tmp");
+      int fd = mkstemp(tmp_path);
+      if (fd < 0)
+      {
+        fprintf(stderr, "\nError: cannot create temporary result file '%s'\n", tmp_path);
+        return 1;
+      }
+      close(fd);
+      worker_results[j] = strdup(tmp_path);
+    }
+    use_worker_results = 1;
+  }
+  else if (    (results_path != 0)
+            && (report_open_results(results_path) == 0))
+  {
+    fprintf(stderr, "\nError: cannot write result file '%s'\n", results_path);
+    return 1;
   }
 
-  return 1;
+  if (watch_enabled())
+  {
+    success = watch_run(&l);
+  }
+  else if (stdin_blobs)
+  {
+    success = check_blobs(stdin);
+  }
+  else
+  {
+    if (readahead_start() == 0)
+    {
+      fprintf(stderr, "WARNING: cannot start readahead thread\n");
+    }
+    success = sched_run_workers(njobs, check_files);
+    readahead_stop();
+  }
+
+  if (check_project_decls_enabled())
+  {
+    check_project_decls_report(PROJECT_FILE_IDX);
+  }
+  if (clones_enabled())
+  {
+    clones_report(PROJECT_FILE_IDX);
+  }
+
+  if (    print_alloc_stats
+       && !use_worker_results)
+  {
+    src_print_alloc_stats(stderr);
+  }
+
+  if (njobs > 1)
+  {
+    /* combine the workers' results - in list order, as a sequential run would report them */
+    if (results_path != 0)
+    {
+      success = success && report_open_results(results_path);
+      for (j = 0; (j < njobs) && success; ++j)
+      {
+        success = report_append_results(worker_results[j]);
+      }
+    }
+    else
+    {
+      success = success && report_merge((int)njobs, worker_results, 0);
+    }
+    for (j = 0; j < njobs; ++j)
+    {
+      remove(worker_results[j]);
+      free(worker_results[j]);
+    }
+  }
+
+  if (report_close_results() == 0)
+  {
+    fprintf(stderr, "\nError: cannot write result file '%s'\n", results_path);
+    success = 0;
+  }
+
+  if (metrics_close() == 0)
+  {
+    fprintf(stderr, "\nError: cannot write metrics file '%s'\n", metrics_path);
+    success = 0;
+  }
+
+  if (baseline_close_output() == 0)
+  {
+    fprintf(stderr, "\nError: cannot write baseline file '%s'\n", new_baseline_path);
+    success = 0;
+  }
+
+  if (    (timings_path != 0)
+       && (sched_save_timings(timings_path) == 0))
+  {
+    fprintf(stderr, "\nError: cannot write timings file '%s'\n", timings_path);
+    success = 0;
+  }
+
+  check_misleading_var_name_free();
+  typedefs_free();
+  lexer_free(&l);
+  include_free();
+  sched_free();
+  src_release();
+  diff_free();
+  baseline_free();
+  report_free();
+  clones_free();
+  symindex_free();
+  intern_free();
+  ppcond_free();
+  compdb_free();
+
+  return success ? 0 : 1;
 }
 
 
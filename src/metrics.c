@@ -0,0 +1,361 @@
+/*
+
+Code metrics
+
+  Per file, the token stream is walked once:
+    - the gap before each token is scanned for comments, and lines holding one are counted,
+    - a token on a new line counts a code line,
+    - a ';' outside parentheses, and 'if', 'for', 'while' and 'switch', count a statement,
+    - at brace level 0, '(' after an identifier names a candidate function, and '{' right
+      after the closing ')' starts its body. Nesting and complexity are tracked until the
+      body's closing '}'.
+
+  Rows are collected in a buffer and written when the file is done.
+
+*/
+
+#include "metrics.h"
+#include <assert.h>
+#include <fcntl.h>    /* open */
+#include <stdarg.h>   /* va_list */
+#include <stdio.h>    /* vsnprintf */
+#include <stdlib.h>   /* realloc, free */
+#include <string.h>   /* strlen */
+#include <unistd.h>   /* write, close */
+
+
+#define METRICS_HEADER   "# tlint-metrics 2\n# kind\tpath\tname\tline\tlines\tcode\tstmts\tcomment\tratio\tfunctions\tnesting\tccn\n"
+
+
+struct counts
+{
+  uint32_t code;
+  uint32_t stmts;
+  uint32_t comment;
+};
+
+
+static int      fd = -1;
+static char*    rows = 0;            /* rows of the current file - function rows first, file row prepended at the end */
+static uint32_t rows_len = 0;
+static uint32_t rows_cap = 0;
+
+/* state of the current file */
+static struct counts file_counts;
+static uint32_t last_code_line = 0;
+static uint32_t last_comment_line = 0;
+static uint32_t prev_end = 0;        /* offset after the previous token */
+static uint32_t prev_line = 1;       /* line of the previous token */
+static int      brace_lvl = 0;
+static int      paren_lvl = 0;
+static uint32_t nfunctions = 0;
+static uint32_t max_nesting = 0;
+static uint32_t ccn_total = 0;
+
+/* function being defined */
+static const struct token* cand_name = 0;   /* identifier before '(' at brace level 0 */
+static int      cand_closed = 0;            /* its ')' was seen - a '{' now starts the body */
+static struct counts cand_start;            /* counts before the line with the name */
+static const struct token* func_name = 0;
+static uint32_t func_line = 0;
+static uint32_t func_nesting = 0;
+static uint32_t func_ccn = 0;
+static struct counts func_start;
+
+
+
+static void append(const char* fmt, ...) __attribute__((format(printf, 1, 2)));
+
+static void append(const char* fmt, ...)
+{
+  va_list args;
+  int len;
+
+  va_start(args, fmt);
+  len = vsnprintf(0, 0, fmt, args);
+  va_end(args);
+
+  if ((rows_len + (uint32_t)len + 1) > rows_cap)
+  {
+    rows_cap = 2 * (rows_len + (uint32_t)len + 1);
+    rows = realloc(rows, rows_cap);
+    assert(rows != 0);
+  }
+
+  va_start(args, fmt);
+  vsnprintf(&rows[rows_len], rows_cap - rows_len, fmt, args);
+  va_end(args);
+  rows_len += (uint32_t)len;
+}
+
+
+int metrics_open(const char* metrics_path)
+{
+  fd = open(metrics_path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+  if (fd < 0)
+  {
+    return 0;
+  }
+  return (write(fd, METRICS_HEADER, strlen(METRICS_HEADER)) == (ssize_t)strlen(METRICS_HEADER));
+}
+
+int metrics_enabled(void)
+{
+  return (fd >= 0);
+}
+
+int metrics_close(void)
+{
+  int success = 1;
+  if (fd >= 0)
+  {
+    success = (close(fd) == 0);
+    fd = -1;
+  }
+  free(rows);
+  rows = 0;
+  rows_len = 0;
+  rows_cap = 0;
+  return success;
+}
+
+
+void metrics_new_file(void)
+{
+  memset(&file_counts, 0, sizeof(file_counts));
+  last_code_line = 0;
+  last_comment_line = 0;
+  prev_end = 0;
+  prev_line = 1;
+  brace_lvl = 0;
+  paren_lvl = 0;
+  nfunctions = 0;
+  max_nesting = 0;
+  ccn_total = 0;
+  cand_name = 0;
+  cand_closed = 0;
+  func_name = 0;
+  rows_len = 0;
+}
+
+
+static void comment_line(uint32_t lineno)
+{
+  if (lineno != last_comment_line)
+  {
+    file_counts.comment += 1;
+    last_comment_line = lineno;
+  }
+}
+
+
+/* Count the comment lines in the bytes between two tokens - whitespace, comments and pre-processor lines */
+static void scan_gap(const char* p, const char* end, uint32_t lineno)
+{
+  while (p < end)
+  {
+    if (    (p[0] == '/')
+         && (p[1] == '*'))
+    {
+      comment_line(lineno);
+      for (p += 2; (p < end) && !((p[0] == '*') && (p[1] == '/')); ++p)
+      {
+        if (*p == '\n')
+        {
+          lineno += 1;
+          comment_line(lineno);
+        }
+      }
+      p += 2;
+    }
+    else if (    (p[0] == '/')
+              && (p[1] == '/'))
+    {
+      comment_line(lineno);
+      while ((p < end) && (*p != '\n'))
+      {
+        p += 1;
+      }
+    }
+    else if (    (p[0] == '"')      /* e.g. '#include "a//b.h"' */
+              || (p[0] == '\''))
+    {
+      char quote = *p++;
+      while ((p < end) && (*p != quote) && (*p != '\n'))
+      {
+        p += 1 + ((p[0] == '\\') && ((p + 1) < end));
+      }
+      p += (p < end) && (*p == quote);
+    }
+    else
+    {
+      lineno += (*p == '\n');
+      p += 1;
+    }
+  }
+}
+
+
+static void end_function(const struct source_file* s, uint32_t end_line)
+{
+  uint32_t code = file_counts.code - func_start.code;
+  uint32_t stmts = file_counts.stmts - func_start.stmts;
+  uint32_t comment = file_counts.comment - func_start.comment;
+  uint32_t lines = end_line - func_line + 1;
+
+  append("func\t%s\t%.*s\t%u\t%u\t%u\t%u\t%u\t%.2f\t-\t%u\t%u\n", s->file_path, (int)func_name->symlen, func_name->symbol,
+         func_line, lines, code, stmts, comment, (double)comment / lines, func_nesting, func_ccn);
+
+  nfunctions += 1;
+  ccn_total += func_ccn;
+  if (func_nesting > max_nesting)
+  {
+    max_nesting = func_nesting;
+  }
+  func_name = 0;
+}
+
+
+void metrics_new_token(const struct source_file* s, const struct token* toks, int tok_idx)
+{
+  const struct token* t = &toks[tok_idx];
+
+  if (t->foffset > prev_end)
+  {
+    scan_gap(&s->file_content[prev_end], &s->file_content[t->foffset], prev_line);
+  }
+  prev_end = t->foffset + t->symlen;
+  prev_line = t->lineno;
+
+  if (t->lineno != last_code_line)
+  {
+    file_counts.code += 1;
+    last_code_line = t->lineno;
+  }
+
+  switch (t->toktyp)
+  {
+    case OP_LPAREN:
+    {
+      if (    (brace_lvl == 0)
+           && (paren_lvl == 0))
+      {
+        cand_name = ((tok_idx > 0) && (toks[tok_idx-1].tokknd == TOK_IDENTIFIER)) ? &toks[tok_idx-1] : 0;
+        cand_closed = 0;
+        cand_start = file_counts;
+        cand_start.code -= (cand_start.code > 0) && (cand_name != 0) && (cand_name->lineno == last_code_line);
+      }
+      paren_lvl += 1;
+    } break;
+    case OP_RPAREN:
+    {
+      paren_lvl -= (paren_lvl > 0);
+      cand_closed = (brace_lvl == 0) && (paren_lvl == 0) && (cand_name != 0);
+    } break;
+    case OP_LBRACE:
+    {
+      if (    (brace_lvl == 0)
+           && cand_closed
+           && (toks[tok_idx-1].toktyp == OP_RPAREN))
+      {
+        func_name = cand_name;
+        func_line = cand_name->lineno;
+        func_nesting = 0;
+        func_ccn = 1;
+        func_start = cand_start;
+      }
+      else if (    (func_name != 0)
+                && ((uint32_t)brace_lvl > func_nesting))
+      {
+        func_nesting = (uint32_t)brace_lvl;
+      }
+      cand_name = 0;
+      cand_closed = 0;
+      brace_lvl += 1;
+    } break;
+    case OP_RBRACE:
+    {
+      brace_lvl -= (brace_lvl > 0);
+      if (    (brace_lvl == 0)
+           && (func_name != 0))
+      {
+        end_function(s, t->lineno);
+      }
+    } break;
+    case OP_SEMICOLON:
+    {
+      file_counts.stmts += (paren_lvl == 0);   /* not the ones in 'for (;;)' */
+      if (brace_lvl == 0)
+      {
+        cand_name = 0;
+        cand_closed = 0;
+      }
+    } break;
+    case KW_SWITCH:
+    case KW_IF:
+    case KW_FOR:
+    case KW_WHILE:
+    {
+      file_counts.stmts += 1;   /* no ';' of its own - the one of its body is another statement */
+      func_ccn += (func_name != 0) && (t->toktyp != KW_SWITCH);
+    } break;
+    case KW_CASE:
+    case OP_LOGICAL_AND:
+    case OP_LOGICAL_OR:
+    case OP_QUESTIONMARK:
+    {
+      func_ccn += (func_name != 0);
+    } break;
+    default:
+    {
+      if (t->tokknd != TOK_IDENTIFIER)
+      {
+        cand_closed = 0;  /* 'f(x) const' etc. are not C */
+      }
+    } break;
+  }
+}
+
+
+/* Finish the file: trailing comments, the file row, and one write for all rows of the file */
+void metrics_end_file(const struct source_file* s)
+{
+  uint32_t lines = s->nlines + ((s->file_size > 0) && (s->file_content[s->file_size - 1] != '\n'));
+  char file_row[4096 + 256];
+  int len;
+
+  if (s->file_size > prev_end)
+  {
+    scan_gap(&s->file_content[prev_end], &s->file_content[s->file_size], prev_line);
+  }
+  if (func_name != 0)
+  {
+    end_function(s, prev_line); /* body not closed before the end of the file */
+  }
+
+  len = snprintf(file_row, sizeof(file_row), "file\t%s\t-\t1\t%u\t%u\t%u\t%u\t%.2f\t%u\t%u\t%u\n", s->file_path,
+                 lines, file_counts.code, file_counts.stmts, file_counts.comment, (lines > 0) ? ((double)file_counts.comment / lines) : 0.0,
+                 nfunctions, max_nesting, ccn_total);
+  if ((uint32_t)len >= sizeof(file_row))
+  {
+    len = (int)sizeof(file_row) - 1;
+  }
+
+  /* file row first */
+  if ((rows_len + (uint32_t)len + 1) > rows_cap)
+  {
+    rows_cap = 2 * (rows_len + (uint32_t)len + 1);
+    rows = realloc(rows, rows_cap);
+    assert(rows != 0);
+  }
+  memmove(&rows[len], rows, rows_len);
+  memcpy(rows, file_row, (size_t)len);
+  rows_len += (uint32_t)len;
+
+  if (write(fd, rows, rows_len) != (ssize_t)rows_len)
+  {
+    fprintf(stderr, "WARNING: could not write metrics of '%s'\n", s->file_path);
+  }
+  rows_len = 0;
+}
+
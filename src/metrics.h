@@ -0,0 +1,49 @@
+#ifndef __METRICS_H__
+#define __METRICS_H__
+
+/*
+
+Code metrics
+
+  Computed from the token stream of the normal analysis pass - files are not read or
+  lexed again. Comments are not tokens: they are found in the gaps between tokens.
+
+    lines     physical lines
+    code      lines with at least one token
+    stmts     logical lines: statements and declarations - each ';' outside parentheses, plus
+              if, for, while and switch, whose bodies end in a ';' of their own
+    comment   lines with (part of) a comment
+    ratio     comment / lines
+    functions function definitions
+    nesting   deepest block nesting inside a function body, 0 for a flat body
+    ccn       cyclomatic complexity: 1 + if, for, while, case, &&, || and ?:
+              for files, the sum over its functions
+
+  Table format - text, tab-separated, one row per file followed by one per function:
+
+    # tlint-metrics 2
+    # kind  path  name  line  lines  code  stmts  comment  ratio  functions  nesting  ccn
+    file    <path>  -       1       ...
+    func    <path>  <name>  <line>  ...                    -          ...
+
+  Each file's rows are written with a single write() to a file opened for appending,
+  so worker processes can share the table.
+
+*/
+
+#include "lexer.h"
+#include "source.h"
+
+
+
+int  metrics_open(const char* metrics_path);
+int  metrics_enabled(void);
+void metrics_new_file(void);
+void metrics_new_token(const struct source_file* s, const struct token* toks, int tok_idx);
+void metrics_end_file(const struct source_file* s);
+int  metrics_close(void);
+
+
+
+#endif /* __METRICS_H__ */
+
@@ -0,0 +1,421 @@
+/*
+
+Pre-processor conditions
+
+  A small recursive-descent evaluator over three-valued results: known true, known false
+  or unknown. Unknown operands only make the result unknown where they can change it, so
+  '0 && UNKNOWN_MACRO' is still known to be false.
+
+*/
+
+#include "ppcond.h"
+#include "hash.h"
+#include <assert.h>
+#include <stdlib.h>   /* malloc, realloc, strtoll, free */
+#include <string.h>   /* strlen, strchr, memcmp, memcpy */
+
+
+struct macro
+{
+  char*   name;
+  int     defined;     /* -D: 1, -U: 0 */
+  int     has_value;   /* value is an integer */
+  int64_t value;
+};
+
+struct value
+{
+  int     known;
+  int64_t v;
+};
+
+
+static struct macro* macros = 0;
+static uint32_t      nmacros = 0;
+static uint32_t      maxmacros = 0;
+static uint32_t      nglobal = UINT32_MAX;   /* macros from the command line - the rest are per file */
+
+/* expression being parsed */
+static const char*   cur = 0;
+static const char*   end = 0;
+static int           failed = 0;
+
+
+
+static struct macro* find_macro(const char* name, uint32_t len)
+{
+  uint32_t i;
+  for (i = 0; i < nmacros; ++i)
+  {
+    if (    (strlen(macros[i].name) == len)
+         && (memcmp(macros[i].name, name, len) == 0))
+    {
+      return &macros[i];
+    }
+  }
+  return 0;
+}
+
+/* add a macro, or find it among macros[from..] */
+static struct macro* add_macro(const char* name, uint32_t len, uint32_t from)
+{
+  struct macro* m = find_macro(name, len);
+  if (    (m != 0)
+       && ((uint32_t)(m - macros) >= from))
+  {
+    return m; /* the last -D/-U of a name wins */
+  }
+  if (nmacros == maxmacros)
+  {
+    maxmacros = (maxmacros == 0) ? 16 : (2 * maxmacros);
+    macros = realloc(macros, maxmacros * sizeof(*macros));
+    assert(macros != 0);
+  }
+  m = &macros[nmacros++];
+  m->name = malloc(len + 1);
+  assert(m->name != 0);
+  memcpy(m->name, name, len);
+  m->name[len] = 0;
+  return m;
+}
+
+
+static void define_from(const char* definition, uint32_t from)
+{
+  const char* eq = strchr(definition, '=');
+  uint32_t len = (eq != 0) ? (uint32_t)(eq - definition) : (uint32_t)strlen(definition);
+  struct macro* m = add_macro(definition, len, from);
+  char* num_end = 0;
+
+  m->defined = 1;
+  m->has_value = 1;
+  m->value = 1;
+  if (eq != 0)
+  {
+    m->value = strtoll(eq + 1, &num_end, 0);
+    m->has_value = (num_end != (eq + 1)) && (*num_end == 0);
+  }
+}
+
+static void undefine_from(const char* name, uint32_t from)
+{
+  struct macro* m = add_macro(name, (uint32_t)strlen(name), from);
+  m->defined = 0;
+  m->has_value = 1;
+  m->value = 0;   /* undefined names are 0 in '#if' */
+}
+
+
+/* 'NAME' or 'NAME=VALUE', as given to -D */
+void ppcond_define(const char* definition)
+{
+  define_from(definition, 0);
+}
+
+void ppcond_undefine(const char* name)
+{
+  undefine_from(name, 0);
+}
+
+
+/* Replace the macros of the previous file by those of the next one - e.g. from its compile command.
+   'list' holds 'D<name>[=<value>]' and 'U<name>' entries, each null-terminated, and ends with an
+   empty one. Macros from the command line take precedence. */
+void ppcond_set_file_macros(const char* list)
+{
+  if (nglobal == UINT32_MAX)
+  {
+    nglobal = nmacros;
+  }
+  while (nmacros > nglobal)
+  {
+    free(macros[--nmacros].name);
+  }
+  for (; (list != 0) && (list[0] != 0); list += strlen(list) + 1)
+  {
+    if (list[0] == 'D')
+    {
+      define_from(&list[1], nglobal);
+    }
+    else
+    {
+      undefine_from(&list[1], nglobal);
+    }
+  }
+}
+
+void ppcond_free(void)
+{
+  uint32_t i;
+  for (i = 0; i < nmacros; ++i)
+  {
+    free(macros[i].name);
+  }
+  free(macros);
+  macros = 0;
+  nmacros = 0;
+  maxmacros = 0;
+  nglobal = UINT32_MAX;
+}
+
+
+int ppcond_eval_defined(const char* name, uint32_t len)
+{
+  const struct macro* m = find_macro(name, len);
+  return (m == 0) ? PPCOND_UNKNOWN : (m->defined ? PPCOND_TRUE : PPCOND_FALSE);
+}
+
+
+/* Hash of the macros in effect - command line and current file - independent of their order.
+   0 when none are known: then only '#if 0' style conditions can skip code. */
+uint64_t ppcond_hash(void)
+{
+  uint64_t sum = 0;
+  uint32_t i;
+  for (i = 0; i < nmacros; ++i)
+  {
+    const struct macro* m = &macros[i];
+    uint64_t h;
+    if (find_macro(m->name, (uint32_t)strlen(m->name)) != m)
+    {
+      continue;   /* shadowed by a command-line macro */
+    }
+    h = hash_fnv1a64(m->name, strlen(m->name) + 1, HASH_FNV1A64_INIT);
+    h = hash_fnv1a64(&m->defined, sizeof(m->defined), h);
+    h = hash_fnv1a64(&m->has_value, sizeof(m->has_value), h);
+    h = hash_fnv1a64(&m->value, sizeof(m->value), h);
+    sum += hash_mix64(h);
+  }
+  return sum;
+}
+
+
+
+/* ================================================== */
+/* Expressions:                                       */
+/* ================================================== */
+
+static int is_ident_char(char c)
+{
+  return (c == '_') || ((c >= 'a') && (c <= 'z')) || ((c >= 'A') && (c <= 'Z')) || ((c >= '0') && (c <= '9'));
+}
+
+/* skip blanks, line continuations and comments - a '//' comment ends the expression */
+static void skip_blanks(void)
+{
+  while (cur < end)
+  {
+    if ((*cur == ' ') || (*cur == '\t') || (*cur == '\r') || (*cur == '\n') || (*cur == '\\'))
+    {
+      cur += 1;
+    }
+    else if (    ((cur + 1) < end)
+              && (cur[0] == '/')
+              && (cur[1] == '*'))
+    {
+      for (cur += 2; ((cur + 1) < end) && !((cur[0] == '*') && (cur[1] == '/')); ++cur)
+      {
+      }
+      cur += 2;
+    }
+    else if (    ((cur + 1) < end)
+              && (cur[0] == '/')
+              && (cur[1] == '/'))
+    {
+      cur = end;
+    }
+    else
+    {
+      break;
+    }
+  }
+  if (cur > end)
+  {
+    cur = end;
+  }
+}
+
+static int match(const char* op)
+{
+  uint32_t len = (uint32_t)strlen(op);
+  skip_blanks();
+  if (    ((uint32_t)(end - cur) >= len)
+       && (memcmp(cur, op, len) == 0))
+  {
+    cur += len;
+    return 1;
+  }
+  return 0;
+}
+
+static struct value known(int64_t v)
+{
+  struct value val;
+  val.known = 1;
+  val.v = v;
+  return val;
+}
+
+static struct value unknown(void)
+{
+  struct value val;
+  val.known = 0;
+  val.v = 0;
+  return val;
+}
+
+
+static struct value parse_or(void);
+
+static struct value parse_primary(void)
+{
+  skip_blanks();
+  if (cur >= end)
+  {
+    failed = 1;
+    return unknown();
+  }
+
+  if (match("("))
+  {
+    struct value v = parse_or();
+    if (!match(")"))
+    {
+      failed = 1;
+    }
+    return v;
+  }
+
+  if ((*cur >= '0') && (*cur <= '9'))
+  {
+    char* num_end = 0;
+    int64_t v = strtoll(cur, &num_end, 0);
+    cur = num_end;
+    while ((cur < end) && is_ident_char(*cur))  /* suffixes: 1UL */
+    {
+      cur += 1;
+    }
+    return known(v);
+  }
+
+  if (is_ident_char(*cur))
+  {
+    const char* name = cur;
+    while ((cur < end) && is_ident_char(*cur))
+    {
+      cur += 1;
+    }
+    uint32_t len = (uint32_t)(cur - name);
+
+    if ((len == 7) && (memcmp(name, "defined", 7) == 0))
+    {
+      int paren = match("(");
+      skip_blanks();
+      name = cur;
+      while ((cur < end) && is_ident_char(*cur))
+      {
+        cur += 1;
+      }
+      len = (uint32_t)(cur - name);
+      if (    (len == 0)
+           || (paren && !match(")")))
+      {
+        failed = 1;
+        return unknown();
+      }
+      int d = ppcond_eval_defined(name, len);
+      return (d == PPCOND_UNKNOWN) ? unknown() : known(d == PPCOND_TRUE);
+    }
+
+    const struct macro* m = find_macro(name, len);
+    return ((m != 0) && m->has_value) ? known(m->value) : unknown();
+  }
+
+  failed = 1;   /* operators we do not evaluate */
+  return unknown();
+}
+
+static struct value parse_unary(void)
+{
+  if (match("!"))
+  {
+    struct value v = parse_unary();
+    return v.known ? known(!v.v) : v;
+  }
+  return parse_primary();
+}
+
+static struct value parse_equality(void)
+{
+  struct value a = parse_unary();
+  for (;;)
+  {
+    int is_eq = match("==");
+    if (!is_eq && !match("!="))
+    {
+      return a;
+    }
+    struct value b = parse_unary();
+    a = (a.known && b.known) ? known(is_eq ? (a.v == b.v) : (a.v != b.v)) : unknown();
+  }
+}
+
+static struct value parse_and(void)
+{
+  struct value a = parse_equality();
+  while (match("&&"))
+  {
+    struct value b = parse_equality();
+    if (    (a.known && !a.v)
+         || (b.known && !b.v))
+    {
+      a = known(0);
+    }
+    else
+    {
+      a = (a.known && b.known) ? known(1) : unknown();
+    }
+  }
+  return a;
+}
+
+static struct value parse_or(void)
+{
+  struct value a = parse_and();
+  while (match("||"))
+  {
+    struct value b = parse_and();
+    if (    (a.known && a.v)
+         || (b.known && b.v))
+    {
+      a = known(1);
+    }
+    else
+    {
+      a = (a.known && b.known) ? known(0) : unknown();
+    }
+  }
+  return a;
+}
+
+
+/* Evaluate the condition of an '#if' / '#elif' */
+int ppcond_eval(const char* expr, uint32_t len)
+{
+  struct value v;
+
+  cur = expr;
+  end = expr + len;
+  failed = 0;
+
+  v = parse_or();
+  skip_blanks();
+  if (    failed
+       || (cur != end)
+       || !v.known)
+  {
+    return PPCOND_UNKNOWN;
+  }
+  return v.v ? PPCOND_TRUE : PPCOND_FALSE;
+}
+
@@ -0,0 +1,41 @@
+#ifndef __PPCOND_H__
+#define __PPCOND_H__
+
+/*
+
+Pre-processor conditions
+
+  Evaluates the conditions of '#if', '#elif', '#ifdef' and '#ifndef' as far as they can be
+  known without running the pre-processor: literals, and macros given on the command line
+  with -D (defined, with a value) or -U (not defined) - or per file, from its compile
+  command. Anything else - macros defined by headers, arithmetic - leaves the condition
+  unknown, and such code is analyzed as before.
+
+  Supported: integers, NAME, defined NAME, defined(NAME), !, &&, ||, ==, !=, ( )
+
+*/
+
+#include <stdint.h>
+
+
+enum
+{
+  PPCOND_FALSE,
+  PPCOND_TRUE,
+  PPCOND_UNKNOWN,
+};
+
+
+
+void ppcond_define(const char* definition);
+void ppcond_undefine(const char* name);
+void ppcond_set_file_macros(const char* list);
+int  ppcond_eval(const char* expr, uint32_t len);
+int  ppcond_eval_defined(const char* name, uint32_t len);
+uint64_t ppcond_hash(void);
+void ppcond_free(void);
+
+
+
+#endif /* __PPCOND_H__ */
+
@@ -0,0 +1,200 @@
+/*
+
+Pre-lex prefilter
+
+  Every checker has a short list of trigger words (needles) - if none of them occur
+  in the raw file contents, the checker cannot produce a warning for that file.
+
+  Needles are grouped by their first two bytes. The main loop loads two overlapping
+  vectors (at offset i and i+1) and compares them against each group's two bytes,
+  so every group costs two compares per VEC_BYTES bytes of input. Candidate positions
+  are then verified with memcmp() and identifier-boundary checks.
+  Once a checker has been seen, its needles are dropped from the scan, and the scan
+  stops as soon as all wanted checkers have been seen.
+
+*/
+
+#include "prefilter.h"
+#include "analysis.h"
+#include "simd.h"
+#include <string.h> /* memcmp */
+
+
+#define MAXGROUPS  16
+
+
+struct needle
+{
+  const char* symbol;   /* trigger word                                 */
+  uint32_t    symlen;   /* length of above, excluding null-termination  */
+  uint32_t    checks;   /* CHK_BIT()-mask of checkers it can trigger    */
+  int         whole;    /* must also end at an identifier boundary?     */
+};
+
+struct group
+{
+  vec_t    c0;          /* first byte, splatted                         */
+  vec_t    c1;          /* second byte, splatted                        */
+  uint8_t  b0;
+  uint8_t  b1;
+  int      nbytes;      /* 1 or 2 bytes of prefix to compare            */
+  uint32_t checks;      /* union of the needles' checks                 */
+};
+
+
+/* Keywords that must be whole tokens, and type names that are prefix-matched by the checker. */
+static const struct needle needles[] =
+{
+  { "if",       2, CHK_BIT(CHK_ASSIGN_IN_CTRL_STMT) | CHK_BIT(CHK_SMCLN_AFTER_CTRL_STMT), 1 },
+  { "for",      3, CHK_BIT(CHK_ASSIGN_IN_CTRL_STMT) | CHK_BIT(CHK_SMCLN_AFTER_CTRL_STMT), 1 },
+  { "while",    5, CHK_BIT(CHK_ASSIGN_IN_CTRL_STMT) | CHK_BIT(CHK_SMCLN_AFTER_CTRL_STMT), 1 },
+  { "int8_t",   6, CHK_BIT(CHK_MISLEADING_VAR_NAME),                                      0 },
+  { "int16_t",  7, CHK_BIT(CHK_MISLEADING_VAR_NAME),                                      0 },
+  { "int32_t",  7, CHK_BIT(CHK_MISLEADING_VAR_NAME),                                      0 },
+  { "int64_t",  7, CHK_BIT(CHK_MISLEADING_VAR_NAME),                                      0 },
+  { "uint8_t",  7, CHK_BIT(CHK_MISLEADING_VAR_NAME),                                      0 },
+  { "uint16_t", 8, CHK_BIT(CHK_MISLEADING_VAR_NAME),                                      0 },
+  { "uint32_t", 8, CHK_BIT(CHK_MISLEADING_VAR_NAME),                                      0 },
+  { "uint64_t", 8, CHK_BIT(CHK_MISLEADING_VAR_NAME),                                      0 },
+  { "(",        1, CHK_BIT(CHK_MISSING_VOID),                                             0 },
+};
+static const int nneedles = sizeof(needles)/sizeof(*needles);
+
+static struct group groups[MAXGROUPS];
+static int ngroups = 0;
+
+
+
+static int is_ident_char(char c)
+{
+  return (    (c == '_')
+           || ((c >= 'a') && (c <= 'z'))
+           || ((c >= 'A') && (c <= 'Z'))
+           || ((c >= '0') && (c <= '9')));
+}
+
+
+/* build the group table from needles[] on first use */
+static void prefilter_init(void)
+{
+  int i, j;
+
+  if (ngroups > 0)
+  {
+    return;
+  }
+
+  for (i = 0; i < nneedles; ++i)
+  {
+    uint8_t b0 = (uint8_t)needles[i].symbol[0];
+    uint8_t b1 = (needles[i].symlen > 1) ? (uint8_t)needles[i].symbol[1] : 0;
+    int     nb = (needles[i].symlen > 1) ? 2 : 1;
+
+    for (j = 0; j < ngroups; ++j)
+    {
+      if ((groups[j].b0 == b0) && (groups[j].b1 == b1) && (groups[j].nbytes == nb))
+      {
+        break;
+      }
+    }
+    if (j == ngroups)
+    {
+      groups[j].b0     = b0;
+      groups[j].b1     = b1;
+      groups[j].c0     = vec_splat(b0);
+      groups[j].c1     = vec_splat(b1);
+      groups[j].nbytes = nb;
+      groups[j].checks = 0;
+      ngroups += 1;
+    }
+    groups[j].checks |= needles[i].checks;
+  }
+}
+
+
+/* verify a candidate position for group g - returns the checks of the needle found there, if any */
+static uint32_t verify(const struct group* g, const char* buf, uint32_t len, uint32_t pos)
+{
+  uint32_t checks = 0;
+  int i;
+
+  /* needles are words: must start at an identifier boundary */
+  if (    (g->nbytes == 2)
+       && (pos > 0)
+       && is_ident_char(buf[pos - 1]))
+  {
+    return 0;
+  }
+
+  for (i = 0; i < nneedles; ++i)
+  {
+    const struct needle* n = &needles[i];
+    if (    ((uint8_t)n->symbol[0] == g->b0)
+         && ((n->symlen > 1 ? 2 : 1) == g->nbytes)
+         && ((pos + n->symlen) <= len)
+         && (memcmp(buf + pos, n->symbol, n->symlen) == 0)
+         && (    !n->whole
+              || ((pos + n->symlen) == len)
+              || !is_ident_char(buf[pos + n->symlen])))
+    {
+      checks |= n->checks;
+    }
+  }
+  return checks;
+}
+
+
+uint32_t prefilter_scan(const char* buf, uint32_t len, uint32_t wanted)
+{
+  uint32_t found = 0;
+  uint32_t i = 0;
+  int g;
+
+  prefilter_init();
+
+  /* Vectorized main loop - needs VEC_BYTES readable bytes at offset i + 1 */
+  while (    ((i + VEC_BYTES + 1) <= len)
+          && ((found & wanted) != wanted))
+  {
+    vec_t a = vec_load(buf + i);
+    vec_t b = vec_load(buf + i + 1);
+
+    for (g = 0; g < ngroups; ++g)
+    {
+      if ((groups[g].checks & wanted & ~found) == 0)
+      {
+        continue; /* nothing new to learn from this group */
+      }
+
+      uint32_t m = vec_eq_mask(a, groups[g].c0);
+      if (groups[g].nbytes == 2)
+      {
+        m &= vec_eq_mask(b, groups[g].c1);
+      }
+      while (m != 0)
+      {
+        found |= verify(&groups[g], buf, len, i + (uint32_t)vec_first_bit(m));
+        m &= (m - 1);
+      }
+    }
+    i += VEC_BYTES;
+  }
+
+  /* Scalar tail */
+  for (; (i < len) && ((found & wanted) != wanted); ++i)
+  {
+    for (g = 0; g < ngroups; ++g)
+    {
+      if (    ((uint8_t)buf[i] == groups[g].b0)
+           && (    (groups[g].nbytes == 1)
+                || (    ((i + 1) < len)
+                     && ((uint8_t)buf[i + 1] == groups[g].b1))))
+      {
+        found |= verify(&groups[g], buf, len, i);
+      }
+    }
+  }
+
+  return (found & wanted);
+}
+
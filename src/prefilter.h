@@ -0,0 +1,24 @@
+#ifndef __PREFILTER_H__
+#define __PREFILTER_H__
+
+/*
+
+Pre-lex prefilter
+
+  Scans the raw bytes of a file for the tokens that each checker needs in order to fire,
+  e.g. 'if', 'for' or 'while' for the control-statement checks.
+  Returns a CHK_BIT()-mask of checkers that can possibly produce a warning for the file.
+  The scan is conservative: matches inside comments and strings count as hits.
+
+*/
+
+#include <stdint.h>
+
+
+
+uint32_t prefilter_scan(const char* buf, uint32_t len, uint32_t wanted);
+
+
+
+#endif /* __PREFILTER_H__ */
+
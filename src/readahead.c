@@ -0,0 +1,135 @@
+/*
+
+Background readahead
+
+  The thread keeps [claimed, claimed + window) of the scheduled files read ahead. Once
+  the analysis has used up half of that, the next batch is taken, sorted by (device,
+  inode) and advised in that order - batches instead of single files, so the sort has
+  something to work with and the thread mostly sleeps.
+
+*/
+
+#include "readahead.h"
+#include "sched.h"
+#include <assert.h>
+#include <fcntl.h>     /* open, posix_fadvise */
+#include <pthread.h>
+#include <stdlib.h>    /* malloc, qsort, free */
+#include <time.h>      /* nanosleep */
+#include <unistd.h>    /* close */
+
+
+#define POLL_NS   1000000   /* how often the analysis' progress is looked at */
+
+
+static uint32_t  window = 0;
+static pthread_t thread;
+static int       running = 0;
+static int       stop = 0;
+static const struct sched_file** batch = 0;
+
+
+
+void readahead_set_window(uint32_t nfiles)
+{
+  window = nfiles;
+}
+
+int readahead_enabled(void)
+{
+  return (window > 0);
+}
+
+
+static int disk_order_cmp(const void* a, const void* b)
+{
+  const struct sched_file* fa = *(const struct sched_file* const*)a;
+  const struct sched_file* fb = *(const struct sched_file* const*)b;
+  if (fa->dev != fb->dev)
+  {
+    return (fa->dev < fb->dev) ? -1 : 1;
+  }
+  if (fa->ino != fb->ino)
+  {
+    return (fa->ino < fb->ino) ? -1 : 1;
+  }
+  return 0;
+}
+
+
+static void advise(const struct sched_file* f)
+{
+  int fd = open(f->path, O_RDONLY | O_CLOEXEC);
+  if (fd >= 0)
+  {
+    posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);  /* starts the reads, does not wait for them */
+    close(fd);
+  }
+}
+
+
+static void* readahead_main(void* arg)
+{
+  const struct timespec poll = { 0, POLL_NS };
+  uint32_t next = 0;   /* next scheduled file not advised yet */
+
+  (void) arg;
+
+  while (    !__atomic_load_n(&stop, __ATOMIC_RELAXED)
+          && (sched_planned(next) != 0))
+  {
+    uint32_t claimed = sched_claimed();
+    uint32_t n = 0;
+    uint32_t i;
+
+    if (next < claimed)
+    {
+      next = claimed;   /* fell behind: those are being read already */
+    }
+    if ((next - claimed) > (window / 2))
+    {
+      nanosleep(&poll, 0);
+      continue;
+    }
+
+    for (; (next < (claimed + window)) && (sched_planned(next) != 0); ++next)
+    {
+      batch[n++] = sched_planned(next);
+    }
+    qsort(batch, n, sizeof(*batch), disk_order_cmp);
+    for (i = 0; i < n; ++i)
+    {
+      advise(batch[i]);
+    }
+  }
+  return 0;
+}
+
+
+/* Start the thread - after sched_plan() */
+int readahead_start(void)
+{
+  if (window == 0)
+  {
+    return 1;
+  }
+  batch = malloc(window * sizeof(*batch));
+  assert(batch != 0);
+  stop = 0;
+  running = (pthread_create(&thread, 0, readahead_main, 0) == 0);
+  return running;
+}
+
+
+void readahead_stop(void)
+{
+  if (running)
+  {
+    __atomic_store_n(&stop, 1, __ATOMIC_RELAXED);
+    pthread_join(thread, 0);
+    running = 0;
+  }
+  free(batch);
+  batch = 0;
+}
+
@@ -0,0 +1,32 @@
+#ifndef __READAHEAD_H__
+#define __READAHEAD_H__
+
+/*
+
+Background readahead
+
+  On a cold page cache, reading the files one after another in list order is random I/O.
+  A background thread stays up to <window> files ahead of the files handed out by the
+  scheduler: it takes the next files, sorts them by device and inode - close to their
+  order on disk - and asks the kernel to read them in with posix_fadvise(WILLNEED).
+  By the time a file is analyzed, its contents are usually in the page cache.
+
+  Only I/O is reordered: files are still analyzed and reported in the scheduled order.
+  The thread follows the scheduler's shared claim counter, so it also works ahead of
+  forked workers.
+
+*/
+
+#include <stdint.h>
+
+
+
+void readahead_set_window(uint32_t nfiles);
+int  readahead_enabled(void);
+int  readahead_start(void);
+void readahead_stop(void);
+
+
+
+#endif /* __READAHEAD_H__ */
+
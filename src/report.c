@@ -0,0 +1,458 @@
+/*
+
+Reporting of findings
+
+*/
+
+#include "report.h"
+#include "analysis.h"
+#include "diff.h"
+#include "baseline.h"
+#include <assert.h>
+#include <stdarg.h>   /* va_list */
+#include <stdio.h>    /* fprintf, vsnprintf */
+#include <stdlib.h>   /* malloc, qsort */
+#include <string.h>   /* strcmp, strchr */
+
+
+#define RESULTS_HEADER   "tlint-results 1"
+#define MAXMSGLEN        4096
+
+
+/* finding held back until the file is done - to be reported in line order, and fingerprinted with a baseline */
+struct held_finding
+{
+  int      check_id;
+  uint32_t lineno;
+  uint32_t msg_offset;    /* into held_msgs */
+  uint64_t fingerprint;   /* without occurrence number */
+  uint32_t seq;           /* order in which it is reported */
+  uint32_t occurrence;    /* number of earlier findings of the file with the same fingerprint */
+};
+
+/* one finding read back from a result file */
+struct record
+{
+  uint32_t file_idx;
+  uint32_t seq;
+  char*    check_name;
+  char*    message;
+};
+
+
+static const char* check_names[NCHECKS] =
+{
+  "assign_in_ctrl_stmt",
+  "missing_void",
+  "misleading_var_name",
+  "smcln_after_ctrl_stmt",
+  "project_decls",
+  "clones",
+};
+
+static FILE*    results = 0;     /* result file, or 0 to print findings */
+static report_sink_fn sink = 0;  /* receives findings instead, e.g. to keep them in memory */
+static uint32_t cur_file_idx = 0;
+static uint32_t cur_seq = 0;
+
+static struct held_finding* held = 0;       /* findings of the current file */
+static uint32_t nheld = 0;
+static uint32_t maxheld = 0;
+static char*    held_msgs = 0;
+static uint32_t held_msgs_len = 0;
+static uint32_t held_msgs_cap = 0;
+
+
+
+const char* report_check_name(int check_id)
+{
+  return ((check_id >= 0) && (check_id < NCHECKS)) ? check_names[check_id] : "unknown";
+}
+
+
+int report_open_results(const char* results_path)
+{
+  results = fopen(results_path, "wb");
+  if (results == 0)
+  {
+    return 0;
+  }
+  fprintf(results, "%s\n", RESULTS_HEADER);
+  return 1;
+}
+
+int report_close_results(void)
+{
+  int success = 1;
+  if (results != 0)
+  {
+    success = (fclose(results) == 0);
+    results = 0;
+  }
+  return success;
+}
+
+
+void report_set_sink(report_sink_fn fn)
+{
+  sink = fn;
+}
+
+
+void report_free(void)
+{
+  free(held);
+  free(held_msgs);
+  held = 0;
+  held_msgs = 0;
+  nheld = 0;
+  maxheld = 0;
+  held_msgs_len = 0;
+  held_msgs_cap = 0;
+}
+
+
+/* called for each file in the input list - file_idx is its position in the list */
+void report_begin_file(uint32_t file_idx, const char* file_path)
+{
+  cur_file_idx = file_idx;
+  cur_seq = 0;
+  if (results != 0)
+  {
+    fprintf(results, "F\t%u\t%s\n", file_idx, file_path);
+  }
+}
+
+
+static void emit(int check_id, const char* file_path, uint32_t lineno, const char* msg)
+{
+  if (sink != 0)
+  {
+    char line[MAXMSGLEN + 1024];
+    snprintf(line, sizeof(line), "[%s:%u] (warning) %s", file_path, lineno, msg);
+    sink(check_id, line);
+  }
+  else if (results != 0)
+  {
+    fprintf(results, "W\t%u\t%u\t%s\t[%s:%u] (warning) %s\n", cur_file_idx, cur_seq, report_check_name(check_id), file_path, lineno, msg);
+  }
+  else
+  {
+    fprintf(stdout, "[%s:%u] (warning) %s\n", file_path, lineno, msg);
+  }
+  cur_seq += 1;
+}
+
+
+static void hold(int check_id, uint32_t lineno, const char* msg)
+{
+  uint32_t len = (uint32_t)strlen(msg) + 1;
+
+  if (nheld == maxheld)
+  {
+    maxheld = (maxheld == 0) ? 64 : (2 * maxheld);
+    held = realloc(held, maxheld * sizeof(*held));
+    assert(held != 0);
+  }
+  if ((held_msgs_len + len) > held_msgs_cap)
+  {
+    held_msgs_cap = (held_msgs_len + len) * 2;
+    held_msgs = realloc(held_msgs, held_msgs_cap);
+    assert(held_msgs != 0);
+  }
+  memcpy(&held_msgs[held_msgs_len], msg, len);
+
+  held[nheld].check_id   = check_id;
+  held[nheld].lineno     = lineno;
+  held[nheld].msg_offset = held_msgs_len;
+  nheld += 1;
+  held_msgs_len += len;
+}
+
+
+void report_warning(const struct source_file* s, int check_id, uint32_t lineno, const char* fmt, ...)
+{
+  char msg[MAXMSGLEN];
+  va_list args;
+
+  /* in diff-aware mode, only lines added by the change are of interest */
+  if (    diff_enabled()
+       && !diff_line_changed(s->file_path, lineno))
+  {
+    return;
+  }
+
+  va_start(args, fmt);
+  vsnprintf(msg, sizeof(msg), fmt, args);
+  va_end(args);
+
+  hold(check_id, lineno, msg);
+}
+
+
+/* by line - checkers that see the tokens one by one, or the whole file at once, report in the same order */
+static int held_line_cmp(const void* a, const void* b)
+{
+  const struct held_finding* ha = (const struct held_finding*)a;
+  const struct held_finding* hb = (const struct held_finding*)b;
+
+  if (ha->lineno   != hb->lineno)   { return (ha->lineno   < hb->lineno)   ? -1 : 1; }
+  if (ha->check_id != hb->check_id) { return (ha->check_id < hb->check_id) ? -1 : 1; }
+  return (ha->seq < hb->seq) ? -1 : (ha->seq > hb->seq);
+}
+
+/* by fingerprint, equal ones in the order they are reported */
+static int held_fingerprint_cmp(const void* a, const void* b)
+{
+  const struct held_finding* ha = (const struct held_finding*)a;
+  const struct held_finding* hb = (const struct held_finding*)b;
+
+  if (ha->fingerprint != hb->fingerprint) { return (ha->fingerprint < hb->fingerprint) ? -1 : 1; }
+  return (ha->seq < hb->seq) ? -1 : (ha->seq > hb->seq);
+}
+
+static int held_seq_cmp(const void* a, const void* b)
+{
+  const struct held_finding* ha = (const struct held_finding*)a;
+  const struct held_finding* hb = (const struct held_finding*)b;
+
+  return (ha->seq < hb->seq) ? -1 : (ha->seq > hb->seq);
+}
+
+
+/* Report the held findings of a file sorted by line - with a baseline, fingerprint them now that
+   all tokens are known, and report only those not in the baseline */
+void report_end_file(const struct source_file* s, const struct token* toks, uint32_t ntoks)
+{
+  uint32_t i;
+
+  /* in the order they were found, within a line and checker */
+  for (i = 0; i < nheld; ++i)
+  {
+    held[i].seq = i;
+  }
+  qsort(held, nheld, sizeof(*held), held_line_cmp);
+  for (i = 0; i < nheld; ++i)
+  {
+    held[i].seq = i;
+  }
+
+  if (baseline_active())
+  {
+    for (i = 0; i < nheld; ++i)
+    {
+      held[i].fingerprint = baseline_fingerprint(held[i].check_id, s->file_path, held[i].lineno, toks, ntoks, 0);
+    }
+
+    /* number repeated fingerprints: sorted, equal ones are neighbours */
+    qsort(held, nheld, sizeof(*held), held_fingerprint_cmp);
+    for (i = 0; i < nheld; ++i)
+    {
+      held[i].occurrence = (    (i > 0)
+                             && (held[i-1].fingerprint == held[i].fingerprint)) ? (held[i-1].occurrence + 1) : 0;
+    }
+    qsort(held, nheld, sizeof(*held), held_seq_cmp);
+  }
+
+  for (i = 0; i < nheld; ++i)
+  {
+    if (baseline_active())
+    {
+      uint64_t fingerprint = (held[i].occurrence == 0) ? held[i].fingerprint
+                           : baseline_fingerprint(held[i].check_id, s->file_path, held[i].lineno, toks, ntoks, held[i].occurrence);
+
+      baseline_record(fingerprint, report_check_name(held[i].check_id), s->file_path);
+      if (baseline_known(fingerprint))
+      {
+        continue;
+      }
+    }
+    emit(held[i].check_id, s->file_path, held[i].lineno, &held_msgs[held[i].msg_offset]);
+  }
+
+  nheld = 0;
+  held_msgs_len = 0;
+}
+
+
+
+/* A file was abandoned or truncated - 'lineno' is where analysis stopped, 0 if it never started */
+void report_skipped(const struct source_file* s, const char* reason, uint32_t lineno, uint32_t ntoks, uint32_t elapsed_ms)
+{
+  fprintf(stderr, "[%s] (skipped) reason=%s line=%u tokens=%u ms=%u\n", s->file_path, reason, lineno, ntoks, elapsed_ms);
+}
+
+
+
+/* ================================================== */
+/* Merging of result files:                            */
+/* ================================================== */
+
+static int record_cmp(const void* a, const void* b)
+{
+  const struct record* ra = (const struct record*)a;
+  const struct record* rb = (const struct record*)b;
+
+  if (ra->file_idx != rb->file_idx) { return (ra->file_idx < rb->file_idx) ? -1 : 1; }
+  if (ra->seq      != rb->seq)      { return (ra->seq      < rb->seq)      ? -1 : 1; }
+  return strcmp(ra->message, rb->message);
+}
+
+static char* dup_str(const char* str)
+{
+  size_t len = strlen(str) + 1;
+  char* copy = malloc(len);
+  assert(copy != 0);
+  memcpy(copy, str, len);
+  return copy;
+}
+
+/* split off the next tab-separated field of *line */
+static char* next_field(char** line)
+{
+  char* field = *line;
+  char* tab = (field != 0) ? strchr(field, '\t') : 0;
+  if (tab != 0)
+  {
+    *tab = 0;
+    *line = tab + 1;
+  }
+  else
+  {
+    *line = 0;
+  }
+  return field;
+}
+
+
+/* copy the records of another result file (e.g. a worker's) into the open result file */
+int report_append_results(const char* results_path)
+{
+  char line[MAXMSGLEN + 256];
+  FILE* f = fopen(results_path, "rb");
+  if (    (f == 0)
+       || (results == 0)
+       || (fgets(line, sizeof(line), f) == 0)
+       || (strncmp(line, RESULTS_HEADER, strlen(RESULTS_HEADER)) != 0))
+  {
+    if (f != 0)
+    {
+      fclose(f);
+    }
+    return 0;
+  }
+  while (fgets(line, sizeof(line), f) != 0)
+  {
+    fputs(line, results);
+  }
+  fclose(f);
+  return 1;
+}
+
+
+/* Read result files and print all findings in input-list order, optionally followed by global counts */
+int report_merge(int nresults, char* results_paths[], int print_counts)
+{
+  struct record* recs = 0;
+  uint32_t nrecs = 0;
+  uint32_t maxrecs = 0;
+  uint32_t nfiles = 0;
+  uint32_t counts[NCHECKS + 1];
+  char line[MAXMSGLEN + 256];
+  int success = 1;
+  int i;
+  uint32_t j;
+
+  memset(counts, 0, sizeof(counts));
+
+  for (i = 0; i < nresults; ++i)
+  {
+    FILE* f = fopen(results_paths[i], "rb");
+    if (    (f == 0)
+         || (fgets(line, sizeof(line), f) == 0)
+         || (strncmp(line, RESULTS_HEADER, strlen(RESULTS_HEADER)) != 0))
+    {
+      fprintf(stderr, "ERROR: '%s' is not a tlint result file\n", results_paths[i]);
+      if (f != 0)
+      {
+        fclose(f);
+      }
+      success = 0;
+      continue;
+    }
+
+    while (fgets(line, sizeof(line), f) != 0)
+    {
+      char* p = line;
+      char* nl = strchr(line, '\n');
+      if (nl != 0)
+      {
+        *nl = 0;
+      }
+
+      char* kind = next_field(&p);
+      if (strcmp(kind, "F") == 0)
+      {
+        nfiles += 1;
+      }
+      else if ((strcmp(kind, "W") == 0) && (p != 0))
+      {
+        char* file_idx   = next_field(&p);
+        char* seq        = next_field(&p);
+        char* check_name = next_field(&p);
+        char* message    = p;
+        if ((seq == 0) || (check_name == 0) || (message == 0))
+        {
+          continue;
+        }
+
+        if (nrecs == maxrecs)
+        {
+          maxrecs = (maxrecs == 0) ? 1024 : (2 * maxrecs);
+          recs = realloc(recs, maxrecs * sizeof(*recs));
+          assert(recs != 0);
+        }
+        recs[nrecs].file_idx   = (uint32_t)strtoul(file_idx, 0, 10);
+        recs[nrecs].seq        = (uint32_t)strtoul(seq, 0, 10);
+        recs[nrecs].check_name = dup_str(check_name);
+        recs[nrecs].message    = dup_str(message);
+        nrecs += 1;
+      }
+    }
+    fclose(f);
+  }
+
+  qsort(recs, nrecs, sizeof(*recs), record_cmp);
+
+  for (j = 0; j < nrecs; ++j)
+  {
+    int id;
+    fprintf(stdout, "%s\n", recs[j].message);
+    for (id = 0; (id < NCHECKS) && (strcmp(recs[j].check_name, check_names[id]) != 0); ++id)
+    {
+      /* find check id by name */
+    }
+    counts[id] += 1;
+    free(recs[j].check_name);
+    free(recs[j].message);
+  }
+  free(recs);
+
+  if (!print_counts)
+  {
+    return success;
+  }
+
+  fprintf(stdout, "# %u warnings in %u files\n", nrecs, nfiles);
+  for (i = 0; i < NCHECKS; ++i)
+  {
+    fprintf(stdout, "# %-24s %u\n", check_names[i], counts[i]);
+  }
+  if (counts[NCHECKS] > 0)
+  {
+    fprintf(stdout, "# %-24s %u\n", "unknown", counts[NCHECKS]);
+  }
+
+  return success;
+}
+
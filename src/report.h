@@ -0,0 +1,54 @@
+#ifndef __REPORT_H__
+#define __REPORT_H__
+
+/*
+
+Reporting of findings
+
+  Checkers hand their findings to report_warning(), which prints them - or, when a result
+  file is open, records them there together with the position of the file in the input
+  list and a sequence number. Result files from several runs (e.g. shards) can then be
+  merged into one report, in the same order a single sequential run would have printed.
+
+  Instead, a sink function can be installed that receives every formatted finding.
+  Findings are held until report_end_file() and reported sorted by line, so the order does not
+  depend on how the checkers walk the tokens (e.g. --vector-match). With a baseline, only new
+  ones are reported.
+
+  Files that are skipped or truncated, e.g. binary files or files over a budget, are noted
+  on stderr, one line each, so they can be told apart from clean files:
+
+    [<path>] (skipped) reason=<reason> line=<lineno> tokens=<n> ms=<elapsed>
+
+  Result file format - text, one record per line, fields separated by tabs:
+
+    tlint-results 1
+    F  <file-index>  <path>                              file was analyzed
+    W  <file-index>  <seq>  <check-name>  <message>      finding
+
+*/
+
+#include "source.h"
+#include <stdint.h>
+
+
+typedef void (*report_sink_fn)(int check_id, const char* message);
+
+
+
+void report_set_sink(report_sink_fn fn);
+void report_begin_file(uint32_t file_idx, const char* file_path);
+void report_warning(const struct source_file* s, int check_id, uint32_t lineno, const char* fmt, ...);
+void report_end_file(const struct source_file* s, const struct token* toks, uint32_t ntoks);
+void report_skipped(const struct source_file* s, const char* reason, uint32_t lineno, uint32_t ntoks, uint32_t elapsed_ms);
+int  report_open_results(const char* results_path);
+int  report_close_results(void);
+int  report_append_results(const char* results_path);
+int  report_merge(int nresults, char* results_paths[], int print_counts);
+const char* report_check_name(int check_id);
+void report_free(void);
+
+
+
+#endif /* __REPORT_H__ */
+
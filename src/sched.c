@@ -0,0 +1,443 @@
+/*
+
+Cost-aware file scheduling
+
+  - files[]:  all entries of the file-list; the paths point into the list buffer (or the diff).
+  - order[]:  indices of the selected files, in the order they are handed out.
+  - timings:  open-addressing hash table path -> microseconds, loaded from and saved to the
+              sidecar file. Entries for files not analyzed in this run (e.g. other shards)
+              are kept, so several runs can share one sidecar file one after another.
+  - shared:   claim counter and measured times, in memory shared with forked workers.
+
+*/
+
+#include "sched.h"
+#include "hash.h"
+#include <assert.h>
+#include <stdio.h>     /* fopen, fread, rename */
+#include <stdlib.h>    /* malloc, free, qsort */
+#include <string.h>    /* memcpy, strlen */
+#include <sys/mman.h>  /* mmap */
+#include <sys/stat.h>  /* stat */
+#include <sys/wait.h>  /* waitpid */
+#include <time.h>      /* clock_gettime */
+#include <unistd.h>    /* fork */
+
+
+#define DEFAULT_BYTES_PER_US   64   /* cost estimate for sizes, when no timings are known at all */
+
+
+struct timing
+{
+  char*    path;        /* 0 for an empty slot */
+  uint64_t hash;
+  uint64_t us;
+};
+
+struct shared
+{
+  uint32_t next;        /* next position in order[] to hand out */
+  uint64_t elapsed[];   /* measured time per file, in us - 0 when not analyzed */
+};
+
+
+static char*              list_buf = 0;
+static struct sched_file* files = 0;
+static uint32_t           nfiles = 0;
+static uint32_t           maxfiles = 0;
+static uint32_t*          order = 0;
+static uint32_t           norder = 0;
+
+static struct timing*     timings = 0;
+static uint32_t           timings_size = 0;   /* number of slots - power of 2 */
+static uint32_t           timings_count = 0;
+
+static struct shared*     shared = 0;
+static size_t             shared_size = 0;
+
+
+
+/* Read the whole file-list - one path per line, empty lines are skipped */
+int sched_load_list(const char* list_path)
+{
+  FILE* f = fopen(list_path, "rb");
+  if (f == 0)
+  {
+    return 0;
+  }
+
+  long len = 0;
+  if (    (fseek(f, 0, SEEK_END) != 0)
+       || ((len = ftell(f)) < 0)
+       || (fseek(f, 0, SEEK_SET) != 0))
+  {
+    fclose(f);
+    return 0;
+  }
+
+  list_buf = malloc((size_t)len + 1);
+  assert(list_buf != 0);
+  size_t nread = fread(list_buf, 1, (size_t)len, f);
+  fclose(f);
+  list_buf[nread] = 0;
+
+  char* p = list_buf;
+  while (*p != 0)
+  {
+    char* line = p;
+    while ((*p != '\n') && (*p != 0))
+    {
+      p += 1;
+    }
+    if (*p == '\n')
+    {
+      *p++ = 0;
+    }
+    if (line[0] != 0)
+    {
+      sched_add_file(line);
+    }
+  }
+
+  return 1;
+}
+
+
+/* append a file to the list - 'path' must stay valid until sched_free() */
+void sched_add_file(const char* path)
+{
+  if (nfiles == maxfiles)
+  {
+    maxfiles = (maxfiles == 0) ? 256 : (2 * maxfiles);
+    files = realloc(files, maxfiles * sizeof(*files));
+    assert(files != 0);
+  }
+  memset(&files[nfiles], 0, sizeof(*files));
+  files[nfiles].path     = path;
+  files[nfiles].list_idx = nfiles;
+  files[nfiles].selected = 1;
+  nfiles += 1;
+}
+
+
+uint32_t sched_nfiles(void)
+{
+  return nfiles;
+}
+
+struct sched_file* sched_file(uint32_t i)
+{
+  return (i < nfiles) ? &files[i] : 0;
+}
+
+
+
+/* ================================================== */
+/* Timings sidecar file:                              */
+/* ================================================== */
+
+static struct timing* timing_slot(const char* path, uint64_t h)
+{
+  uint32_t i = (uint32_t)hash_mix64(h) & (timings_size - 1);
+  while (    (timings[i].path != 0)
+          && (    (timings[i].hash != h)
+               || (strcmp(timings[i].path, path) != 0)))
+  {
+    i = (i + 1) & (timings_size - 1);
+  }
+  return &timings[i];
+}
+
+static void timing_set(const char* path, uint64_t us)
+{
+  uint32_t i;
+
+  if ((timings_count * 2) >= timings_size)
+  {
+    struct timing* old = timings;
+    uint32_t old_size = timings_size;
+
+    timings_size = (old_size == 0) ? 256 : (2 * old_size);
+    timings = calloc(timings_size, sizeof(*timings));
+    assert(timings != 0);
+    for (i = 0; i < old_size; ++i)
+    {
+      if (old[i].path != 0)
+      {
+        *timing_slot(old[i].path, old[i].hash) = old[i];
+      }
+    }
+    free(old);
+  }
+
+  uint64_t h = hash_fnv1a64(path, strlen(path), HASH_FNV1A64_INIT);
+  struct timing* t = timing_slot(path, h);
+  if (t->path == 0)
+  {
+    size_t len = strlen(path) + 1;
+    t->path = malloc(len);
+    assert(t->path != 0);
+    memcpy(t->path, path, len);
+    t->hash = h;
+    timings_count += 1;
+  }
+  t->us = us;
+}
+
+static uint64_t timing_get(const char* path)
+{
+  if (timings_count == 0)
+  {
+    return 0;
+  }
+  return timing_slot(path, hash_fnv1a64(path, strlen(path), HASH_FNV1A64_INIT))->us;
+}
+
+
+/* a missing sidecar file is not an error - there simply is no history yet */
+int sched_load_timings(const char* timings_path)
+{
+  char line[4096];
+  FILE* f = fopen(timings_path, "r");
+  if (f == 0)
+  {
+    return 0;
+  }
+
+  while (fgets(line, sizeof(line), f) != 0)
+  {
+    char* nl = strchr(line, '\n');
+    char* path = 0;
+    uint64_t us = strtoull(line, &path, 10);
+    if (nl != 0)
+    {
+      *nl = 0;
+    }
+    if (    (path != line)
+         && (*path == ' ')
+         && (path[1] != 0))
+    {
+      timing_set(path + 1, us);
+    }
+  }
+  fclose(f);
+
+  return 1;
+}
+
+
+/* merge this run's measurements into the sidecar file - written to a temporary file and renamed */
+int sched_save_timings(const char* timings_path)
+{
+  char tmp_path[4096];
+  uint32_t i;
+
+  for (i = 0; (i < nfiles) && (shared != 0); ++i)
+  {
+    if (shared->elapsed[i] != 0)
+    {
+      timing_set(files[i].path, shared->elapsed[i]);
+    }
+  }
+
+  snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", timings_path);
+  FILE* f = fopen(tmp_path, "w");
+  if (f == 0)
+  {
+    return 0;
+  }
+  for (i = 0; i < timings_size; ++i)
+  {
+    if (timings[i].path != 0)
+    {
+      fprintf(f, "%llu %s\n", (unsigned long long)timings[i].us, timings[i].path);
+    }
+  }
+  if (fclose(f) != 0)
+  {
+    remove(tmp_path);
+    return 0;
+  }
+  return (rename(tmp_path, timings_path) == 0);
+}
+
+
+
+/* ================================================== */
+/* Planning and handing out files:                    */
+/* ================================================== */
+
+static int cost_cmp(const void* a, const void* b)
+{
+  const struct sched_file* fa = &files[*(const uint32_t*)a];
+  const struct sched_file* fb = &files[*(const uint32_t*)b];
+
+  if (fa->cost != fb->cost) { return (fa->cost > fb->cost) ? -1 : 1; }
+  return (fa->list_idx < fb->list_idx) ? -1 : 1;
+}
+
+
+/* estimate costs of the selected files and fix the order they are handed out in - returns their number */
+uint32_t sched_plan(int longest_first)
+{
+  uint64_t known_us = 0;
+  uint64_t known_bytes = 0;
+  uint32_t i;
+
+  order = malloc((nfiles + 1) * sizeof(*order));
+  assert(order != 0);
+  norder = 0;
+
+  for (i = 0; i < nfiles; ++i)
+  {
+    struct stat st;
+    if (!files[i].selected)
+    {
+      continue;
+    }
+    memset(&st, 0, sizeof(st));
+    stat(files[i].path, &st);
+    files[i].size = (uint64_t)st.st_size;
+    files[i].dev  = (uint64_t)st.st_dev;
+    files[i].ino  = (uint64_t)st.st_ino;
+    files[i].cost = timing_get(files[i].path);
+    if (files[i].cost != 0)
+    {
+      known_us += files[i].cost;
+      known_bytes += files[i].size;
+    }
+    order[norder++] = i;
+  }
+
+  /* files without history: size times the observed time-per-byte of this code base */
+  for (i = 0; i < norder; ++i)
+  {
+    struct sched_file* f = &files[order[i]];
+    if (f->cost == 0)
+    {
+      f->cost = ((known_us > 0) && (known_bytes > 0)) ? ((f->size * known_us) / known_bytes)
+                                                      : (f->size / DEFAULT_BYTES_PER_US);
+      f->cost += 1;
+    }
+  }
+
+  if (longest_first)
+  {
+    qsort(order, norder, sizeof(*order), cost_cmp);
+  }
+
+  shared_size = sizeof(*shared) + (nfiles * sizeof(uint64_t));
+  shared = mmap(0, shared_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  assert(shared != MAP_FAILED);
+  shared->next = 0;
+
+  return norder;
+}
+
+
+/* next file to analyze, or 0 when all are taken - safe to call from several worker processes */
+const struct sched_file* sched_claim(void)
+{
+  uint32_t k = __atomic_fetch_add(&shared->next, 1, __ATOMIC_RELAXED);
+  return (k < norder) ? &files[order[k]] : 0;
+}
+
+/* number of files handed out so far, by all workers - may exceed the number planned */
+uint32_t sched_claimed(void)
+{
+  return __atomic_load_n(&shared->next, __ATOMIC_RELAXED);
+}
+
+/* the k-th file to be handed out, or 0 past the end */
+const struct sched_file* sched_planned(uint32_t k)
+{
+  return (k < norder) ? &files[order[k]] : 0;
+}
+
+
+void sched_record(const struct sched_file* f, uint64_t elapsed_us)
+{
+  shared->elapsed[f - files] = (elapsed_us > 0) ? elapsed_us : 1; /* 0 means 'not analyzed' */
+}
+
+
+uint64_t sched_now_us(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ((uint64_t)ts.tv_sec * 1000000u) + ((uint64_t)ts.tv_nsec / 1000u);
+}
+
+
+/* run worker(0 .. njobs-1) in forked processes and wait for all - in-process for a single job */
+int sched_run_workers(uint32_t njobs, void (*worker)(uint32_t worker_idx))
+{
+  int success = 1;
+  uint32_t w;
+
+  if (njobs <= 1)
+  {
+    worker(0);
+    return 1;
+  }
+
+  fflush(0); /* do not let children flush the parent's buffered output again */
+
+  for (w = 0; w < njobs; ++w)
+  {
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+      worker(w);
+      fflush(0);
+      _exit(0);
+    }
+    if (pid < 0)
+    {
+      fprintf(stderr, "ERROR: cannot start worker %u\n", w);
+      success = 0;
+      break;
+    }
+  }
+
+  int status;
+  while (wait(&status) > 0)
+  {
+    if (    !WIFEXITED(status)
+         || (WEXITSTATUS(status) != 0))
+    {
+      success = 0;
+    }
+  }
+  return success;
+}
+
+
+void sched_free(void)
+{
+  uint32_t i;
+
+  for (i = 0; i < timings_size; ++i)
+  {
+    free(timings[i].path);
+  }
+  free(timings);
+  free(order);
+  free(files);
+  free(list_buf);
+  if (shared != 0)
+  {
+    munmap(shared, shared_size);
+  }
+  timings = 0;
+  timings_size = 0;
+  timings_count = 0;
+  order = 0;
+  norder = 0;
+  files = 0;
+  nfiles = 0;
+  maxfiles = 0;
+  list_buf = 0;
+  shared = 0;
+}
+
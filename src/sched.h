@@ -0,0 +1,59 @@
+#ifndef __SCHED_H__
+#define __SCHED_H__
+
+/*
+
+Cost-aware file scheduling
+
+  The file-list is read once into memory. Each selected file gets a cost estimate:
+
+    - the time it took in an earlier run, from the timings sidecar file, or else
+    - its size, scaled by the time-per-byte observed for the files that do have timings.
+
+  Files are handed out by sched_claim(). With several workers they are ordered longest-
+  processing-time-first, so a big file is not started last while the other workers idle.
+  Workers are forked processes sharing the claim counter and the measured times through
+  an anonymous shared mapping.
+
+  Timings sidecar format - text, one file per line:
+
+    <microseconds> <path>
+
+*/
+
+#include <stdint.h>
+
+
+
+struct sched_file
+{
+  const char* path;        /* as given in the file-list            */
+  uint32_t    list_idx;    /* position in the file-list            */
+  uint64_t    size;        /* bytes, from stat()                   */
+  uint64_t    dev;         /* device and inode, from stat() - for  */
+  uint64_t    ino;         /* reading files in on-disk order       */
+  uint64_t    cost;        /* estimated processing time, in us     */
+  int         selected;    /* to be analyzed in this run           */
+};
+
+
+
+int       sched_load_list(const char* list_path);
+void      sched_add_file(const char* path);
+uint32_t  sched_nfiles(void);
+struct sched_file* sched_file(uint32_t i);
+int       sched_load_timings(const char* timings_path);
+int       sched_save_timings(const char* timings_path);
+uint32_t  sched_plan(int longest_first);
+const struct sched_file* sched_claim(void);
+uint32_t  sched_claimed(void);
+const struct sched_file* sched_planned(uint32_t k);
+void      sched_record(const struct sched_file* f, uint64_t elapsed_us);
+uint64_t  sched_now_us(void);
+int       sched_run_workers(uint32_t njobs, void (*worker)(uint32_t worker_idx));
+void      sched_free(void);
+
+
+
+#endif /* __SCHED_H__ */
+
@@ -0,0 +1,84 @@
+#ifndef __SIMD_H__
+#define __SIMD_H__
+
+/*
+
+Minimal portability layer for byte-wise SIMD compares
+
+  vec_t holds VEC_BYTES bytes. vec_eq_mask() compares two vectors byte by byte
+  and returns a bit-mask with bit N set when byte N is equal. Picks AVX2 (32 bytes)
+  or SSE2 (16 bytes) depending on compiler flags, with a plain C fallback.
+
+  NOTE: vec_load() is unaligned - callers must make sure VEC_BYTES bytes are readable.
+
+*/
+
+#include <stdint.h>
+
+
+#if defined(__AVX2__)
+
+  #include <immintrin.h>
+
+  #define VEC_BYTES 32
+  typedef __m256i vec_t;
+
+  static inline vec_t    vec_load(const void* p)        { return _mm256_loadu_si256((const __m256i*)p); }
+  static inline vec_t    vec_splat(uint8_t c)           { return _mm256_set1_epi8((char)c); }
+  static inline uint32_t vec_eq_mask(vec_t a, vec_t b)  { return (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(a, b)); }
+
+#elif defined(__SSE2__)
+
+  #include <emmintrin.h>
+
+  #define VEC_BYTES 16
+  typedef __m128i vec_t;
+
+  static inline vec_t    vec_load(const void* p)        { return _mm_loadu_si128((const __m128i*)p); }
+  static inline vec_t    vec_splat(uint8_t c)           { return _mm_set1_epi8((char)c); }
+  static inline uint32_t vec_eq_mask(vec_t a, vec_t b)  { return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(a, b)); }
+
+#else
+
+  #include <string.h>
+
+  #define VEC_BYTES 16
+  typedef struct { uint8_t b[VEC_BYTES]; } vec_t;
+
+  static inline vec_t vec_load(const void* p)
+  {
+    vec_t v;
+    memcpy(v.b, p, VEC_BYTES);
+    return v;
+  }
+
+  static inline vec_t vec_splat(uint8_t c)
+  {
+    vec_t v;
+    memset(v.b, c, VEC_BYTES);
+    return v;
+  }
+
+  static inline uint32_t vec_eq_mask(vec_t a, vec_t b)
+  {
+    uint32_t m = 0;
+    int i;
+    for (i = 0; i < VEC_BYTES; ++i)
+    {
+      m |= (uint32_t)(a.b[i] == b.b[i]) << i;
+    }
+    return m;
+  }
+
+#endif
+
+
+/* index of lowest set bit in a non-zero mask */
+static inline int vec_first_bit(uint32_t m)
+{
+  return __builtin_ctz(m);
+}
+
+
+#endif /* __SIMD_H__ */
+
@@ -1,9 +1,16 @@
 #include "source.h"
+#include "arena.h"
 #include <assert.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 
+
+static struct arena arena;          /* per-file memory, reset by src_free() */
+static uint32_t     nfiles = 0;
+static uint64_t     nwarm_mallocs = 0; /* heap allocations for a file that would have fit the arena before */
+
+
 static size_t _fsize(const char* file)
 {
   size_t fsize = 0;
@@ -18,36 +25,137 @@ static size_t _fsize(const char* file)
   return fsize;
 }
 
-int src_init(struct source_file* src, const char* file_path)
+/* number of line breaks in 'len' bytes */
+static uint32_t count_lines(const char* content, size_t len)
+{
+  const char* p = content;
+  const char* end = content + len;
+  uint32_t n = 0;
+
+  while ((p = memchr(p, '\n', (size_t)(end - p))) != 0)
+  {
+    n += 1;
+    p += 1;
+  }
+  return n;
+}
+
+
+/* path and a content buffer of 'file_size' bytes (plus padding) from the arena - returns -1, with
+   the path set and no contents, if they are larger than SRC_MAX_FILE_SIZE or the heap is exhausted */
+static int src_init_sized(struct source_file* src, const char* file_path, uint64_t file_size)
 {
   int success = 0;
   if (    (src != 0)
        && (file_path != 0))
   {
+    size_t   capacity = arena_capacity(&arena);
+    uint64_t nmallocs = arena.nmallocs;
+
     src->file_path_len = strlen(file_path) + 1; /* termination byte! */
-    src->file_path = malloc(src->file_path_len);
-    assert(src->file_path != 0);
+    src->file_path = arena_alloc(&arena, src->file_path_len);
     memcpy(src->file_path, file_path, src->file_path_len);
-  //src->file_path = strdup(file_path);
     
     src->file_content = 0;
     src->nlines = 0;
-    src->file_size = _fsize(file_path);
-    if (src->file_size > 0)
+    src->file_size = 0;
+    success = 1;
+    if (file_size > SRC_MAX_FILE_SIZE)
     {
-      src->file_content = malloc(src->file_size + 10);
-      assert(src->file_content != 0);
-      memset(src->file_content, 0, src->file_size + 10);
+      success = -1;
     }
-    success = 1;
+    else if (file_size > 0)
+    {
+      /* only the padding needs clearing - src_read_content() overwrites and terminates the rest */
+      src->file_content = arena_try_alloc(&arena, file_size + SRC_CONTENT_PADDING);
+      if (src->file_content != 0)
+      {
+        src->file_size = (uint32_t)file_size;
+        memset(src->file_content + src->file_size, 0, SRC_CONTENT_PADDING);
+      }
+      else
+      {
+        success = -1;
+      }
+    }
+
+    if (    (arena.nmallocs != nmallocs)
+         && (arena.in_use <= capacity))
+    {
+      nwarm_mallocs += 1;
+    }
+    nfiles += 1;
   }
   return success;
 }
 
 
-int src_read_content(struct source_file* src)
+/* 1 on success, -1 if the file is too large to analyze - see src_init_sized() */
+int src_init(struct source_file* src, const char* file_path)
 {
-  int nbytes_read = 0;
+  return (file_path != 0) ? src_init_sized(src, file_path, _fsize(file_path)) : 0;
+}
+
+
+/* Initialize from 'size' bytes of a stream - read straight into the content buffer, no file is opened.
+   Returns the number of bytes read including null-termination, like src_read_content(), 0 if the
+   stream ended early, or -1 if the contents are too large - they are left unread in the stream then. */
+int64_t src_read_stream(struct source_file* src, const char* file_path, FILE* in, uint64_t size)
+{
+  int init = src_init_sized(src, file_path, size);
+  if (init <= 0)
+  {
+    return init;
+  }
+  if (size == 0)
+  {
+    return 1;
+  }
+  if (fread(src->file_content, 1, size, in) != size)
+  {
+    return 0;
+  }
+  src->file_content[size] = 0;
+  src->nlines = count_lines(src->file_content, size);
+  return (int64_t)size + 1;
+}
+
+
+/* Read past 'size' bytes of a stream - returns 0 if it ended early */
+int src_skip_stream(FILE* in, uint64_t size)
+{
+  char discard[4096];
+  while (size > 0)
+  {
+    size_t n = (size < sizeof(discard)) ? (size_t)size : sizeof(discard);
+    if (fread(discard, 1, n, in) != n)
+    {
+      return 0;
+    }
+    size -= n;
+  }
+  return 1;
+}
+
+
+/* Initialize from contents loaded elsewhere - 'content' holds 'size' bytes followed by SRC_CONTENT_PADDING
+   zero bytes, and must stay valid until src_free(). Returns the number of bytes including null-termination. */
+int64_t src_init_loaded(struct source_file* src, const char* file_path, char* content, uint32_t size)
+{
+  if (src_init_sized(src, file_path, 0) <= 0)
+  {
+    return 0;
+  }
+  src->file_content = content;
+  src->file_size = size;
+  src->nlines = count_lines(content, size);
+  return (int64_t)size + 1;
+}
+
+
+int64_t src_read_content(struct source_file* src)
+{
+  int64_t nbytes_read = 0;
   if (    (src != 0)
        && (src->file_size > 0)
        && (src->file_path !=0))
@@ -55,20 +163,14 @@ int src_read_content(struct source_file* src)
     FILE* fp = fopen(src->file_path, "rb");
     if (fp != 0)
     {
-      int c;
-      uint32_t nbytes = 0;
-      /* Read file, null-terminate buffer and close file again */
-      do
-      {
-        c = fgetc(fp);
-        src->file_content[nbytes++] = c;
-        src->nlines += (c == '\n');
-      }
-      while (c != EOF);       /* Read until EOF */
+      /* Read file in one go - never more than the buffer holds, should the file have grown - and null-terminate it */
+      size_t nbytes = fread(src->file_content, 1, src->file_size, fp);
       fclose(fp);             /* Close file again */
-      src->file_content[nbytes - 1] = 0; /* Overwrite EOF with null-termination */
-        
-      nbytes_read = (int)nbytes;
+      src->file_content[nbytes] = 0;
+      src->file_size = (uint32_t)nbytes;
+      src->nlines = count_lines(src->file_content, nbytes);
+
+      nbytes_read = (int64_t)nbytes + 1;
     }
   }
   return nbytes_read;
@@ -76,22 +178,33 @@ int src_read_content(struct source_file* src)
 
 int src_free(struct source_file* src)
 {
-  /* Macro to save a little typing */
-  #define FREE(x)   if ((x) != 0) { free((x)); x = 0; }
-
   int success = 0;
   if (src != 0)
   {
-    FREE(src->file_path);
-    if (src->file_size > 0)
-    {
-      FREE(src->file_content);
-    }
+    /* memory of path and contents goes back to the arena, for the next file */
+    src->file_path = 0;
+    src->file_content = 0;
+    arena_reset(&arena);
     success = 1;
   }
   return success;
 }
 
 
+void src_release(void)
+{
+  arena_free(&arena);
+}
+
+
+void src_print_alloc_stats(FILE* out)
+{
+  /* only the arena of file paths and contents - token, string and report buffers are not counted */
+  fprintf(out, "# alloc-stats: %u files, %llu heap allocations by the path+content arena, %llu on a warm arena, %llu bytes reserved, peak %llu bytes per file\n",
+          nfiles, (unsigned long long)arena.nmallocs, (unsigned long long)nwarm_mallocs,
+          (unsigned long long)arena_capacity(&arena), (unsigned long long)arena.peak);
+}
+
+
 
 
@@ -4,12 +4,19 @@
 
 #include "lexer.h"
 #include <stdint.h> /* for intX_t            */
+#include <stdio.h>  /* for FILE              */
+
+#define SRC_CONTENT_PADDING   10   /* zero bytes after the contents - the lexer may look ahead past the end */
+#define SRC_MAX_FILE_SIZE     0x40000000u   /* 1 GiB - larger files are not analyzed, token offsets are 32 bits */
 
 /*
   Structure associating source file with:
    - Array of tokens lexed from file
    - Path-to-file and file contents
    - File size in bytes and line count
+
+  Path and contents live in an arena that src_free() resets, so after the first
+  few files no more heap allocations are made.
 */
 struct source_file
 {
@@ -25,8 +32,13 @@ struct source_file
 
 
 int src_init(struct source_file* src, const char* file_path);
-int src_read_content(struct source_file* src);
+int64_t src_read_content(struct source_file* src);
+int64_t src_init_loaded(struct source_file* src, const char* file_path, char* content, uint32_t size);
+int64_t src_read_stream(struct source_file* src, const char* file_path, FILE* in, uint64_t size);
+int src_skip_stream(FILE* in, uint64_t size);
 int src_free(struct source_file* src);
+void src_release(void);
+void src_print_alloc_stats(FILE* out);
 
 
 
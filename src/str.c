@@ -20,6 +20,27 @@ void str_init(void)
 }
 
 
+/* bytes left in the string-buffer for the current file */
+int str_available(void)
+{
+  return STR_BUF_SZ - str_idx;
+}
+
+
+/* copy 'len' bytes and null-terminate them - for strings whose length is known */
+char* str_copy_len(const char* string, uint32_t len)
+{
+  char* ret = &str_buffer[str_idx];
+
+  assert((str_idx + (int)len + 1) < STR_BUF_SZ);
+  memcpy(ret, string, len);
+  ret[len] = 0;
+  str_idx += (int)len + 1;
+
+  return ret;
+}
+
+
 char* str_copy(const char* string)
 {
   char* ret = &str_buffer[str_idx];
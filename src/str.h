@@ -7,10 +7,14 @@ String buffer, holding statically allocated strings
 
 */
 
+#include <stdint.h>
+
 
 
 void  str_init(void);
 char* str_copy(const char* string);
+char* str_copy_len(const char* string, uint32_t len);
+int   str_available(void);
 
 
 #endif /* __STR_H__ */
@@ -0,0 +1,126 @@
+/*
+
+Cross-file symbol index
+
+  Per shard: a growable array of records, appended under the shard's lock.
+
+*/
+
+#include "symindex.h"
+#include "intern.h"
+#include <assert.h>
+#include <pthread.h>
+#include <stdlib.h>  /* realloc, qsort, free */
+
+
+struct symbol_shard
+{
+  pthread_mutex_t       lock;
+  struct symbol_record* recs;
+  uint32_t              nrecs;
+  uint32_t              maxrecs;
+};
+
+
+static struct symbol_shard shards[INTERN_NSHARDS];
+static pthread_once_t      init_once = PTHREAD_ONCE_INIT;
+
+
+
+static void symindex_init(void)
+{
+  uint32_t i;
+  for (i = 0; i < INTERN_NSHARDS; ++i)
+  {
+    shards[i].recs = 0;
+    shards[i].nrecs = 0;
+    shards[i].maxrecs = 0;
+    pthread_mutex_init(&shards[i].lock, 0);
+  }
+}
+
+
+void symindex_add(uint32_t name_id, uint32_t file_id, uint32_t lineno, uint32_t info)
+{
+  struct symbol_shard* sh = &shards[name_id & (INTERN_NSHARDS - 1)];
+
+  pthread_once(&init_once, symindex_init);
+  pthread_mutex_lock(&sh->lock);
+
+  if (sh->nrecs == sh->maxrecs)
+  {
+    sh->maxrecs = (sh->maxrecs == 0) ? 1024 : (2 * sh->maxrecs);
+    sh->recs = realloc(sh->recs, sh->maxrecs * sizeof(*sh->recs));
+    assert(sh->recs != 0);
+  }
+  sh->recs[sh->nrecs].name_id = name_id;
+  sh->recs[sh->nrecs].file_id = file_id;
+  sh->recs[sh->nrecs].lineno  = lineno;
+  sh->recs[sh->nrecs].info    = info;
+  sh->nrecs += 1;
+
+  pthread_mutex_unlock(&sh->lock);
+}
+
+
+uint64_t symindex_count(void)
+{
+  uint64_t n = 0;
+  uint32_t i;
+  for (i = 0; i < INTERN_NSHARDS; ++i)
+  {
+    n += shards[i].nrecs;
+  }
+  return n;
+}
+
+
+static int record_cmp(const void* a, const void* b)
+{
+  const struct symbol_record* ra = (const struct symbol_record*)a;
+  const struct symbol_record* rb = (const struct symbol_record*)b;
+
+  if (ra->name_id != rb->name_id) { return (ra->name_id < rb->name_id) ? -1 : 1; }
+  if (ra->file_id != rb->file_id) { return (ra->file_id < rb->file_id) ? -1 : 1; }
+  if (ra->lineno  != rb->lineno)  { return (ra->lineno  < rb->lineno)  ? -1 : 1; }
+  return 0;
+}
+
+
+/* sort each shard and hand out the records of each name - call when all workers are done */
+void symindex_walk(symindex_group_fn fn)
+{
+  uint32_t i;
+
+  for (i = 0; i < INTERN_NSHARDS; ++i)
+  {
+    struct symbol_shard* sh = &shards[i];
+    uint32_t first = 0;
+    uint32_t j;
+
+    qsort(sh->recs, sh->nrecs, sizeof(*sh->recs), record_cmp);
+    for (j = 1; j <= sh->nrecs; ++j)
+    {
+      if (    (j == sh->nrecs)
+           || (sh->recs[j].name_id != sh->recs[first].name_id))
+      {
+        fn(&sh->recs[first], j - first);
+        first = j;
+      }
+    }
+  }
+}
+
+
+void symindex_free(void)
+{
+  uint32_t i;
+  for (i = 0; i < INTERN_NSHARDS; ++i)
+  {
+    free(shards[i].recs);
+    shards[i].recs = 0;
+    shards[i].nrecs = 0;
+    shards[i].maxrecs = 0;
+  }
+}
+
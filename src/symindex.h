@@ -0,0 +1,47 @@
+#ifndef __SYMINDEX_H__
+#define __SYMINDEX_H__
+
+/*
+
+Cross-file symbol index
+
+  Declarations seen while files are analyzed, for checks that need the whole project.
+  A record is 16 bytes: interned name and file, line number and a packed 'info' word.
+  Records are sharded by name - the same shards as the interner - each shard with its
+  own lock, so concurrent workers can add records.
+
+  At the end of a run, symindex_walk() hands out all records of one name at a time,
+  ordered by file and line.
+
+*/
+
+#include <stdint.h>
+
+
+/* info: kind in the top 4 bits, the rest is up to the kind */
+#define SYM_INFO(kind, data)   (((uint32_t)(kind) << 28) | ((uint32_t)(data) & 0x0FFFFFFFu))
+#define SYM_KIND(info)         ((info) >> 28)
+#define SYM_DATA(info)         ((info) & 0x0FFFFFFFu)
+
+
+struct symbol_record
+{
+  uint32_t name_id;   /* intern() id */
+  uint32_t file_id;   /* intern() id of the path */
+  uint32_t lineno;
+  uint32_t info;      /* SYM_INFO() */
+};
+
+typedef void (*symindex_group_fn)(const struct symbol_record* recs, uint32_t nrecs);
+
+
+
+void     symindex_add(uint32_t name_id, uint32_t file_id, uint32_t lineno, uint32_t info);
+uint64_t symindex_count(void);
+void     symindex_walk(symindex_group_fn fn);
+void     symindex_free(void);
+
+
+
+#endif /* __SYMINDEX_H__ */
+
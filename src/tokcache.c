@@ -0,0 +1,260 @@
+/*
+
+Binary token-stream cache
+
+  Writer: serializes an array of tokens column by column (see tokcache.h).
+  Reader: mmap()s the file, validates the header and sizes, and points into the mapping.
+          Keyword ids are resolved again through the lexer's keyword table when tokens are
+          handed out, as type names learned from typedefs can differ from run to run.
+
+*/
+
+#include "tokcache.h"
+#include "intern.h"
+#include "hash.h"
+#include <fcntl.h>     /* open */
+#include <stddef.h>    /* offsetof */
+#include <stdio.h>     /* fopen, fwrite, snprintf */
+#include <string.h>    /* memcmp, memset */
+#include <sys/mman.h>  /* mmap */
+#include <sys/stat.h>  /* fstat */
+#include <unistd.h>    /* close */
+
+
+
+uint64_t tokcache_content_hash(const char* content, uint32_t size)
+{
+  return hash_fnv1a64(content, size, HASH_FNV1A64_INIT);
+}
+
+
+/* cache file for a source file: '<dir>/<hash of path>.tlt' */
+void tokcache_path(char* out, uint32_t out_size, const char* dir, const char* src_path)
+{
+  uint64_t h = hash_fnv1a64(src_path, strlen(src_path), HASH_FNV1A64_INIT);
+  snprintf(out, out_size, "%s/%016llx.tlt", dir, (unsigned long long)h);
+}
+
+
+static int write_column(FILE* f, const struct token* toks, int ntoks, size_t field)
+{
+  int i;
+  for (i = 0; i < ntoks; ++i)
+  {
+    uint32_t v = *(const uint32_t*)((const char*)&toks[i] + field);
+    if (fwrite(&v, sizeof(v), 1, f) != 1)
+    {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+
+int tokcache_write(const char* cache_path, uint64_t content_hash, uint64_t macro_hash, uint32_t file_size, const struct token* toks, int ntoks)
+{
+  struct tokcache_header hdr;
+  uint32_t pool_size = 0;
+  int ok = 1;
+  int i;
+
+  FILE* f = fopen(cache_path, "wb");
+  if (f == 0)
+  {
+    return 0;
+  }
+
+  for (i = 0; i < ntoks; ++i)
+  {
+    pool_size += toks[i].symlen + 1;
+  }
+
+  memset(&hdr, 0, sizeof(hdr));
+  memcpy(hdr.magic, TOKCACHE_MAGIC, sizeof(hdr.magic));
+  hdr.version      = TOKCACHE_VERSION;
+  hdr.ntokens      = (uint32_t)ntoks;
+  hdr.pool_size    = pool_size;
+  hdr.content_hash = content_hash;
+  hdr.macro_hash   = macro_hash;
+  hdr.file_size    = file_size;
+
+  ok = ok && (fwrite(&hdr, sizeof(hdr), 1, f) == 1);
+  ok = ok && write_column(f, toks, ntoks, offsetof(struct token, foffset));
+  ok = ok && write_column(f, toks, ntoks, offsetof(struct token, symlen));
+  ok = ok && write_column(f, toks, ntoks, offsetof(struct token, lineno));
+  ok = ok && write_column(f, toks, ntoks, offsetof(struct token, byteno));
+
+  /* symbol offsets into the pool */
+  uint32_t symoff = 0;
+  for (i = 0; (i < ntoks) && ok; ++i)
+  {
+    ok = (fwrite(&symoff, sizeof(symoff), 1, f) == 1);
+    symoff += toks[i].symlen + 1;
+  }
+  for (i = 0; (i < ntoks) && ok; ++i)
+  {
+    ok = (fputc((int)toks[i].tokknd, f) != EOF);
+  }
+  for (i = 0; (i < ntoks) && ok; ++i)
+  {
+    ok = (fputc((int)toks[i].toktyp, f) != EOF);
+  }
+  for (i = 0; (i < ntoks) && ok; ++i)
+  {
+    ok = (fwrite(toks[i].symbol, toks[i].symlen + 1, 1, f) == 1);
+  }
+
+  ok = (fclose(f) == 0) && ok;
+  if (!ok)
+  {
+    remove(cache_path); /* never leave a truncated cache behind */
+  }
+  return ok;
+}
+
+
+int tokcache_open(struct tokcache* c, const char* cache_path)
+{
+  struct stat st;
+  int fd;
+
+  memset(c, 0, sizeof(*c));
+
+  fd = open(cache_path, O_RDONLY);
+  if (fd < 0)
+  {
+    return 0;
+  }
+  if (    (fstat(fd, &st) != 0)
+       || ((uint64_t)st.st_size < sizeof(struct tokcache_header)))   /* the header must be there before it is read */
+  {
+    close(fd);
+    return 0;
+  }
+
+  c->map_size = (uint64_t)st.st_size;
+  c->map = mmap(0, c->map_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (c->map == MAP_FAILED)
+  {
+    c->map = 0;
+    return 0;
+  }
+
+  const struct tokcache_header* hdr = (const struct tokcache_header*)c->map;
+  uint64_t n = hdr->ntokens;
+  uint64_t expected = sizeof(*hdr) + (n * 5 * sizeof(uint32_t)) + (n * 2) + hdr->pool_size;
+  if (    (memcmp(hdr->magic, TOKCACHE_MAGIC, sizeof(hdr->magic)) != 0)
+       || (hdr->version != TOKCACHE_VERSION)
+       || (expected != c->map_size))
+  {
+    tokcache_close(c);
+    return 0;
+  }
+
+  const char* p = (const char*)c->map + sizeof(*hdr);
+  c->hdr     = hdr;
+  c->foffset = (const uint32_t*)p;  p += n * sizeof(uint32_t);
+  c->symlen  = (const uint32_t*)p;  p += n * sizeof(uint32_t);
+  c->lineno  = (const uint32_t*)p;  p += n * sizeof(uint32_t);
+  c->byteno  = (const uint32_t*)p;  p += n * sizeof(uint32_t);
+  c->symoff  = (const uint32_t*)p;  p += n * sizeof(uint32_t);
+  c->tokknd  = (const uint8_t*)p;   p += n;
+  c->toktyp  = (const uint8_t*)p;   p += n;
+  c->pool    = p;
+
+  /* the checkers trust every token: each symbol must be terminated inside the pool, and start inside the file;
+     the kind must be known, and an operator's type is its index into the alphabet */
+  uint32_t i;
+  for (i = 0; i < n; ++i)
+  {
+    if (    ((uint64_t)c->symoff[i] + c->symlen[i] >= hdr->pool_size)
+         || (c->pool[c->symoff[i] + c->symlen[i]] != 0)
+         || (c->foffset[i] >= hdr->file_size)
+         || (c->tokknd[i] > TOK_IDENTIFIER)
+         || (    (c->tokknd[i] == TOK_OPERATOR)
+              && (c->toktyp[i] > OP_RBRACKET)))
+    {
+      tokcache_close(c);
+      return 0;
+    }
+  }
+
+  return 1;
+}
+
+
+void tokcache_close(struct tokcache* c)
+{
+  if (c->map != 0)
+  {
+    munmap(c->map, c->map_size);
+  }
+  memset(c, 0, sizeof(*c));
+}
+
+
+/* hand out token 'idx' - the symbol points into the mapping, no copies are made */
+void tokcache_token(const struct tokcache* c, struct lexer* l, uint32_t idx, struct token* t)
+{
+  t->symbol  = (char*)(c->pool + c->symoff[idx]); /* read-only: checkers never write to symbols */
+  t->symlen  = c->symlen[idx];
+  t->tokknd  = c->tokknd[idx];
+  t->toktyp  = c->toktyp[idx];
+  t->lineno  = c->lineno[idx];
+  t->byteno  = c->byteno[idx];
+  t->foffset = c->foffset[idx];
+  t->kwid    = KWID_NONE;
+  t->symid   = SYMID_NONE;
+
+  if (t->tokknd == TOK_OPERATOR)
+  {
+    t->kwid  = t->toktyp; /* operators are the first entries of the alphabet, in type order */
+    t->symid = lexer_lexeme(l, t->kwid)->symid;
+  }
+  else if (    (t->tokknd == TOK_KEYWORD)
+            || (t->tokknd == TOK_IDENTIFIER))
+  {
+    uint32_t kwid = lexer_find_keyword(l, t->symbol, t->symlen);
+    if (kwid != KWID_NONE)
+    {
+      const struct token* kw = lexer_lexeme(l, kwid);
+      t->tokknd = kw->tokknd;
+      t->toktyp = kw->toktyp;
+      t->kwid   = kwid;
+      t->symid  = kw->symid;
+    }
+    else
+    {
+      t->tokknd = TOK_IDENTIFIER;  /* a type name from another run */
+      t->toktyp = CNST_STRING;
+      t->symid  = intern(t->symbol, t->symlen);
+    }
+  }
+}
+
+
+int tokcache_dump(struct lexer* l, const char* cache_path)
+{
+  struct tokcache c;
+  struct token t;
+  uint32_t i;
+
+  if (!tokcache_open(&c, cache_path))
+  {
+    return 0;
+  }
+
+  fprintf(stdout, "# %s: version %u, %u tokens, %u bytes of source, content hash %016llx, macro hash %016llx\n",
+          cache_path, c.hdr->version, c.hdr->ntokens, c.hdr->file_size, (unsigned long long)c.hdr->content_hash,
+          (unsigned long long)c.hdr->macro_hash);
+  for (i = 0; i < c.hdr->ntokens; ++i)
+  {
+    tokcache_token(&c, l, i, &t);
+    lexer_print_token(l, &t);
+  }
+
+  tokcache_close(&c);
+  return 1;
+}
+
@@ -0,0 +1,76 @@
+#ifndef __TOKCACHE_H__
+#define __TOKCACHE_H__
+
+/*
+
+Binary token-stream cache
+
+  A file's token stream, stored so it can be memory-mapped and used without parsing.
+  Layout (native byte order, all arrays 'ntokens' long):
+
+    struct tokcache_header
+    uint32_t foffset[]      byte offset of each token in the source file
+    uint32_t symlen[]       token length in bytes
+    uint32_t lineno[]
+    uint32_t byteno[]
+    uint32_t symoff[]       offset of the null-terminated symbol in pool[]
+    uint8_t  tokknd[]
+    uint8_t  toktyp[]
+    char     pool[]         'pool_size' bytes of null-terminated symbols
+
+  The header carries a hash of the source contents, so stale caches are detected, and a
+  hash of the -D/-U macros the file was lexed with - they decide which '#if' branches are
+  skipped, so a stream is only used again under the same macros.
+
+*/
+
+#include "lexer.h"
+#include <stdint.h>
+
+
+#define TOKCACHE_MAGIC     "TLTC"
+#define TOKCACHE_VERSION   2
+
+
+struct tokcache_header
+{
+  char     magic[4];        /* TOKCACHE_MAGIC                        */
+  uint32_t version;         /* TOKCACHE_VERSION                      */
+  uint32_t ntokens;         /* number of tokens, excluding EOF       */
+  uint32_t pool_size;       /* bytes in the symbol pool              */
+  uint64_t content_hash;    /* hash_fnv1a64() of the source contents */
+  uint64_t macro_hash;      /* ppcond_hash() when the file was lexed */
+  uint32_t file_size;       /* size of the source file in bytes      */
+  uint32_t reserved;
+};
+
+/* read-only view of a mapped cache file */
+struct tokcache
+{
+  const struct tokcache_header* hdr;
+  const uint32_t* foffset;
+  const uint32_t* symlen;
+  const uint32_t* lineno;
+  const uint32_t* byteno;
+  const uint32_t* symoff;
+  const uint8_t*  tokknd;
+  const uint8_t*  toktyp;
+  const char*     pool;
+  void*           map;
+  uint64_t        map_size;
+};
+
+
+
+uint64_t tokcache_content_hash(const char* content, uint32_t size);
+void     tokcache_path(char* out, uint32_t out_size, const char* dir, const char* src_path);
+int      tokcache_write(const char* cache_path, uint64_t content_hash, uint64_t macro_hash, uint32_t file_size, const struct token* toks, int ntoks);
+int      tokcache_open(struct tokcache* c, const char* cache_path);
+void     tokcache_close(struct tokcache* c);
+void     tokcache_token(const struct tokcache* c, struct lexer* l, uint32_t idx, struct token* t);
+int      tokcache_dump(struct lexer* l, const char* cache_path);
+
+
+
+#endif /* __TOKCACHE_H__ */
+
@@ -106,9 +106,36 @@ enum
   CNST_STRING,        /* 77 : string literal  */
   CNST_INT,           /* 78 : integer numeral */
   CNST_FLOAT,         /* 79 : float numeral   */
+
+  KW_TYPE_NAME,       /* 80 : typedef'd type name, registered at run-time */
+
+  /* Keywords of C99, C11 and GNU C - after the above, so cached token types keep their values: */
+  KW_INLINE,          /* 81 : inline         __inline __inline__        */
+  KW_RESTRICT,        /* 82 : restrict       __restrict __restrict__    */
+  KW_BOOL,            /* 83 : _Bool          */
+  KW_COMPLEX,         /* 84 : _Complex       __complex__                */
+  KW_IMAGINARY,       /* 85 : _Imaginary     */
+  KW_ALIGNAS,         /* 86 : _Alignas       */
+  KW_ALIGNOF,         /* 87 : _Alignof       __alignof __alignof__      */
+  KW_ATOMIC,          /* 88 : _Atomic        */
+  KW_GENERIC,         /* 89 : _Generic       */
+  KW_NORETURN,        /* 90 : _Noreturn      */
+  KW_STATIC_ASSERT,   /* 91 : _Static_assert */
+  KW_THREAD_LOCAL,    /* 92 : _Thread_local  __thread                   */
+  KW_ASM,             /* 93 : asm            __asm __asm__              */
+  KW_TYPEOF,          /* 94 : typeof         __typeof __typeof__        */
+  KW_ATTRIBUTE,       /* 95 : __attribute__  __attribute                */
+  KW_EXTENSION,       /* 96 : __extension__  */
 };
 
 
+/* Value of token.kwid for tokens that did not match an entry in the lexer's keyword table. */
+#define KWID_NONE     0xFFFFFFFFu
+
+/* Value of token.symid for tokens without a symbol id - constants and <EOF>. Same as INTERN_NONE. */
+#define SYMID_NONE    0xFFFFFFFFu
+
+
 
 
 /* Data structure defining tokens/lexemes that we want the lexer to match. */
@@ -120,7 +147,9 @@ struct token
   uint32_t toktyp;   /* e.g. tokknd == TOK_OPERATOR && toktyp == OP_LSH. */
   uint32_t lineno;   /* line in buffer where token was lexed. First line is no. 1. */
   uint32_t byteno;   /* byte offset into line where token was lexed. First byte is no. 0. */
-  uint32_t foffset;  /* byte offset into source file, for faster lookup. */
+  uint32_t foffset;  /* byte offset into source file of the first char of the token, for faster lookup. */
+  uint32_t kwid;     /* index into the lexer's table of operators + keywords, or KWID_NONE. */
+  uint32_t symid;    /* intern() id of the symbol - equal names, equal ids - or SYMID_NONE for constants. */
 };
 
 
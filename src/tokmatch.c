@@ -0,0 +1,110 @@
+/*
+
+Vectorized matching of token-type sequences
+
+*/
+
+#include "tokmatch.h"
+#include "simd.h"
+#include <string.h> /* memset */
+
+
+
+void tokmatch_pack(const struct token* toks, int ntoks, uint8_t* packed)
+{
+  int i;
+  for (i = 0; i < ntoks; ++i)
+  {
+    if (toks[i].tokknd == TOK_IDENTIFIER)
+    {
+      packed[i] = PK_IDENT;
+    }
+    else if (toks[i].tokknd == TOK_EOF)
+    {
+      packed[i] = PK_EOF;
+    }
+    else
+    {
+      packed[i] = (uint8_t)toks[i].toktyp;
+    }
+  }
+  memset(packed + ntoks, PK_EOF, TOKMATCH_PAD);
+}
+
+
+/* index of the first occurrence of pattern (1 to 3 token types) at or after 'from', or -1 */
+int tokmatch_find(const uint8_t* packed, int ntoks, int from, const uint8_t* pattern, int pattern_len)
+{
+  vec_t c0 = vec_splat(pattern[0]);
+  vec_t c1 = vec_splat((pattern_len > 1) ? pattern[1] : 0);
+  vec_t c2 = vec_splat((pattern_len > 2) ? pattern[2] : 0);
+  int i;
+
+  for (i = from; i < ntoks; i += VEC_BYTES)
+  {
+    uint32_t m = vec_eq_mask(vec_load(packed + i), c0);
+    if ((m != 0) && (pattern_len > 1))
+    {
+      m &= vec_eq_mask(vec_load(packed + i + 1), c1);
+    }
+    if ((m != 0) && (pattern_len > 2))
+    {
+      m &= vec_eq_mask(vec_load(packed + i + 2), c2);
+    }
+    if (m != 0)
+    {
+      int idx = i + vec_first_bit(m);
+      return ((idx + pattern_len) <= ntoks) ? idx : -1;
+    }
+  }
+  return -1;
+}
+
+
+void tokmatch_depth_init(struct tokmatch_depth* d)
+{
+  d->pos = 0;
+  d->brace_lvl = 0;
+  d->paren_lvl = 0;
+}
+
+
+/* advance d to 'pos' - blocks without any brace or paren are skipped with a few compares */
+void tokmatch_depth_advance(struct tokmatch_depth* d, const uint8_t* packed, int pos)
+{
+  const vec_t lbrace = vec_splat(OP_LBRACE);
+  const vec_t rbrace = vec_splat(OP_RBRACE);
+  const vec_t lparen = vec_splat(OP_LPAREN);
+  const vec_t rparen = vec_splat(OP_RPAREN);
+
+  while (d->pos < pos)
+  {
+    int end = pos;
+    if ((d->pos + VEC_BYTES) <= pos)
+    {
+      vec_t v = vec_load(packed + d->pos);
+      uint32_t m = vec_eq_mask(v, lbrace) | vec_eq_mask(v, rbrace) | vec_eq_mask(v, lparen) | vec_eq_mask(v, rparen);
+      if (m == 0)
+      {
+        d->pos += VEC_BYTES;
+        continue;
+      }
+      end = d->pos + VEC_BYTES;
+    }
+
+    /* block with braces/parens (or the tail): count them one by one */
+    for (; d->pos < end; d->pos += 1)
+    {
+      switch (packed[d->pos])
+      {
+        case OP_LBRACE: d->brace_lvl += 1; break;
+        case OP_RBRACE: d->brace_lvl -= 1; break;
+        case OP_LPAREN: d->paren_lvl += 1; break;
+        case OP_RPAREN: d->paren_lvl -= 1; break;
+      }
+      if (d->brace_lvl < 0) { d->brace_lvl = 0; }
+      if (d->paren_lvl < 0) { d->paren_lvl = 0; }
+    }
+  }
+}
+
@@ -0,0 +1,42 @@
+#ifndef __TOKMATCH_H__
+#define __TOKMATCH_H__
+
+/*
+
+Vectorized matching of token-type sequences
+
+  A lexed file is packed into one byte per token - the token type for operators, keywords and
+  constants, PK_IDENT for identifiers. Short fixed sequences such as '( )' or ') ; {' can then
+  be searched for with SIMD compares over VEC_BYTES tokens at a time, and checkers only verify
+  the (rare) candidates. The packed array is padded with PK_EOF so searches may read past the end.
+
+*/
+
+#include "token.h"
+#include <stdint.h>
+
+
+#define PK_IDENT      0xF0  /* packed type of identifiers                      */
+#define PK_EOF        0xFF  /* packed type of EOF and padding                  */
+#define TOKMATCH_PAD    64  /* bytes of PK_EOF padding after the packed tokens */
+
+
+/* brace/paren balance before token 'pos' - clamped at 0 like the per-token checkers */
+struct tokmatch_depth
+{
+  int pos;
+  int brace_lvl;
+  int paren_lvl;
+};
+
+
+
+void tokmatch_pack(const struct token* toks, int ntoks, uint8_t* packed);
+int  tokmatch_find(const uint8_t* packed, int ntoks, int from, const uint8_t* pattern, int pattern_len);
+void tokmatch_depth_init(struct tokmatch_depth* d);
+void tokmatch_depth_advance(struct tokmatch_depth* d, const uint8_t* packed, int pos);
+
+
+
+#endif /* __TOKMATCH_H__ */
+
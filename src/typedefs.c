@@ -0,0 +1,265 @@
+/*
+
+Typedef'd type names
+
+  Per-token state machine that follows a typedef declaration up to its terminating ';':
+
+    typedef  uint16_t   my_u16_t, *my_u16p_t;
+    ^        ^          ^         ^
+    start    base-type  declarator (alias of base)
+                                  declarator (pointer - no alias)
+
+  Only single-token bases are remembered - 'typedef unsigned short u16_t;' names a type,
+  but aliases nothing the checks know.
+
+  Declarators are the identifiers at brace-level 0, outside parentheses - except for
+  function pointers like 'typedef void (*fn_t)(int);', where the name directly follows
+  the '(*' that opens the declarator. A name that is a type already is the declarator of
+  a re-declaration, e.g. of a header that is read twice - never a reason to look further.
+
+*/
+
+#include "typedefs.h"
+#include <assert.h>
+#include <stdio.h>  /* fopen, fgets */
+#include <stdlib.h> /* realloc, free */
+#include <string.h> /* strlen */
+
+
+
+static struct lexer* lex = 0;
+static uint32_t* bases = 0;        /* base-type kwid for each kwid - KWID_NONE when not an alias */
+static uint32_t  nbases = 0;
+static uint32_t  naliases = 0;     /* number of type names with a known base type */
+
+/* typedef-declaration state - reset for each file */
+static int      in_typedef = 0;
+static int      brace_lvl = 0;
+static int      paren_lvl = 0;
+static int      decl_idx = -1;     /* token index of current declarator name */
+static int      decl_indirect = 0; /* declarator is a pointer, array or function - not an alias */
+static uint32_t base_kwid = KWID_NONE;
+
+
+
+void typedefs_init(struct lexer* l)
+{
+  lex = l;
+}
+
+void typedefs_free(void)
+{
+  free(bases);
+  bases = 0;
+  nbases = 0;
+  naliases = 0;
+}
+
+static void reset_state(void)
+{
+  in_typedef = 0;
+  brace_lvl = 0;
+  paren_lvl = 0;
+  decl_idx = -1;
+  decl_indirect = 0;
+  base_kwid = KWID_NONE;
+}
+
+void typedefs_new_file(void)
+{
+  reset_state();
+}
+
+
+/* follow alias chains - returns kwid itself when it is not an alias of another type */
+uint32_t typedefs_base(uint32_t kwid)
+{
+  if (    (kwid < nbases)
+       && (bases[kwid] != KWID_NONE))
+  {
+    return bases[kwid];
+  }
+  return kwid;
+}
+
+const char* typedefs_base_symbol(const struct token* t)
+{
+  uint32_t kwid = typedefs_base(t->kwid);
+  if (    (kwid != KWID_NONE)
+       && (kwid != t->kwid))
+  {
+    return lexer_lexeme(lex, kwid)->symbol;
+  }
+  return t->symbol;
+}
+
+uint32_t typedefs_naliases(void)
+{
+  return naliases;
+}
+
+
+/* register 'name' as a type, aliasing 'base' (or KWID_NONE) */
+static void add_type(const char* name, uint32_t len, uint32_t base)
+{
+  uint32_t kwid = lexer_add_type(lex, name, len);
+
+  if (kwid >= nbases)
+  {
+    uint32_t n = nbases;
+    nbases = (kwid + 1 > 2 * nbases) ? (kwid + 1) : (2 * nbases);
+    bases = realloc(bases, nbases * sizeof(*bases));
+    assert(bases != 0);
+    while (n < nbases)
+    {
+      bases[n++] = KWID_NONE;
+    }
+  }
+
+  base = typedefs_base(base);
+  if (    (base != KWID_NONE)
+       && (base != kwid)
+       && (lexer_lexeme(lex, kwid)->toktyp == KW_TYPE_NAME)) /* never re-define built-in keywords */
+  {
+    naliases += (bases[kwid] == KWID_NONE);
+    bases[kwid] = base;
+  }
+}
+
+
+static void end_declarator(struct token* toks)
+{
+  if (decl_idx >= 0)
+  {
+    add_type(toks[decl_idx].symbol, toks[decl_idx].symlen, decl_indirect ? KWID_NONE : base_kwid);
+  }
+  decl_idx = -1;
+  decl_indirect = 0;
+}
+
+
+void typedefs_new_token(struct token* toks, int tok_idx)
+{
+  struct token* t = &toks[tok_idx];
+
+  if (!in_typedef)
+  {
+    if (t->toktyp == KW_TYPEDEF)
+    {
+      reset_state();
+      in_typedef = 1;
+    }
+    return;
+  }
+
+       if (t->toktyp == OP_LBRACE) { brace_lvl += 1; return; }
+  else if (t->toktyp == OP_RBRACE) { brace_lvl -= 1; return; }
+  if (brace_lvl > 0)
+  {
+    return; /* struct/union/enum body */
+  }
+
+  switch (t->toktyp)
+  {
+    case OP_LPAREN:   paren_lvl += 1; break;
+    case OP_RPAREN:   paren_lvl -= 1; break;
+    case OP_MULTIPLY: decl_indirect = 1; break;
+    case OP_LBRACKET: decl_indirect = 1; break;
+    case OP_COMMA:
+    {
+      if (paren_lvl == 0)
+      {
+        end_declarator(toks);
+      }
+    } break;
+    case OP_SEMICOLON:
+    {
+      end_declarator(toks);
+      in_typedef = 0;
+    } break;
+    default:
+    {
+      int is_name = (t->tokknd == TOK_IDENTIFIER) || (t->toktyp == KW_TYPE_NAME);
+      if (    is_name
+           && (paren_lvl == 1)
+           && (tok_idx >= 2)
+           && (toks[tok_idx - 1].toktyp == OP_MULTIPLY)
+           && (toks[tok_idx - 2].toktyp == OP_LPAREN))
+      {
+        decl_idx = tok_idx; /* function pointer: 'typedef int (*name)(...)' - never a parameter like '(int *b)' */
+        decl_indirect = 1;
+      }
+      else if (t->tokknd == TOK_IDENTIFIER)
+      {
+        if (paren_lvl == 0)
+        {
+          decl_idx = tok_idx;
+        }
+      }
+      else if (    (t->toktyp == KW_TYPE_NAME)
+                && (paren_lvl == 0)
+                && (    (decl_idx >= 0)
+                     || (base_kwid != KWID_NONE)))
+      {
+        decl_idx = tok_idx; /* re-declaration: the name is a type already, e.g. a header seen twice */
+      }
+      else if (    (t->tokknd == TOK_KEYWORD)
+                && (paren_lvl == 0)
+                && (decl_idx < 0)
+                && (    (t->toktyp == KW_INT)
+                     || (t->toktyp == KW_TYPE_NAME)))
+      {
+        base_kwid = t->kwid;
+      }
+    } break;
+  }
+}
+
+
+int typedefs_load(const char* file_path)
+{
+  char line[1024];
+  FILE* f = fopen(file_path, "r");
+  if (f == 0)
+  {
+    return 0;
+  }
+
+  /* one type per line: '<name> [<base-type>]' - lines starting with '#' are comments */
+  while (fgets(line, sizeof(line), f) != 0)
+  {
+    char* p = line;
+    while ((*p == ' ') || (*p == '\t'))
+    {
+      p += 1;
+    }
+    if ((*p == '#') || (*p == '\n') || (*p == '\r') || (*p == 0))
+    {
+      continue;
+    }
+
+    char* name = p;
+    while ((*p != ' ') && (*p != '\t') && (*p != '\n') && (*p != '\r') && (*p != 0))
+    {
+      p += 1;
+    }
+    uint32_t name_len = (uint32_t)(p - name);
+
+    while ((*p == ' ') || (*p == '\t'))
+    {
+      p += 1;
+    }
+    char* base = p;
+    while ((*p != ' ') && (*p != '\t') && (*p != '\n') && (*p != '\r') && (*p != 0))
+    {
+      p += 1;
+    }
+    uint32_t base_len = (uint32_t)(p - base);
+
+    add_type(name, name_len, (base_len > 0) ? lexer_find_keyword(lex, base, base_len) : KWID_NONE);
+  }
+  fclose(f);
+
+  return 1;
+}
+
@@ -0,0 +1,33 @@
+#ifndef __TYPEDEFS_H__
+#define __TYPEDEFS_H__
+
+/*
+
+Typedef'd type names
+
+  Learns type names from 'typedef' declarations as tokens pass by, and registers them in the
+  lexer's keyword table, so later tokens with that name are lexed as keywords (KW_TYPE_NAME).
+  Type names can also be loaded up-front from a file, one per line: '<name> [<base-type>]'.
+  For plain aliases, e.g. 'typedef uint16_t my_u16_t;', the aliased base type is remembered,
+  so checkers can see through the alias.
+
+*/
+
+#include "lexer.h"
+#include <stdint.h>
+
+
+
+void        typedefs_init(struct lexer* l);
+void        typedefs_free(void);
+int         typedefs_load(const char* file_path);
+void        typedefs_new_file(void);
+void        typedefs_new_token(struct token* toks, int tok_idx);
+uint32_t    typedefs_base(uint32_t kwid);
+const char* typedefs_base_symbol(const struct token* t);
+uint32_t    typedefs_naliases(void);
+
+
+
+#endif /* __TYPEDEFS_H__ */
+
@@ -0,0 +1,501 @@
+/*
+
+Watch mode
+
+  - files:    open-addressing hash table path -> findings of that file, as printed lines.
+  - wd_dirs:  directory path for each inotify watch descriptor.
+  - pending:  files with events since the last update - each listed once, via a flag in 'files'.
+
+*/
+
+#include "watch.h"
+#include "analysis.h"
+#include "hash.h"
+#include "report.h"
+#include <assert.h>
+#include <dirent.h>       /* opendir, readdir */
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>       /* sigaction */
+#include <stdio.h>        /* fprintf, snprintf */
+#include <stdlib.h>       /* malloc, realloc, free, qsort */
+#include <string.h>       /* strcmp, strlen */
+#include <sys/inotify.h>
+#include <sys/stat.h>     /* stat */
+#include <time.h>         /* clock_gettime */
+#include <unistd.h>       /* read */
+
+
+#define DEBOUNCE_MS     30     /* update once no event arrived for this long */
+#define MAXPATHLEN      4096
+#define WATCH_EVENTS    (IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE | IN_CREATE)
+
+
+struct watched_file
+{
+  char*    path;          /* 0 for an empty slot                        */
+  uint64_t hash;
+  char*    findings;      /* printed findings, one per line             */
+  uint32_t len;
+  uint32_t cap;
+  uint32_t nfindings;
+  int      exists;        /* analyzed, and not deleted since            */
+  int      pending;       /* on the pending list                        */
+};
+
+
+static const char**         roots = 0;
+static uint32_t             nroots = 0;
+
+static struct watched_file* files = 0;
+static uint32_t             files_size = 0;   /* number of slots - power of 2 */
+static uint32_t             files_count = 0;
+
+static char**               wd_dirs = 0;
+static uint32_t             nwd_dirs = 0;
+
+static char**               pending = 0;
+static uint32_t             npending = 0;
+static uint32_t             maxpending = 0;
+
+static struct lexer*        lex = 0;
+static int                  ifd = -1;
+static struct watched_file* current = 0;      /* file being analyzed - receives findings */
+static volatile sig_atomic_t report_requested = 0;
+
+
+
+void watch_add_dir(const char* dir)
+{
+  roots = realloc(roots, (nroots + 1) * sizeof(*roots));
+  assert(roots != 0);
+  roots[nroots++] = dir;
+}
+
+int watch_enabled(void)
+{
+  return (nroots > 0);
+}
+
+
+static int is_source(const char* name)
+{
+  const char* ext = strrchr(name, '.');
+  return (ext != 0) && ((strcmp(ext, ".c") == 0) || (strcmp(ext, ".h") == 0));
+}
+
+static double now_ms(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ((double)ts.tv_sec * 1000.0) + ((double)ts.tv_nsec / 1000000.0);
+}
+
+
+
+/* ================================================== */
+/* Per-file findings:                                 */
+/* ================================================== */
+
+static struct watched_file* file_slot(const char* path, uint64_t h)
+{
+  uint32_t i = (uint32_t)hash_mix64(h) & (files_size - 1);
+  while (    (files[i].path != 0)
+          && (    (files[i].hash != h)
+               || (strcmp(files[i].path, path) != 0)))
+  {
+    i = (i + 1) & (files_size - 1);
+  }
+  return &files[i];
+}
+
+/* entry for 'path' - created if needed. Pointers stay valid until the next call. */
+static struct watched_file* file_get(const char* path)
+{
+  uint32_t i;
+
+  if ((files_count * 2) >= files_size)
+  {
+    /* grow and re-hash */
+    struct watched_file* old = files;
+    uint32_t old_size = files_size;
+
+    files_size = (old_size == 0) ? 1024 : (2 * old_size);
+    files = calloc(files_size, sizeof(*files));
+    assert(files != 0);
+    for (i = 0; i < old_size; ++i)
+    {
+      if (old[i].path != 0)
+      {
+        *file_slot(old[i].path, old[i].hash) = old[i];
+      }
+    }
+    free(old);
+  }
+
+  uint64_t h = hash_fnv1a64(path, strlen(path), HASH_FNV1A64_INIT);
+  struct watched_file* f = file_slot(path, h);
+  if (f->path == 0)
+  {
+    size_t len = strlen(path) + 1;
+    f->path = malloc(len);
+    assert(f->path != 0);
+    memcpy(f->path, path, len);
+    f->hash = h;
+    files_count += 1;
+  }
+  return f;
+}
+
+
+static void collect_finding(int check_id, const char* message)
+{
+  uint32_t len = (uint32_t)strlen(message);
+  (void)check_id;
+
+  if ((current->len + len + 2) > current->cap)
+  {
+    current->cap = (current->len + len + 2) * 2;
+    current->findings = realloc(current->findings, current->cap);
+    assert(current->findings != 0);
+  }
+  memcpy(current->findings + current->len, message, len);
+  current->len += len;
+  current->findings[current->len++] = '\n';
+  current->findings[current->len] = 0;
+  current->nfindings += 1;
+}
+
+
+/* (re-)analyze a file - or forget its findings, if it is gone */
+static void analyze(const char* path)
+{
+  struct stat st;
+  struct watched_file* f = file_get(path);
+
+  f->len = 0;
+  f->nfindings = 0;
+  f->exists = (stat(path, &st) == 0) && S_ISREG(st.st_mode);
+  if (f->exists)
+  {
+    current = f;
+    analysis_check_file(lex, path);
+    current = 0;
+  }
+}
+
+
+static int file_cmp(const void* a, const void* b)
+{
+  return strcmp((*(const struct watched_file* const*)a)->path, (*(const struct watched_file* const*)b)->path);
+}
+
+/* all current findings, ordered by path */
+static void print_report(void)
+{
+  struct watched_file** sorted = malloc((files_count + 1) * sizeof(*sorted));
+  uint32_t nsorted = 0;
+  uint32_t nfindings = 0;
+  uint32_t i;
+
+  assert(sorted != 0);
+  for (i = 0; i < files_size; ++i)
+  {
+    if ((files[i].path != 0) && files[i].exists)
+    {
+      sorted[nsorted++] = &files[i];
+    }
+  }
+  qsort(sorted, nsorted, sizeof(*sorted), file_cmp);
+
+  for (i = 0; i < nsorted; ++i)
+  {
+    if (sorted[i]->len > 0)
+    {
+      fputs(sorted[i]->findings, stdout);
+    }
+    nfindings += sorted[i]->nfindings;
+  }
+  fprintf(stdout, "# %u warnings in %u files\n", nfindings, nsorted);
+  fflush(stdout);
+  free(sorted);
+}
+
+
+
+/* ================================================== */
+/* Directories and events:                            */
+/* ================================================== */
+
+/* watch 'dir' and everything below it, analyzing the sources found */
+static void scan_dir(const char* dir)
+{
+  char path[MAXPATHLEN];
+  struct dirent* e;
+  struct stat st;
+
+  DIR* d = opendir(dir);
+  if (d == 0)
+  {
+    return;
+  }
+
+  int wd = inotify_add_watch(ifd, dir, WATCH_EVENTS);
+  if (wd >= 0)
+  {
+    if ((uint32_t)wd >= nwd_dirs)
+    {
+      uint32_t n = nwd_dirs;
+      nwd_dirs = (uint32_t)wd + 64;
+      wd_dirs = realloc(wd_dirs, nwd_dirs * sizeof(*wd_dirs));
+      assert(wd_dirs != 0);
+      memset(wd_dirs + n, 0, (nwd_dirs - n) * sizeof(*wd_dirs));
+    }
+    free(wd_dirs[wd]);
+    wd_dirs[wd] = malloc(strlen(dir) + 1);
+    assert(wd_dirs[wd] != 0);
+    strcpy(wd_dirs[wd], dir);
+  }
+  else
+  {
+    fprintf(stderr, "WARNING: cannot watch '%s'\n", dir);
+  }
+
+  while ((e = readdir(d)) != 0)
+  {
+    if (    (strcmp(e->d_name, ".") == 0)
+         || (strcmp(e->d_name, "..") == 0))
+    {
+      continue;
+    }
+    snprintf(path, sizeof(path), "%s/%s", dir, e->d_name);
+    if (stat(path, &st) != 0)
+    {
+      continue;
+    }
+    if (S_ISDIR(st.st_mode))
+    {
+      scan_dir(path);
+    }
+    else if (is_source(e->d_name))
+    {
+      analyze(path);
+    }
+  }
+  closedir(d);
+}
+
+
+static void add_pending(const char* path)
+{
+  struct watched_file* f = file_get(path);
+  if (f->pending)
+  {
+    return; /* coalesce repeated events */
+  }
+  f->pending = 1;
+
+  if (npending == maxpending)
+  {
+    maxpending = (maxpending == 0) ? 64 : (2 * maxpending);
+    pending = realloc(pending, maxpending * sizeof(*pending));
+    assert(pending != 0);
+  }
+  pending[npending] = malloc(strlen(path) + 1);
+  assert(pending[npending] != 0);
+  strcpy(pending[npending++], path);
+}
+
+
+static void read_events(void)
+{
+  char buf[64 * 1024] __attribute__((aligned(__alignof__(struct inotify_event))));
+  char path[MAXPATHLEN];
+  ssize_t n = read(ifd, buf, sizeof(buf));
+  ssize_t i = 0;
+
+  while ((n > 0) && (i < n))
+  {
+    const struct inotify_event* ev = (const struct inotify_event*)&buf[i];
+    i += (ssize_t)(sizeof(*ev) + ev->len);
+
+    if (    (ev->len == 0)
+         || (ev->wd < 0)
+         || ((uint32_t)ev->wd >= nwd_dirs)
+         || (wd_dirs[ev->wd] == 0))
+    {
+      continue;
+    }
+    snprintf(path, sizeof(path), "%s/%s", wd_dirs[ev->wd], ev->name);
+
+    if (ev->mask & IN_ISDIR)
+    {
+      if (ev->mask & (IN_CREATE | IN_MOVED_TO))
+      {
+        scan_dir(path); /* new sub-directory: watch it - its files count as changed */
+      }
+    }
+    else if (    is_source(ev->name)
+              && (ev->mask & (IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE)))
+    {
+      add_pending(path);
+    }
+  }
+}
+
+
+/* re-analyze the files changed since the last update and print their findings */
+static void update(void)
+{
+  double start = now_ms();
+  uint32_t total = 0;
+  uint32_t nexisting = 0;
+  uint32_t i;
+
+  for (i = 0; i < npending; ++i)
+  {
+    analyze(pending[i]);
+  }
+  double elapsed = now_ms() - start;
+
+  for (i = 0; i < npending; ++i)
+  {
+    struct watched_file* f = file_get(pending[i]);
+    f->pending = 0;
+    if (f->exists)
+    {
+      fprintf(stdout, "# %s: %u warnings\n", f->path, f->nfindings);
+      if (f->len > 0)
+      {
+        fputs(f->findings, stdout);
+      }
+    }
+    else
+    {
+      fprintf(stdout, "# %s: removed\n", f->path);
+    }
+    free(pending[i]);
+  }
+
+  for (i = 0; i < files_size; ++i)
+  {
+    if ((files[i].path != 0) && files[i].exists)
+    {
+      total += files[i].nfindings;
+      nexisting += 1;
+    }
+  }
+  fprintf(stdout, "# re-analyzed %u files in %.1f ms - %u warnings in %u files\n", npending, elapsed, total, nexisting);
+  fflush(stdout);
+  npending = 0;
+}
+
+
+static void on_sigusr1(int sig)
+{
+  (void)sig;
+  report_requested = 1;
+}
+
+
+
+int watch_run(struct lexer* l)
+{
+  struct sigaction sa;
+  struct pollfd fds[2];
+  nfds_t nfds = 2;
+  uint32_t i;
+
+  lex = l;
+  ifd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (ifd < 0)
+  {
+    fprintf(stderr, "\nError: inotify is not available\n");
+    return 0;
+  }
+
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = on_sigusr1;  /* no SA_RESTART: poll() returns on the signal */
+  sigaction(SIGUSR1, &sa, 0);
+
+  report_set_sink(collect_finding);
+
+  /* initial full pass */
+  double start = now_ms();
+  for (i = 0; i < nroots; ++i)
+  {
+    scan_dir(roots[i]);
+  }
+  print_report();
+  fprintf(stdout, "# initial pass took %.1f ms - watching for changes\n", now_ms() - start);
+  fflush(stdout);
+
+  fds[0].fd = ifd;
+  fds[0].events = POLLIN;
+  fds[1].fd = 0;
+  fds[1].events = POLLIN;
+
+  for (;;)
+  {
+    if (report_requested)
+    {
+      report_requested = 0;
+      print_report();
+    }
+
+    int n = poll(fds, nfds, (npending > 0) ? DEBOUNCE_MS : -1);
+    if (n < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      break;
+    }
+    if (n == 0)
+    {
+      update(); /* quiet for DEBOUNCE_MS */
+      continue;
+    }
+
+    if (fds[0].revents & POLLIN)
+    {
+      read_events();
+    }
+    if ((nfds > 1) && (fds[1].revents & (POLLIN | POLLHUP)))
+    {
+      char cmd[256];
+      ssize_t len = read(0, cmd, sizeof(cmd));
+      if (len <= 0)
+      {
+        nfds = 1; /* stdin closed - keep watching */
+      }
+      else if (cmd[0] == 'q')
+      {
+        break;
+      }
+      else
+      {
+        report_requested = 1;
+      }
+    }
+  }
+
+  report_set_sink(0);
+  close(ifd);
+  for (i = 0; i < files_size; ++i)
+  {
+    free(files[i].path);
+    free(files[i].findings);
+  }
+  for (i = 0; i < nwd_dirs; ++i)
+  {
+    free(wd_dirs[i]);
+  }
+  free(files);
+  free(wd_dirs);
+  free(pending);
+  free(roots);
+  return 1;
+}
+
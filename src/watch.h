@@ -0,0 +1,30 @@
+#ifndef __WATCH_H__
+#define __WATCH_H__
+
+/*
+
+Watch mode
+
+  Analyzes all '.c' and '.h' files below the given directories once, then waits for inotify
+  events and re-analyzes only the files that were written, created or moved in. Events are
+  coalesced: files are re-analyzed once no new event has arrived for a short while, so an
+  editor writing a file in several steps triggers one analysis.
+
+  Findings are kept in memory per file. After each update the findings of the changed
+  files are printed. The full current report is printed when a line is read from stdin
+  or on SIGUSR1. 'q' on stdin ends the session.
+
+*/
+
+#include "lexer.h"
+
+
+
+void watch_add_dir(const char* dir);
+int  watch_enabled(void);
+int  watch_run(struct lexer* l);
+
+
+
+#endif /* __WATCH_H__ */
+
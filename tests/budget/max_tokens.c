@@ -0,0 +1,21 @@
+/* SKIP: more than 32 tokens - with '--max-tokens 32' only the first function is analyzed */
+
+int budget_first(int a, int b)
+{
+  int x;
+  if (x = a)      /* BUDGET: reported, it comes before the budget */
+  {
+    return b;
+  }
+  return x;
+}
+
+int budget_second(int a, int b)
+{
+  int y;
+  while (y = b)
+  {
+    b -= a;
+  }
+  return y;
+}
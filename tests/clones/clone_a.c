@@ -0,0 +1,18 @@
+/* Clone detection: copied to clone_b.c with other names - exactly 64 tokens, the default minimum */
+int clone_sum_a(const int* values, int count)
+{
+  int total = 0;
+  int i;
+  for (i = 0; i < count; ++i)
+  {
+    if (values[i] > 0)
+    {
+      total += values[i];
+    }
+    else
+    {
+      total -= 1;
+    }
+  }
+  return total;
+}
@@ -0,0 +1,18 @@
+/* CLONE: copy of clone_sum_a() in clone_a.c */
+int clone_sum_b(const int* items, int count)
+{
+  int acc = 0;
+  int i;
+  for (i = 0; i < count; ++i)
+  {
+    if (items[i] > 0)
+    {
+      acc += items[i];
+    }
+    else
+    {
+      acc -= 1;
+    }
+  }
+  return acc;
+}
@@ -0,0 +1,16 @@
+/*
+
+Compiled twice by compile_commands.json, with other -D options - the marked lines are
+reported with '--compile-commands'
+
+*/
+
+#ifndef CONFIG_SHARED
+int configs_static();     /* not analyzed: both entries define CONFIG_SHARED */
+#endif
+
+#if CONFIG_DEBUG
+int configs_debug();      /* MACRO: CONFIG_DEBUG is 1 in one entry, 0 in the other - not known */
+#else
+int configs_release();    /* MACRO */
+#endif
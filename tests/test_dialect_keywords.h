@@ -0,0 +1,26 @@
+/* C99, C11 and GNU keywords are lexed as keywords (default --std=gnu) - checks see through them */
+
+static inline int dialect1();                      /* HIT */
+static __inline__ int dialect2(void);
+_Noreturn void dialect3();                         /* HIT */
+__attribute__((unused)) static int dialect4();     /* HIT */
+
+void dialect5(uint8_t* restrict u16p);             /* HIT: u16p points to uint8_t */
+void dialect6(const uint8_t* __restrict__ u8p);
+void dialect7(volatile uint32_t* __restrict u8p);  /* HIT: u8p points to uint32_t */
+_Thread_local uint16_t u32tls;                     /* HIT: u32tls is of type uint16_t */
+__thread uint16_t u16tls;
+
+static inline int dialect8(_Bool b)
+{
+  int x = 0;
+  _Static_assert(sizeof(int) >= 2, "int");
+  __asm__ __volatile__("" ::: "memory");
+  if (x = b)                                       /* HIT */
+  {
+  }
+  while ((x = b) != 0)
+  {
+  }
+  return (int)_Alignof(typeof(x));
+}
@@ -0,0 +1,78 @@
+/* Branches of '#if' blocks known not to be compiled are skipped - defects in them are not reported */
+void disabled_blocks(void)
+{
+  int x = 0;
+  int y = 1;
+
+#if 0
+  if (x = y) /* skipped */
+  {
+  }
+#endif
+
+#if 0
+  if (x = y) /* skipped */
+    ;
+#else
+  if (x = y) /* HIT */
+  {
+  }
+#endif
+
+#if 1
+  if (x = y) /* HIT */
+  {
+  }
+#elif 1
+  if (x = y) /* skipped */
+  {
+  }
+#else
+  if (x = y) /* skipped */
+  {
+  }
+#endif
+
+#if 0
+  #if 1
+  if (x = y) /* skipped, nested */
+  {
+  }
+  #else
+  if (x = y) /* skipped, nested */
+  {
+  }
+  #endif
+  if (x = y) /* skipped */
+  {
+  }
+#elif 0 || 1
+  if (x = y) /* HIT */
+  {
+  }
+#endif
+
+#if 0 && defined(SOME_UNKNOWN_MACRO)
+  if (x = y) /* skipped */
+  {
+  }
+#elif defined(SOME_UNKNOWN_MACRO)
+  if (x = y) /* HIT - not known, so it is analyzed */
+  {
+  }
+#else
+  if (x = y) /* HIT */
+  {
+  }
+#endif
+
+#ifdef SOME_UNKNOWN_MACRO
+  if (x = y) /* HIT */
+  {
+  }
+#endif
+
+  if (x = y) /* HIT - line numbers are kept after skipped blocks */
+  {
+  }
+}
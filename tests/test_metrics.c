@@ -0,0 +1,38 @@
+/*
+
+Metrics of this file are compared to test_metrics.tsv with '--metrics' - no defects
+
+*/
+
+static int metrics_total = 0;   /* a statement at file scope */
+
+
+int metrics_sum(const int* values, int count)
+{
+  int sum = 0;
+  int i;
+
+  for (i = 0; i < count; ++i)   /* 'for' and its body are two statements */
+  {
+    if (    (values[i] > 0)
+         && (values[i] < 100))
+    {
+      sum += values[i];
+    }
+  }
+  return sum;
+}
+
+int metrics_kind(int value)
+{
+  switch (value)
+  {
+    case 0:  return 0;
+    default: break;
+  }
+  do
+  {
+    value /= 2;
+  } while (value > 8);
+  return (value > 4) ? 2 : 1;
+}
@@ -25,3 +25,7 @@ void function11(uint64_t s64varName); /* HIT: s64varName is of type uint64_t */
 
 
 
+void function12(const uint8_t* u16p); /* HIT: u16p points to uint8_t */
+uint32_t a, u8b;                      /* HIT: u8b is of type uint32_t */
+int16_t  s16c = 3, u32d[4] = { 0 };   /* HIT: u32d is of type int16_t */
+uint8_t  u80x;                        /* 'u8' followed by a digit - no suggestion */
@@ -0,0 +1,40 @@
+/*
+
+Definitions of the declarations in test_project_decls.h - the marked lines disagree
+with the header and are only reported with '--project-checks'
+
+*/
+
+#include "test_project_decls.h"
+
+
+unsigned long int proj_count = 0;    /* same type as 'unsigned long' */
+uint32_t          proj_flags = 0;    /* CROSS */
+char**            proj_name = 0;     /* CROSS */
+signed int        proj_level, proj_depth;
+long long int     proj_total;
+
+static int        proj_cache;        /* file-local: not compared */
+static int        proj_close_all(void);
+
+
+int proj_open()      /* HIT CROSS */
+{
+  int proj_flags = 1;  /* local: not compared */
+  return proj_flags;
+}
+
+int proj_close(void)
+{
+  return proj_close_all();
+}
+
+void proj_reset()    /* HIT CROSS */
+{
+  proj_count = 0;
+}
+
+static int proj_close_all(void)
+{
+  return proj_cache;
+}
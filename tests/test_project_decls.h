@@ -0,0 +1,20 @@
+/*
+
+Declarations compared across files with '--project-checks' - see test_project_decls.c
+
+Each marked line disagrees with the other file and is reported at the end of the run.
+
+*/
+
+#include <stdint.h>
+
+
+int  proj_open(void);
+int  proj_close(void);
+void proj_reset(void);
+
+extern unsigned long  proj_count;
+extern uint16_t       proj_flags;
+extern char*          proj_name;
+extern int            proj_level;
+extern long long      proj_total;
@@ -0,0 +1,29 @@
+/*
+
+Check that type names learned from typedefs are seen through by the misleading-name check
+
+*/
+
+typedef uint16_t my_u16_t;
+typedef my_u16_t reg16_t, *reg16p_t;
+typedef struct { int8_t s8a; } pair_t;
+typedef void (*callback_t)(uint32_t u32arg);
+
+
+void function1(my_u16_t u8x);         /* HIT: u8x is of type uint16_t (via my_u16_t) */
+void function2(my_u16_t u16x);        /* u16x is of type uint16_t                    */
+void function3(reg16_t s16x);         /* HIT: s16x is of type uint16_t (via reg16_t)  */
+void function4(reg16p_t u8p);         /* pointer typedef - no rule                   */
+void function5(pair_t u32pair);       /* struct typedef - no rule                    */
+void function6(callback_t u8fn);      /* function pointer typedef - no rule          */
+
+
+
+/* A header read twice repeats its typedefs: the names are types already, never a reason to take a parameter or tag instead */
+typedef long (*cb_fn)(int *b, int oper);
+typedef long (*cb_fn)(int *b, int oper);
+typedef struct tag tag_t;
+typedef struct tag tag_t;
+
+void b();                             /* HIT: b is a parameter name, not a type      */
+void tag();                           /* HIT: tag is a struct tag, not a type        */